@@ -81,6 +81,20 @@ static inline __ptr_t memcpy(__ptr_t __dest, __const __ptr_t __src,
 	int i = 0;
 	unsigned char *d = (unsigned char *)__dest, *s = (unsigned char *)__src;
 
+	if ((((unsigned long)d | (unsigned long)s) & 3) == 0) {
+		unsigned long *dl = (unsigned long *)d, *sl = (unsigned long *)s;
+
+		for (i = __n >> 4; i > 0; i--) {
+			*dl++ = *sl++;
+			*dl++ = *sl++;
+			*dl++ = *sl++;
+			*dl++ = *sl++;
+		}
+		d = (unsigned char *)dl;
+		s = (unsigned char *)sl;
+		__n &= 15;
+	}
+
 	for (i = __n >> 3; i > 0; i--) {
 		*d++ = *s++;
 		*d++ = *s++;
@@ -185,6 +199,7 @@ static ulg free_mem_ptr_end;
 
 #define HEAP_SIZE 0x2000
 
+#define INFLATE_HAVE_INSIZE
 #include "../../../../lib/inflate.c"
 
 #ifndef STANDALONE_DEBUG
@@ -252,17 +267,8 @@ int fill_inbuf(void)
  */
 void flush_window(void)
 {
-	ulg c = crc;
-	unsigned n;
-	uch *in, *out, ch;
-
-	in = window;
-	out = &output_data[output_ptr];
-	for (n = 0; n < outcnt; n++) {
-		ch = *out++ = *in++;
-		c = crc_32_tab[((int)c ^ ch) & 0xff] ^ (c >> 8);
-	}
-	crc = c;
+	memcpy(&output_data[output_ptr], window, outcnt);
+	updcrc(window, outcnt);
 	bytes_out += (ulg)outcnt;
 	output_ptr += (ulg)outcnt;
 	outcnt = 0;
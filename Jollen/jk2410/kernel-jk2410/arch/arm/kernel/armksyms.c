@@ -204,6 +204,7 @@ EXPORT_SYMBOL(__arch_strnlen_user);
 	/* consistent area handling */
 EXPORT_SYMBOL(pci_alloc_consistent);
 EXPORT_SYMBOL(consistent_alloc);
+EXPORT_SYMBOL(consistent_alloc_writecombine);
 EXPORT_SYMBOL(consistent_free);
 EXPORT_SYMBOL(consistent_sync);
 
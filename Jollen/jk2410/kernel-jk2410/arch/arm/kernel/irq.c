@@ -181,6 +181,9 @@ asmlinkage void do_IRQ(int irq, struct pt_regs * regs)
 
 	if (action) {
 		int status = 0;
+#ifdef CONFIG_S3C2410_IRQ_STATS
+		unsigned long stamp;
+#endif
 
 		if (desc->nomask) {
 			spin_lock(&irq_controller_lock);
@@ -191,6 +194,9 @@ asmlinkage void do_IRQ(int irq, struct pt_regs * regs)
 		if (!(action->flags & SA_INTERRUPT))
 			__sti();
 
+#ifdef CONFIG_S3C2410_IRQ_STATS
+		stamp = s3c2410_irq_stamp();
+#endif
 		do {
 			status |= action->flags;
 			action->handler(irq, action->dev_id, regs);
@@ -200,6 +206,9 @@ asmlinkage void do_IRQ(int irq, struct pt_regs * regs)
 		if (status & SA_SAMPLE_RANDOM)
 			add_interrupt_randomness(irq);
 		__cli();
+#ifdef CONFIG_S3C2410_IRQ_STATS
+		s3c2410_irq_account(irq, stamp);
+#endif
 
 		if (!desc->nomask && desc->enabled) {
 			spin_lock(&irq_controller_lock);
@@ -164,6 +164,7 @@ NORET_TYPE void die(const char *str, struct pt_regs *regs, int err)
 
 	console_verbose();
 	spin_lock_irq(&die_lock);
+	bust_spinlocks(1);
 
 	printk("Internal error: %s: %x\n", str, err);
 	printk("CPU: %d\n", smp_processor_id());
@@ -190,6 +191,7 @@ NORET_TYPE void die(const char *str, struct pt_regs *regs, int err)
 		set_fs(fs);
 	}
 
+	bust_spinlocks(0);
 	spin_unlock_irq(&die_lock);
 	do_exit(SIGSEGV);
 }
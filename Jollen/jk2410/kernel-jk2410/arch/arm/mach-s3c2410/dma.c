@@ -317,8 +317,9 @@ int s3c2410_dma_get_current(dmach_t channel, void **buf_id, dma_addr_t *addr)
 
 		if (buf_id)
 			*buf_id = buf->id;
+		/* report the memory side of the transfer */
 		if (status > 0)
-			*addr = regs->DCSRC;
+			*addr = buf->write ? regs->DCSRC : regs->DCDST;
 		DPRINTK("curr_pos: b=%#x a=%#x\n", (int)dma->curr->id, *addr);
 		ret = 0;
 	} else if (dma->head && !dma->active) {
@@ -0,0 +1,142 @@
+/*
+ * linux/arch/arm/mach-s3c2410/hrtimer.c
+ *
+ * Clock and event timer for high-resolution timers (kernel/hrtimer.c).
+ *
+ * The clock is the tick count extended with the elapsed part of the
+ * current tick read from PWM timer 4, which drives HZ.  Events come
+ * from PWM timer 1 run in one-shot mode on prescaler 0 with the 1/2
+ * divider, i.e. 40 ns per count and at most 2.6 ms per shot at 50 MHz
+ * PCLK.  Longer deadlines take several shots.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <linux/config.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/sched.h>
+#include <linux/interrupt.h>
+#include <linux/hrtimer.h>
+
+#include <asm/hardware.h>
+#include <asm/irq.h>
+#include <asm/mach/irq.h>
+#include <asm/div64.h>
+
+#define HR_MIN_COUNTS	2		/* shortest shot we program */
+#define HR_MAX_COUNTS	0xffff		/* TCNTB1 is 16 bits */
+#define HR_MULT_SHIFT	24
+
+#define TCON_1_MASK	(TCON_1_AUTO | TCON_1_INVERT | TCON_1_MAN | TCON_1_ONOFF)
+#define TCFG1_MUX1_MASK	(0xf << 4)
+
+u64 s3c2410_hr_ticks;			/* timer 4 interrupts, see time.h */
+
+static unsigned long tick_ns;		/* ns per jiffy */
+static unsigned long tick_mult;		/* timer 4 counts to ns, << 16 */
+static unsigned long hr_rate;		/* timer 1 counts per second */
+static unsigned long hr_mult;		/* ns to timer 1 counts, << 24 */
+static unsigned long hr_max_ns;		/* longest shot, in ns */
+static ktime_t hr_last;			/* keeps the clock monotonic */
+
+/*
+ * Called with interrupts disabled.  If timer 4 has reloaded but its
+ * interrupt has not been taken yet, the tick count is one behind: the
+ * pending bit tells, and TCNTO4 is read again after looking at it so
+ * the count belongs to the new tick.
+ */
+ktime_t hrtimer_arch_now(void)
+{
+	u64 ticks = s3c2410_hr_ticks;
+	unsigned long count = TCNTO4;
+	ktime_t now;
+
+	if (SRCPND & INT_TIMER4) {
+		count = TCNTO4;
+		ticks++;
+	}
+	now = ticks * tick_ns +
+		(((u64)(TCNTB4 - count) * tick_mult) >> 16);
+
+	/* a reload between the two reads above must not step back */
+	if (now < hr_last)
+		now = hr_last;
+	hr_last = now;
+	return now;
+}
+
+unsigned long hrtimer_arch_resolution(void)
+{
+	return NSEC_PER_SEC / hr_rate;
+}
+
+/* Called with interrupts disabled */
+void hrtimer_arch_program(ktime_t expires)
+{
+	ktime_t delta = expires - hrtimer_arch_now();
+	unsigned long counts, tcon;
+
+	if (delta <= 0)
+		counts = HR_MIN_COUNTS;
+	else if (delta >= hr_max_ns)
+		counts = HR_MAX_COUNTS;
+	else {
+		counts = ((u64)delta * hr_mult) >> HR_MULT_SHIFT;
+		if (counts < HR_MIN_COUNTS)
+			counts = HR_MIN_COUNTS;
+	}
+
+	/* one-shot: load with manual update, then start without auto reload */
+	TCNTB1 = counts;
+	TCMPB1 = 0;
+	tcon = TCON & ~TCON_1_MASK;
+	TCON = tcon | TCON_1_MAN;
+	TCON = tcon | TCON_1_ONOFF;
+}
+
+static void s3c2410_hrtimer_interrupt(int irq, void *dev_id, struct pt_regs *regs)
+{
+	hrtimer_interrupt();
+}
+
+static struct irqaction hrtimer_irq = {
+	name:		"hrtimer",
+	handler:	s3c2410_hrtimer_interrupt,
+	flags:		SA_INTERRUPT,
+};
+
+/*
+ * Called from setup_timer() once timer 4 runs, so drivers can use
+ * hrtimers from their initcalls.  TCFG0 prescaler 0 is already 0.
+ */
+void __init s3c2410_hrtimer_setup(unsigned long pclk)
+{
+	u64 tmp;
+
+	tick_ns = tick * NSEC_PER_USEC;
+	tmp = (u64)tick_ns << 16;
+	do_div(tmp, TCNTB4);
+	tick_mult = (unsigned long)tmp;
+
+	hr_rate = pclk / 2;
+
+	tmp = (u64)hr_rate << HR_MULT_SHIFT;
+	do_div(tmp, NSEC_PER_SEC);
+	hr_mult = (unsigned long)tmp;
+
+	tmp = (u64)HR_MAX_COUNTS * NSEC_PER_SEC;
+	do_div(tmp, hr_rate);
+	hr_max_ns = (unsigned long)tmp;
+
+	TCFG1 &= ~TCFG1_MUX1_MASK;	/* 1/2 */
+	TCON &= ~TCON_1_MASK;
+
+	setup_arm_irq(IRQ_TIMER1, &hrtimer_irq);
+
+	printk(KERN_INFO "hrtimer: PWM timer 1, %lu ns resolution\n",
+	       hrtimer_arch_resolution());
+}
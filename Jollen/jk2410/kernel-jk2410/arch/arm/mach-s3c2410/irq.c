@@ -30,10 +30,13 @@
 #include <linux/sched.h>
 #include <linux/ioport.h>
 #include <linux/interrupt.h>
+#include <linux/proc_fs.h>
+#include <linux/kernel_stat.h>
 
 #include <asm/hardware.h>
 #include <asm/irq.h>
 #include <asm/mach/irq.h>
+#include <asm/div64.h>
 
 #define	ClearPending(x)	{	\
 			  SRCPND = (1 << (x));	\
@@ -45,6 +48,8 @@
 
 #define EXTINT_MASK	0x7
 
+static int irq_arb_fixed;
+
 #if 0
 
 /*
@@ -276,66 +281,198 @@ static void SUB_unmask_irq(unsigned int irq)
 
 /*
  *  fixup_irq() for do_IRQ() in kernel/irq.c
+ *
+ * UART0-2, ADC/TS and EINT4-23 share one bit of INTPND each and have
+ * to be resolved through SUBSRCPND or EINTPEND.  Instead of testing
+ * the pending bits one at a time, each multiplexed source has a table
+ * entry with the bits it owns and the irq number of bit 0, and the
+ * lowest pending bit is found with a de Bruijn multiply (ARM920T has
+ * no clz).  Sources listed with "irqprio=" are picked before the rest
+ * of their group.
  */
-inline unsigned int get_subIRQ(int irq, int begin, int end, int fail_irq) {
-	int i;
+struct irq_demux {
+	unsigned long mask;	/* bits owned in the pending register */
+	unsigned int base;	/* irq number of bit 0 */
+	int eint;		/* EINTPEND rather than SUBSRCPND */
+};
+
+static struct irq_demux irq_demux[NORMAL_IRQ_OFFSET] = {
+	[IRQ_UART0]	= { 0x00000007, EXT_IRQ_OFFSET, 0 },
+	[IRQ_UART1]	= { 0x00000038, EXT_IRQ_OFFSET, 0 },
+	[IRQ_UART2]	= { 0x000001c0, EXT_IRQ_OFFSET, 0 },
+	[IRQ_ADCTC]	= { 0x00000600, EXT_IRQ_OFFSET, 0 },
+	[IRQ_EINT4_7]	= { 0x000000f0, NORMAL_IRQ_OFFSET - 4, 1 },
+	[IRQ_EINT8_23]	= { 0x00ffff00, NORMAL_IRQ_OFFSET - 4, 1 },
+};
+
+/* latency-sensitive bits of SUBSRCPND [0] and EINTPEND [1] */
+static unsigned long irq_demux_prio[2];
+
+static const unsigned char debruijn_bit[32] = {
+	 0,  1, 28,  2, 29, 14, 24,  3, 30, 22, 20, 15, 25, 17,  4,  8,
+	31, 27, 13, 23, 21, 19, 16,  7, 26, 12, 18,  6, 11,  5, 10,  9
+};
+
+static inline unsigned int lowest_bit(unsigned long x)
+{
+	return debruijn_bit[((x & -x) * 0x077cb531UL) >> 27];
+}
 
-	for(i=begin; i <= end; i++) {
-	  if (irq & (1 << i))
-	    return (EXT_IRQ_OFFSET + i);
+unsigned int fixup_irq(int irq) {
+    struct irq_demux *d;
+    unsigned long pend;
+
+    if (irq == OS_TIMER || irq >= NORMAL_IRQ_OFFSET)
+      return irq;
+
+    d = &irq_demux[irq];
+    if (!d->mask)
+      return irq;
+
+    if (d->eint)
+      pend = EINTPEND & ~EINTMASK;
+    else
+      pend = SUBSRCPND & ~INTSUBMSK;
+    pend &= d->mask;
+    if (!pend)
+      return irq;
+
+    if (pend & irq_demux_prio[d->eint])
+      pend &= irq_demux_prio[d->eint];
+
+    return d->base + lowest_bit(pend);
+}
+
+/*
+ * irqprio=<irq>[,<irq>...][,norotate]
+ *
+ * Demultiplexed irqs (EINT4-23, UART and ADC sub sources) given here
+ * win over the other sources sharing their INTPND bit.  "norotate"
+ * turns off rotation in the interrupt arbiters, so lower numbered
+ * main sources always win.
+ */
+static int __init irqprio_setup(char *str)
+{
+	while (*str) {
+		if (!strncmp(str, "norotate", 8)) {
+			irq_arb_fixed = 1;
+			str += 8;
+		} else {
+			unsigned int irq = simple_strtoul(str, &str, 0);
+
+			if (irq >= IRQ_EINT4 && irq <= IRQ_EINT23)
+				irq_demux_prio[1] |= 1 << EINT_OFFSET(irq);
+			else if (irq >= EXT_IRQ_OFFSET && irq < SUB_IRQ_OFFSET)
+				irq_demux_prio[0] |= 1 << SUBIRQ_OFFSET(irq);
+			else
+				printk(KERN_WARNING "irqprio: irq %u is not "
+				       "demultiplexed, ignored\n", irq);
+		}
+		if (*str != ',')
+			break;
+		str++;
 	}
-	return fail_irq;
+	return 1;
+}
+
+__setup("irqprio=", irqprio_setup);
+
+#ifdef CONFIG_S3C2410_IRQ_STATS
+/*
+ * Handler time accounting, called around the action chain by do_IRQ().
+ * Timestamps are PWM timer 4 counts within the current tick; a handler
+ * is assumed not to run across more than one timer reload.
+ */
+static struct irq_time {
+	unsigned long max;	/* timer counts */
+	unsigned long total_hi, total;
+} irq_time[NR_IRQS];
+
+unsigned long s3c2410_irq_stamp(void)
+{
+	return TCNTB4 - TCNTO4;
+}
+
+void s3c2410_irq_account(unsigned int irq, unsigned long stamp)
+{
+	struct irq_time *t = &irq_time[irq];
+	long delta = s3c2410_irq_stamp() - stamp;
+
+	if (delta < 0)
+		delta += TCNTB4;
+	if (delta > t->max)
+		t->max = delta;
+	t->total += delta;
+	if (t->total < delta)
+		t->total_hi++;
 }
 
-inline unsigned int get_extIRQ(int irq, int begin, int end, int fail_irq) {
-	int i;
+static inline unsigned long counts_to_usec(unsigned long counts)
+{
+	return (counts * tick) / TCNTB4;
+}
 
-	for(i=begin; i <= end; i++) {
-	  if (irq & (1 << i))
-	    return (NORMAL_IRQ_OFFSET - 4 + i);
+static int irqstat_read_proc(char *page, char **start, off_t off,
+			     int count, int *eof, void *data)
+{
+	char *p = page;
+	struct irqaction *action;
+	unsigned long long total;
+	unsigned int n;
+	int i, len;
+
+	p += sprintf(p, "          count   avg(us)   max(us)\n");
+	for (i = 0; i < NR_IRQS; i++) {
+		action = irq_desc[i].action;
+		if (!action)
+			continue;
+		n = kstat_irqs(i);
+		total = ((unsigned long long)irq_time[i].total_hi << 32) |
+			irq_time[i].total;
+		if (n)
+			do_div(total, n);
+		p += sprintf(p, "%3d: %10u %9lu %9lu  %s", i, n,
+			     counts_to_usec((unsigned long)total),
+			     counts_to_usec(irq_time[i].max), action->name);
+		for (action = action->next; action; action = action->next)
+			p += sprintf(p, ", %s", action->name);
+		*p++ = '\n';
 	}
-	return fail_irq;
+
+	len = (p - page) - off;
+	if (len < 0)
+		len = 0;
+	*eof = (len <= count) ? 1 : 0;
+	*start = page + off;
+	return len;
 }
 
-unsigned int fixup_irq(int irq) {
-    unsigned int ret;
-    unsigned long sub_mask, ext_mask;
+static int irqstat_write_proc(struct file *file, const char *buffer,
+			      unsigned long count, void *data)
+{
+	unsigned long flags;
 
-    if (irq == OS_TIMER)
-      return irq;
+	local_irq_save(flags);
+	memset(irq_time, 0, sizeof(irq_time));
+	local_irq_restore(flags);
+	return count;
+}
 
-    switch (irq) {
-    case IRQ_UART0:
-      sub_mask = SUBSRCPND & ~INTSUBMSK;
-      ret = get_subIRQ(sub_mask, 0, 2, irq);
-      break;
-    case IRQ_UART1:
-      sub_mask = SUBSRCPND & ~INTSUBMSK;
-      ret = get_subIRQ(sub_mask, 3, 5, irq);
-      break;
-    case IRQ_UART2:
-      sub_mask = SUBSRCPND & ~INTSUBMSK;
-      ret = get_subIRQ(sub_mask, 6, 8, irq);
-      break;
-    case IRQ_ADCTC:
-      sub_mask = SUBSRCPND & ~INTSUBMSK;
-      ret = get_subIRQ(sub_mask, 9, 10, irq);
-      break;
-    case IRQ_EINT4_7:
-      ext_mask = EINTPEND & ~EINTMASK;
-      ret = get_extIRQ(ext_mask, 4, 7, irq);
-      break;
-    case IRQ_EINT8_23:
-      ext_mask = EINTPEND & ~EINTMASK;
-      ret = get_extIRQ(ext_mask, 8, 23, irq);
-      break;
-    default:
-      ret = irq;
-    }
-	
-    return ret;
+static int __init irqstat_init(void)
+{
+	struct proc_dir_entry *ent;
+
+	ent = create_proc_entry("irqstat", S_IWUSR | S_IRUGO, NULL);
+	if (ent) {
+		ent->read_proc = irqstat_read_proc;
+		ent->write_proc = irqstat_write_proc;
+	}
+	return 0;
 }
 
+__initcall(irqstat_init);
+#endif
+
 static struct resource irq_resource = {
 	name:	"irqs",
 	start:	0x4a000000,
@@ -365,6 +502,9 @@ void __init s3c2410_init_irq(void) {
     */
     INTMOD = 0x00000000;
 
+    /* arbiters rotate by default; irqprio=norotate fixes them */
+    PRIORITY = irq_arb_fixed ? 0x00000000 : 0x0000007f;
+
     /* clear Source/Interrupt Pending Register */
     SRCPND = 0xffffffff;
     INTPND = 0xffffffff;
@@ -2,11 +2,15 @@
 #include <linux/init.h>
 #include <linux/pm.h>
 #include <linux/sysctl.h>
+#include <linux/module.h>
+#include <linux/sched.h>
+#include <linux/hrtimer.h>
 #ifdef CONFIG_PROC_FS
 #include <linux/proc_fs.h>
 #endif
 
 #include <asm/hardware.h>
+#include <asm/arch/pm.h>
 
 /*
  * Debug macros
@@ -21,8 +25,23 @@
 extern void s3c2410_cpu_suspend(void);
 extern void s3c2410_cpu_resume(void);
 
-#define SAVE(x)		sleep_save[SLEEP_SAVE_##x] = x
-#define RESTORE(x)	x = sleep_save[SLEEP_SAVE_##x]
+unsigned long pm_resume_core_usec;
+unsigned long pm_resume_dev_usec;
+
+void s3c2410_pm_do_save(struct sleep_save *ptr, int count)
+{
+	for (; count > 0; count--, ptr++)
+		ptr->val = *ptr->reg;
+}
+
+void s3c2410_pm_do_restore(struct sleep_save *ptr, int count)
+{
+	for (; count > 0; count--, ptr++)
+		*ptr->reg = ptr->val;
+}
+
+EXPORT_SYMBOL(s3c2410_pm_do_save);
+EXPORT_SYMBOL(s3c2410_pm_do_restore);
 
 static u_int pwbt_num = 0;
 static int pwbt_edge = 0;
@@ -72,73 +91,53 @@ setup_wakeup_src(void)
 }
 
 /*
- * List of global S3C2410 peripheral registers to preserve.
- * More ones like CP and general purpose register values are preserved
- * with the stack location in sleep.S.
+ * Global S3C2410 peripheral registers to preserve, grouped in the
+ * order they have to come back.  More ones like CP and general purpose
+ * register values are preserved with the stack location in sleep.S.
  */
-enum {	SLEEP_SAVE_START = 0,
-
-	SLEEP_SAVE_INTMSK, SLEEP_SAVE_INTPND, SLEEP_SAVE_SRCPND,
-	SLEEP_SAVE_INTSUBMSK, SLEEP_SAVE_SUBSRCPND,
-	SLEEP_SAVE_INTMOD,
-
-	SLEEP_SAVE_CLKCON,
+static struct sleep_save timer_save[] = {
+	SAVE_ITEM(TCFG0), SAVE_ITEM(TCFG1), SAVE_ITEM(TCNTB4),
+};
 
-	SLEEP_SAVE_UBRDIV0, SLEEP_SAVE_ULCON0, SLEEP_SAVE_UFCON0,
-	SLEEP_SAVE_UMCON0, SLEEP_SAVE_UCON0,
+static struct sleep_save gpio_save[] = {
+	SAVE_ITEM(GPACON), SAVE_ITEM(GPADAT),
+	SAVE_ITEM(GPBCON), SAVE_ITEM(GPBDAT), SAVE_ITEM(GPBUP),
+	SAVE_ITEM(GPCCON), SAVE_ITEM(GPCDAT), SAVE_ITEM(GPCUP),
+	SAVE_ITEM(GPDCON), SAVE_ITEM(GPDDAT), SAVE_ITEM(GPDUP),
+	SAVE_ITEM(GPECON), SAVE_ITEM(GPEDAT), SAVE_ITEM(GPEUP),
+	SAVE_ITEM(GPFCON), SAVE_ITEM(GPFDAT), SAVE_ITEM(GPFUP),
+	SAVE_ITEM(GPGCON), SAVE_ITEM(GPGDAT), SAVE_ITEM(GPGUP),
 
-	SLEEP_SAVE_GPACON, SLEEP_SAVE_GPADAT,
-	SLEEP_SAVE_GPBCON, SLEEP_SAVE_GPBDAT, SLEEP_SAVE_GPBUP,
-	SLEEP_SAVE_GPCCON, SLEEP_SAVE_GPCDAT, SLEEP_SAVE_GPCUP,
-	SLEEP_SAVE_GPDCON, SLEEP_SAVE_GPDDAT, SLEEP_SAVE_GPDUP,
-	SLEEP_SAVE_GPECON, SLEEP_SAVE_GPEDAT, SLEEP_SAVE_GPEUP,
-	SLEEP_SAVE_GPFCON, SLEEP_SAVE_GPFDAT, SLEEP_SAVE_GPFUP,
-	SLEEP_SAVE_GPGCON, SLEEP_SAVE_GPGDAT, SLEEP_SAVE_GPGUP,
+	SAVE_ITEM(MISCCR), SAVE_ITEM(DCLKCON),
+};
 
-	SLEEP_SAVE_MISCCR, SLEEP_SAVE_DCLKCON,
-	SLEEP_SAVE_EXTINT0, SLEEP_SAVE_EXTINT1, SLEEP_SAVE_EXTINT2,
-	SLEEP_SAVE_EINTFLT0, SLEEP_SAVE_EINTFLT1, SLEEP_SAVE_EINTFLT2, 
-	SLEEP_SAVE_EINTFLT3, SLEEP_SAVE_EINTMASK,
+static struct sleep_save irq_save[] = {
+	SAVE_ITEM(EXTINT0), SAVE_ITEM(EXTINT1), SAVE_ITEM(EXTINT2),
+	SAVE_ITEM(EINTFLT0), SAVE_ITEM(EINTFLT1),
+	SAVE_ITEM(EINTFLT2), SAVE_ITEM(EINTFLT3),
+	SAVE_ITEM(EINTMASK),
 
-	SLEEP_SAVE_TCFG0, SLEEP_SAVE_TCFG1, SLEEP_SAVE_TCNTB4,
-	SLEEP_SAVE_TCON,
+	SAVE_ITEM(INTMOD), SAVE_ITEM(INTMSK), SAVE_ITEM(INTSUBMSK),
+};
 
-	SLEEP_SAVE_SIZE
+static struct sleep_save uart_save[] = {
+	SAVE_ITEM(ULCON0), SAVE_ITEM(UCON0), SAVE_ITEM(UFCON0),
+	SAVE_ITEM(UMCON0), SAVE_ITEM(UBRDIV0),
 };
 
 int pm_do_suspend(void)
 {
-	unsigned long sleep_save[SLEEP_SAVE_SIZE];
+	struct timeval t0, t1;
 
 	DPRINTK("I am pm_do_suspend\n");
 
 	cli();
 
-
 	/* save vital registers */
-	SAVE(UBRDIV0);
-	SAVE(ULCON0);
-	SAVE(UFCON0);
-	SAVE(UMCON0);
-	SAVE(UCON0);
-
-	SAVE(GPACON); SAVE(GPADAT);
-	SAVE(GPBCON); SAVE(GPBDAT); SAVE(GPBUP);
-	SAVE(GPCCON); SAVE(GPCDAT); SAVE(GPCUP);
-	SAVE(GPDCON); SAVE(GPDDAT); SAVE(GPDUP);
-	SAVE(GPECON); SAVE(GPEDAT); SAVE(GPEUP);
-	SAVE(GPFCON); SAVE(GPFDAT); SAVE(GPFUP);
-	SAVE(GPGCON); SAVE(GPGDAT); SAVE(GPGUP);
-
-	SAVE(MISCCR); SAVE(DCLKCON);
-	SAVE(EXTINT0); SAVE(EXTINT1); SAVE(EXTINT2);
-	SAVE(EINTFLT0); SAVE(EINTFLT1); SAVE(EINTFLT2); SAVE(EINTFLT3);
-	SAVE(EINTMASK);
-
-	SAVE(INTMOD); SAVE(INTMSK); SAVE(INTSUBMSK);
-
-
-	SAVE(TCFG0); SAVE(TCNTB4); SAVE(TCON);
+	s3c2410_pm_do_save(uart_save, ARRAY_SIZE(uart_save));
+	s3c2410_pm_do_save(gpio_save, ARRAY_SIZE(gpio_save));
+	s3c2410_pm_do_save(irq_save, ARRAY_SIZE(irq_save));
+	s3c2410_pm_do_save(timer_save, ARRAY_SIZE(timer_save));
 
 	/* temporary.. */
 	GPFDAT |= 0xf0;  
@@ -163,28 +162,20 @@ int pm_do_suspend(void)
 
 	PMCTL1 &= ~(USBSPD1 | USBSPD0);
 
-	RESTORE(TCFG0);
-	RESTORE(TCNTB4);
+	s3c2410_pm_do_restore(timer_save, ARRAY_SIZE(timer_save));
 	TCON = (TCON_4_AUTO | TCON_4_UPDATE | COUNT_4_OFF);
 	TCON = (TCON_4_AUTO | COUNT_4_ON);
+#ifdef CONFIG_HIGH_RES_TIMERS
+	/* the TCON writes above stopped the hrtimer event timer */
+	hrtimer_reprogram();
+#endif
 
-
+	/* timer 4 runs again, so gettimeofday() deltas are good from here */
+	do_gettimeofday(&t0);
 
 	/* restore registers */
-	RESTORE(GPACON); RESTORE(GPADAT);
-	RESTORE(GPBCON); RESTORE(GPBDAT); RESTORE(GPBUP);
-	RESTORE(GPCCON); RESTORE(GPCDAT); RESTORE(GPCUP);
-	RESTORE(GPDCON); RESTORE(GPDDAT); RESTORE(GPDUP);
-	RESTORE(GPECON); RESTORE(GPEDAT); RESTORE(GPEUP);
-	RESTORE(GPFCON); RESTORE(GPFDAT); RESTORE(GPFUP);
-	RESTORE(GPGCON); RESTORE(GPGDAT); RESTORE(GPGUP);
-
-	RESTORE(MISCCR); RESTORE(DCLKCON);
-	RESTORE(EXTINT0); RESTORE(EXTINT1); RESTORE(EXTINT2);
-	RESTORE(EINTFLT0); RESTORE(EINTFLT1); RESTORE(EINTFLT2); RESTORE(EINTFLT3);
-	RESTORE(EINTMASK);
-
-	RESTORE(INTMOD); RESTORE(INTMSK); RESTORE(INTSUBMSK);
+	s3c2410_pm_do_restore(gpio_save, ARRAY_SIZE(gpio_save));
+	s3c2410_pm_do_restore(irq_save, ARRAY_SIZE(irq_save));
 
 	/* Clear interrupts */
 	EINTPEND = EINTPEND;
@@ -196,20 +187,19 @@ int pm_do_suspend(void)
 
 
 	/* temporary.. reset UART */
-	RESTORE(ULCON0); RESTORE(UCON0); RESTORE(UFCON0);
-	RESTORE(UMCON0); RESTORE(UBRDIV0);
+	s3c2410_pm_do_restore(uart_save, ARRAY_SIZE(uart_save));
 	GPFCON &= ~(0xff00);
 	GPFCON |= 0x5500;
 	GPFUP |= 0xf0;
 	GPFDAT &= ~(0xf0);  
 	GPFDAT |= 0xa0;
 
-
+	do_gettimeofday(&t1);
+	pm_resume_core_usec = (t1.tv_sec - t0.tv_sec) * 1000000 +
+		(t1.tv_usec - t0.tv_usec);
 
 	sti();
 
-	DPRINTK("߽òٷ\n");
-
 	DPRINTK("I am still alive\n");
 
 	return 0;
@@ -273,8 +263,14 @@ pminfo_proc_output(char *buf)
 	struct pm_dev *dev;
 
 	p = buf;
-	p += sprintf(p, "type \t\t id \t\t stat \t prev_state \n");
-	p += sprintf(p, "----------------------------------------------\n");
+	p += sprintf(p, "last resume: core %lu us, devices %lu us\n\n",
+		     pm_resume_core_usec, pm_resume_dev_usec);
+#ifdef CONFIG_MIZI
+	p += sprintf(p, "type \t\t id \t\t stat \t prev_state \t suspend(us) \t resume(us)\n");
+#else
+	p += sprintf(p, "type \t\t id \t\t stat \t prev_state\n");
+#endif
+	p += sprintf(p, "------------------------------------------------------------------------------\n");
 
 	dev = NULL;
 
@@ -359,7 +355,16 @@ pminfo_proc_output(char *buf)
 			p += sprintf(p, "PM_UNKONWN_DEV \t ");
 			break;
 		}
-		p += sprintf(p, "%d \t %d\n", (int)dev->state, (int)dev->prev_state);
+#ifdef CONFIG_MIZI
+		p += sprintf(p, "%d \t %d \t\t %lu \t\t %lu%s\n",
+			     (int)dev->state, (int)dev->prev_state,
+			     dev->suspend_usec, dev->resume_usec,
+			     (dev->flags & PM_FLAG_ASYNC_RESUME) ? " async" : "");
+#else
+		p += sprintf(p, "%d \t %d%s\n",
+			     (int)dev->state, (int)dev->prev_state,
+			     (dev->flags & PM_FLAG_ASYNC_RESUME) ? " async" : "");
+#endif
 	}
 
 	return p - buf;
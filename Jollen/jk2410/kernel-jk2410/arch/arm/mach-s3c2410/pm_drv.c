@@ -1,8 +1,10 @@
 #include <linux/config.h>
 #include <linux/pm.h>
 #include <linux/module.h>
+#include <linux/sched.h>
 
 #include <asm/hardware.h>
+#include <asm/arch/pm.h>
 /* Debugging macros */
 #undef DEBUG_PMDRV
 #ifdef DEBUG_PMDRV
@@ -20,6 +22,7 @@ extern int pm_send_all_type(pm_dev_t type, pm_request_t rqst, void *data);
 int 
 pm_sys_suspend(void)
 {
+	struct timeval t0, t1;
 	int ret;
 
 	DPRINTK("In "__FUNCTION__"\n");
@@ -44,6 +47,7 @@ pm_sys_suspend(void)
 	ret = pm_do_suspend();
 	//pm_access(pm_dev);
 	
+	do_gettimeofday(&t0);
 #if 0
 	ret = pm_send_all_type(PM_USER_DEV, PM_RESUME, (void *)0);
 #else
@@ -52,6 +56,11 @@ pm_sys_suspend(void)
 		printk("Warning. Somewrong while wakeup the system");
 	}
 #endif
+	do_gettimeofday(&t1);
+	pm_resume_dev_usec = (t1.tv_sec - t0.tv_sec) * 1000000 +
+		(t1.tv_usec - t0.tv_usec);
+	DPRINTK("resume: core %lu us, devices %lu us\n",
+		pm_resume_core_usec, pm_resume_dev_usec);
 
 	event_notify(SYSTEM_WAKEUP);
 
@@ -30,6 +30,7 @@
 #include <linux/poll.h>
 #include <linux/circ_buf.h>
 #include <linux/timer.h>
+#include <linux/proc_fs.h>
 
 #include <asm/io.h>
 #include <asm/semaphore.h>
@@ -90,9 +91,8 @@ static wait_queue_head_t wq_read;
 static wait_queue_head_t wq_write;
 static wait_queue_head_t wq_poll;
 
-/* Serialze multiple writers onto the transmit hardware
-.. since we sleep the writer during transmit to stay in
-.. sync. (Multiple writers don't make much sense, but..) */
+/* Serialze multiple writers onto the transmit ring.
+.. (Multiple writers don't make much sense, but..) */
 static DECLARE_MUTEX( xmit_sem );
 
 // size of usb DATA0/1 packets. 64 is standard maximum
@@ -100,27 +100,48 @@ static DECLARE_MUTEX( xmit_sem );
 // to handle larger.
 #define TX_PACKET_SIZE 64
 #define RX_PACKET_SIZE 64
-#define RBUF_SIZE  (4*PAGE_SIZE)
+
+// Ring sizes in pages, rounded up to a power of two. The receiver
+// posts whole runs of free ring space to the core, so a bigger ring
+// means longer multi-packet receives and fewer NAKs to the host.
+static int rx_ring_pages = 16;
+static int tx_ring_pages = 8;
+MODULE_PARM( rx_ring_pages, "i" );
+MODULE_PARM_DESC( rx_ring_pages, "receive ring size in pages" );
+MODULE_PARM( tx_ring_pages, "i" );
+MODULE_PARM_DESC( tx_ring_pages, "transmit ring size in pages" );
+
+#define RBUF_SIZE  rx_ring.size
+#define TBUF_SIZE  tx_ring.size
+
+// largest single transfer handed to the core
+#define RX_CHUNK_MAX	(16*RX_PACKET_SIZE)
+#define TX_CHUNK_MAX	(64*TX_PACKET_SIZE)
 
 static struct wcirc_buf {
   char *buf;
   int in;
   int out;
-} rx_ring = { NULL, 0, 0 };
+  int size;
+  int order;
+} rx_ring = { NULL, 0, 0, 0, 0 }, tx_ring = { NULL, 0, 0, 0, 0 };
 
 static struct {
 	 unsigned long  cnt_rx_complete;
 	 unsigned long  cnt_rx_errors;
 	 unsigned long  bytes_rx;
+	 unsigned long  cnt_tx_complete;
 	 unsigned long  cnt_tx_timeouts;
 	 unsigned long  cnt_tx_errors;
 	 unsigned long  bytes_tx;
+	 unsigned long  rx_first, rx_last;	/* jiffies of first/last data */
+	 unsigned long  tx_first, tx_last;
 } charstats;
 
 
-static char * tx_buf = NULL;
 static char * packet_buffer = NULL;
-static int sending = 0;
+static int rx_bounce = 0;	/* current receive went to packet_buffer */
+static int sending = 0;		/* bytes of tx_ring on the hardware */
 static int usb_ref_count = 0;
 static int last_tx_result = 0;
 static int last_rx_result = 0;
@@ -141,6 +162,7 @@ static void     rx_done_callback_packet_buffer( int flag, int size );
 
 static void     tx_timeout( unsigned long );
 static void     tx_done_callback( int flag, int size );
+static void     kick_start_tx( void );
 
 static ssize_t  usbc_read( struct file *, char *, size_t, loff_t * );
 static ssize_t  usbc_write( struct file *, const char *, size_t, loff_t * );
@@ -220,19 +242,35 @@ static void free_txrx_buffers( void )
 {
 	PRINTK("\n");
 	 if ( rx_ring.buf != NULL ) {
-		  kfree( rx_ring.buf );
+		  free_pages( (unsigned long) rx_ring.buf, rx_ring.order );
 		  rx_ring.buf = NULL;
 	 }
 	 if ( packet_buffer != NULL ) {
 		  kfree( packet_buffer );
 		  packet_buffer = NULL;
 	 }
-	 if ( tx_buf != NULL ) {
-		  kfree( tx_buf );
-		  tx_buf = NULL;
+	 if ( tx_ring.buf != NULL ) {
+		  free_pages( (unsigned long) tx_ring.buf, tx_ring.order );
+		  tx_ring.buf = NULL;
 	 }
 }
 
+static int alloc_ring( struct wcirc_buf * ring, int pages, int gfp )
+{
+	 ring->order = get_order( pages * PAGE_SIZE );
+	 ring->buf = (char *) __get_free_pages( gfp, ring->order );
+	 ring->size = ring->buf ? PAGE_SIZE << ring->order : 0;
+	 ring->in = ring->out = 0;
+	 return ring->buf ? 0 : -ENOMEM;
+}
+
+static inline void stamp_rate( unsigned long * first, unsigned long * last )
+{
+	 if ( *first == 0 )
+		  *first = jiffies;
+	 *last = jiffies;
+}
+
 /* twiddle_descriptors()
  * It is between open() and start(). Setup descriptors.
  */
@@ -322,19 +360,34 @@ static  void kick_start_rx( void )
 	 if ( usb_ref_count ) {
 #endif
 		  int total_space  = CIRC_SPACE( rx_ring.in, rx_ring.out, RBUF_SIZE );
+		  int to_end = CIRC_SPACE_TO_END( rx_ring.in, rx_ring.out, RBUF_SIZE );
+		  int old_bounce = rx_bounce;
 //	     		PRINTK("total_space = %d, %d\n", total_space, RX_PACKET_SIZE);
-		  if ( total_space >= RX_PACKET_SIZE ) {
-			   s3c2410_usb_recv( packet_buffer,
-								RX_PACKET_SIZE,
-								rx_done_callback_packet_buffer
-						      );
+		  /*
+		   * rx_bounce is set up front: with a packet already waiting
+		   * the completion callback runs inside s3c2410_usb_recv().
+		   */
+		  if ( to_end >= RX_PACKET_SIZE ) {
+			   /* receive straight into the ring, many packets at once */
+			   int n = MIN( to_end, RX_CHUNK_MAX ) & ~(RX_PACKET_SIZE-1);
+			   rx_bounce = 0;
+			   if ( s3c2410_usb_recv( &rx_ring.buf[ rx_ring.in ], n,
+						  rx_done_callback_packet_buffer ) )
+				    rx_bounce = old_bounce;
+		  } else if ( total_space >= RX_PACKET_SIZE ) {
+			   /* a packet may straddle the end of the ring */
+			   rx_bounce = 1;
+			   if ( s3c2410_usb_recv( packet_buffer,
+						  RX_PACKET_SIZE,
+						  rx_done_callback_packet_buffer ) )
+				    rx_bounce = old_bounce;
 		  }
 	 }
 }
 /*
  * rx_done_callback_packet_buffer()
- * We have completed a DMA xfer into the temp packet buffer.
- * Move to ring.
+ * We have completed a receive, either straight into the ring or
+ * (around the wrap point) into the temp packet buffer.
  *
  * flag values:
  * on init,  -EAGAIN
@@ -352,15 +405,20 @@ rx_done_callback_packet_buffer( int flag, int size )
 		  size_t n;
 
 		  charstats.bytes_rx += size;
-
-		  n = CIRC_SPACE_TO_END( rx_ring.in, rx_ring.out, RBUF_SIZE );
-		  n = MIN( n, size );
-		  size -= n;
-
-		  memcpy( &rx_ring.buf[ rx_ring.in ], packet_buffer, n );
-		  rx_ring.in = (rx_ring.in + n) & (RBUF_SIZE-1);
-		  memcpy( &rx_ring.buf[ rx_ring.in ], packet_buffer + n, size );
-		  rx_ring.in = (rx_ring.in + size) & (RBUF_SIZE-1);
+		  stamp_rate( &charstats.rx_first, &charstats.rx_last );
+
+		  if ( !rx_bounce ) {
+			   rx_ring.in = (rx_ring.in + size) & (RBUF_SIZE-1);
+		  } else {
+			   n = CIRC_SPACE_TO_END( rx_ring.in, rx_ring.out, RBUF_SIZE );
+			   n = MIN( n, size );
+			   size -= n;
+
+			   memcpy( &rx_ring.buf[ rx_ring.in ], packet_buffer, n );
+			   rx_ring.in = (rx_ring.in + n) & (RBUF_SIZE-1);
+			   memcpy( &rx_ring.buf[ rx_ring.in ], packet_buffer + n, size );
+			   rx_ring.in = (rx_ring.in + size) & (RBUF_SIZE-1);
+		  }
 
 		  wake_up_interruptible( &wq_read );
 		  wake_up_interruptible( &wq_poll );
@@ -382,25 +440,74 @@ rx_done_callback_packet_buffer( int flag, int size )
 
 static void tx_timeout( unsigned long unused )
 {
+	unsigned long flags;
+
+	if ( sending == 0 ) {	/* retry a send the core refused */
+		 local_irq_save( flags );
+		 kick_start_tx();
+		 local_irq_restore( flags );
+		 return;
+	}
 	PRINTK( "%stx timeout\n", pszMe );
 	s3c2410_usb_send_reset();
 	charstats.cnt_tx_timeouts++;
 }
 
 
+/*
+ * kick_start_tx()
+ * Hand the next contiguous run of the transmit ring to the core. The
+ * core splits it into packets itself; writers only wait for ring
+ * space, so several writes can be queued while one is on the wire.
+ * Called with interrupts disabled.
+ */
+static void kick_start_tx( void )
+{
+	 int n, rc;
+
+	 if ( sending || tx_ring.buf == NULL )
+		  return;
+
+	 n = CIRC_CNT_TO_END( tx_ring.in, tx_ring.out, TBUF_SIZE );
+	 if ( n == 0 )
+		  return;
+	 n = MIN( n, TX_CHUNK_MAX );
+
+	 sending = n;
+	 rc = s3c2410_usb_send( &tx_ring.buf[ tx_ring.out ], n, tx_done_callback );
+	 if ( rc < 0 ) {
+		  /* endpoint busy or not configured yet: try again shortly */
+		  sending = 0;
+		  mod_timer( &tx_timer, jiffies + HZ / 10 );
+		  return;
+	 }
+	 mod_timer( &tx_timer, jiffies + ( HZ * 5 ) );
+}
+
 // on init, -EAGAIN
 // on reset, -EINTR
 // on TPE, -EIO
 static void tx_done_callback( int flags, int size )
 {
 	PRINTK("\n");
-	 if ( flags == 0 )
+	 if ( sending == 0 )	/* init: nothing of ours on the hardware */
+		  return;
+
+	 del_timer( &tx_timer );
+	 if ( flags == 0 ) {
 		  charstats.bytes_tx += size;
-	 else
+		  charstats.cnt_tx_complete++;
+		  stamp_rate( &charstats.tx_first, &charstats.tx_last );
+		  tx_ring.out = ( tx_ring.out + size ) & (TBUF_SIZE-1);
+	 } else {
+		  /* transmitter was reset: drop whatever is still queued */
 		  charstats.cnt_tx_errors++;
+		  tx_ring.out = tx_ring.in;
+	 }
 	 last_tx_size = size;
 	 last_tx_result = flags;
 	 sending = 0;
+	 kick_start_tx();
 	 wake_up_interruptible( &wq_write );
 	 wake_up_interruptible( &wq_poll );
 }
@@ -414,13 +521,11 @@ static void tx_done_callback( int flags, int size )
 static void usbc_alloc_mem(void)
 {
 	PRINTK("\n");
-	tx_buf = (char*) kmalloc( TX_PACKET_SIZE, GFP_KERNEL | GFP_DMA );
-	if ( tx_buf == NULL ) {
+	if ( alloc_ring( &tx_ring, tx_ring_pages, GFP_KERNEL | GFP_DMA ) ) {
 		PRINTK( "%sARGHH! COULD NOT ALLOCATE TX BUFFER\n", pszMe );
 	}
 
-	rx_ring.buf = (char*) kmalloc( RBUF_SIZE, GFP_KERNEL );
-	if ( rx_ring.buf == NULL ) {
+	if ( alloc_ring( &rx_ring, rx_ring_pages, GFP_KERNEL ) ) {
 		PRINTK( "%sARGHH! COULD NOT ALLOCATE RX BUFFER\n", pszMe );
 	}
 
@@ -528,86 +633,84 @@ static ssize_t usbc_read( struct file *pFile, char *pUserBuffer,
 }
 
 /*
- * Write endpoint. This routine attempts to break the passed in buffer
- * into usb DATA0/1 packet size chunks and send them to the host.
- * (The lower-level driver tries to do this too, but easier for us
- * to manage things here.)
+ * Write endpoint. Data is copied into the transmit ring and the call
+ * returns as soon as it is queued; kick_start_tx() and the completion
+ * routine keep the core fed with multi-packet transfers from the ring.
  *
  * We are at the mercy of the host here, in that it must send an IN
- * token to us to pull this data back, so hopefully some higher level
- * protocol is expecting traffic to flow in that direction so the host
- * is actually polling us. To guard against hangs, a 5 second timeout
- * is used.
- *
- * This routine takes some care to only report bytes sent that have
- * actually made it across the wire. Thus we try to stay in lockstep
- * with the completion routine and only have one packet on the xmit
- * hardware at a time. Multiple simultaneous writers will get
- * "undefined" results.
- *
-  */
+ * token to us to pull this data back. To guard against hangs, a 5
+ * second timeout per transfer resets the transmitter, which drops the
+ * queued data and reports the error to the next write().
+ */
 static ssize_t  usbc_write( struct file *pFile, const char * pUserBuffer,
 							 size_t stCount, loff_t *pPos )
 {
 	 ssize_t retval = 0;
 	 ssize_t stSent = 0;
+	 int flags;
 
 	 DECLARE_WAITQUEUE( wait, current );
 
 	 PRINTK( KERN_DEBUG "%swrite() %d bytes\n", pszMe, stCount );
 
-	 down( &xmit_sem );  // only one thread onto the hardware at a time
+	 if ( s3c2410_usb_xmitter_avail() == -ENODEV )
+		  return -ENODEV;
+
+	 down( &xmit_sem );  // only one thread into the ring at a time
 
+	 local_irq_save( flags );
+	 if ( last_tx_result && last_tx_result != -EAGAIN ) {
+		  retval = last_tx_result;
+		  last_tx_result = 0;
+	 }
+	 local_irq_restore( flags );
+
+	 add_wait_queue( &wq_write, &wait );
 	 while( stCount != 0 && retval == 0 ) {
-		  int nThisTime  = MIN( TX_PACKET_SIZE, stCount );
-		  copy_from_user( tx_buf, pUserBuffer, nThisTime );
-		  sending = nThisTime;
- 		  retval = s3c2410_usb_send( tx_buf, nThisTime, tx_done_callback );
-		  if ( retval < 0 ) {
-#ifndef CONFIG_MIZI
-			   char * p = what_the_f( retval );
-			   printk( "%sCould not queue xmission. rc=%d - %s\n",
-					   pszMe, retval, p );
-#endif
-			   sending = 0;
-			   break;
-		  }
-		  /* now have something on the diving board */
-		  add_wait_queue( &wq_write, &wait );
-		  tx_timer.expires = jiffies + ( HZ * 5 );
-		  add_timer( &tx_timer );
-		  while( 1 ) {
-			   set_current_state( TASK_INTERRUPTIBLE );
-			   if ( sending == 0 ) {  /* it jumped into the pool */
-					del_timer( &tx_timer );
-					retval = last_tx_result;
-					if ( retval == 0 ) {
-						 stSent		 += last_tx_size;
-						 pUserBuffer += last_tx_size;
-						 stCount     -= last_tx_size;
-					}
-#ifndef CONFIG_MIZI
-					else
-						 printk( "%sxmission error rc=%d - %s\n",
-								 pszMe, retval, what_the_f(retval) );
-#endif
+		  int space, to_end, n;
+
+		  set_current_state( TASK_INTERRUPTIBLE );
+
+		  local_irq_save( flags );
+		  space  = CIRC_SPACE( tx_ring.in, tx_ring.out, TBUF_SIZE );
+		  to_end = CIRC_SPACE_TO_END( tx_ring.in, tx_ring.out, TBUF_SIZE );
+		  local_irq_restore( flags );
+
+		  if ( space == 0 ) {
+			   if ( stSent || ( pFile->f_flags & O_NONBLOCK ) ) {
+					if ( stSent == 0 )
+						 retval = -EAGAIN;
 					break;
 			   }
-			   else if ( signal_pending( current ) ) {
-					del_timer( &tx_timer );
-					PRINTK( "%ssignal\n", pszMe  );
+			   if ( signal_pending( current ) ) {
 					retval = -ERESTARTSYS;
 					break;
 			   }
 			   schedule();
+			   continue;
 		  }
 		  set_current_state( TASK_RUNNING );
-		  remove_wait_queue( &wq_write, &wait );
+
+		  n = MIN( to_end, stCount );
+		  if ( copy_from_user( &tx_ring.buf[ tx_ring.in ], pUserBuffer, n ) ) {
+			   retval = -EFAULT;
+			   break;
+		  }
+		  pUserBuffer += n;
+		  stCount     -= n;
+		  stSent      += n;
+
+		  local_irq_save( flags );
+		  tx_ring.in = ( tx_ring.in + n ) & (TBUF_SIZE-1);
+		  kick_start_tx();
+		  local_irq_restore( flags );
 	 }
+	 set_current_state( TASK_RUNNING );
+	 remove_wait_queue( &wq_write, &wait );
 
 	 up( &xmit_sem );
 
-	 if ( 0 == retval )
+	 if ( stSent )
 		  retval = stSent;
 	 return retval;
 }
@@ -622,7 +725,7 @@ static unsigned int usbc_poll( struct file *pFile, poll_table * pWait )
 
 	 if ( CIRC_CNT( rx_ring.in, rx_ring.out, RBUF_SIZE ) )
 		  retval |= POLLIN | POLLRDNORM;
-	 if ( s3c2410_usb_xmitter_avail() )
+	 if ( CIRC_SPACE( tx_ring.in, tx_ring.out, TBUF_SIZE ) )
 		  retval |= POLLOUT | POLLWRNORM;
 	 return retval;
 }
@@ -631,22 +734,35 @@ static int usbc_ioctl( struct inode *pInode, struct file *pFile,
                        unsigned int nCmd, unsigned long argument )
 {
 	 int retval = 0;
+	 unsigned long flags;
 
 	 switch( nCmd ) {
 
 	 case USBC_IOC_FLUSH_RECEIVER:
 		  s3c2410_usb_recv_reset();
+		  local_irq_save( flags );
 		  rx_ring.in = rx_ring.out = 0;
+		  local_irq_restore( flags );
 		  break;
 
 	 case USBC_IOC_FLUSH_TRANSMITTER:
 		  s3c2410_usb_send_reset();
+		  local_irq_save( flags );
+		  tx_ring.in = tx_ring.out = 0;
+		  local_irq_restore( flags );
 		  break;
 
 	 case USBC_IOC_FLUSH_ALL:
 		  s3c2410_usb_recv_reset();
-		  rx_ring.in = rx_ring.out = 0;
 		  s3c2410_usb_send_reset();
+		  local_irq_save( flags );
+		  rx_ring.in = rx_ring.out = 0;
+		  tx_ring.in = tx_ring.out = 0;
+		  local_irq_restore( flags );
+		  break;
+
+	 case USBC_IOC_RESET_STATS:
+		  memset( &charstats, 0, sizeof( charstats ) );
 		  break;
 
 	 default:
@@ -658,6 +774,55 @@ static int usbc_ioctl( struct inode *pInode, struct file *pFile,
 }
 
 
+#ifdef CONFIG_PROC_FS
+/* KB/s over the span between the first and the last transfer */
+static unsigned long usbc_rate( unsigned long bytes,
+				unsigned long first, unsigned long last )
+{
+	 unsigned long ticks = last - first;
+
+	 if ( first == 0 || ticks == 0 )
+		  return 0;
+	 return ( bytes >> 10 ) * HZ / ticks;
+}
+
+static int usbc_read_proc( char *page, char **start, off_t off,
+			   int count, int *eof, void *data )
+{
+	 char * p = page;
+	 unsigned long rx_rate, tx_rate;
+	 int len;
+
+	 rx_rate = usbc_rate( charstats.bytes_rx, charstats.rx_first,
+			      charstats.rx_last );
+	 tx_rate = usbc_rate( charstats.bytes_tx, charstats.tx_first,
+			      charstats.tx_last );
+
+	 p += sprintf( p, "%25.25s: %d / %d\n", "rx ring size/used",
+		       RBUF_SIZE, CIRC_CNT( rx_ring.in, rx_ring.out, RBUF_SIZE ) );
+	 p += sprintf( p, "%25.25s: %d / %d\n", "tx ring size/used",
+		       TBUF_SIZE, CIRC_CNT( tx_ring.in, tx_ring.out, TBUF_SIZE ) );
+	 p += sprintf( p, "%25.25s: %lu\n", "rx transfers", charstats.cnt_rx_complete );
+	 p += sprintf( p, "%25.25s: %lu\n", "rx errors", charstats.cnt_rx_errors );
+	 p += sprintf( p, "%25.25s: %lu\n", "rx bytes", charstats.bytes_rx );
+	 p += sprintf( p, "%25.25s: %lu KB/s (%lu.%02lu MB/s)\n", "rx rate", rx_rate,
+		       rx_rate >> 10, ( ( rx_rate & 1023 ) * 100 ) >> 10 );
+	 p += sprintf( p, "%25.25s: %lu\n", "tx transfers", charstats.cnt_tx_complete );
+	 p += sprintf( p, "%25.25s: %lu\n", "tx errors", charstats.cnt_tx_errors );
+	 p += sprintf( p, "%25.25s: %lu\n", "tx timeouts", charstats.cnt_tx_timeouts );
+	 p += sprintf( p, "%25.25s: %lu\n", "tx bytes", charstats.bytes_tx );
+	 p += sprintf( p, "%25.25s: %lu KB/s (%lu.%02lu MB/s)\n", "tx rate", tx_rate,
+		       tx_rate >> 10, ( ( tx_rate & 1023 ) * 100 ) >> 10 );
+
+	 len = ( p - page ) - off;
+	 if ( len < 0 )
+		  len = 0;
+	 *eof = ( len <= count ) ? 1 : 0;
+	 *start = page + off;
+	 return len;
+}
+#endif
+
 #ifdef CONFIG_MIZI
 static int
 usbc_activate(void)
@@ -760,6 +925,10 @@ int __init usbc_init( void )
 	 init_timer( &tx_timer );
 	 tx_timer.function = tx_timeout;
 
+#ifdef CONFIG_PROC_FS
+	 create_proc_read_entry( "usbchar", 0, NULL, usbc_read_proc, NULL );
+#endif
+
 #ifdef CONFIG_MIZI
 	memset( &charstats, 0, sizeof( charstats ) );
 	sending = 0;
@@ -790,6 +959,9 @@ void __exit usbc_exit( void )
 	if (usb_char_pm_dev)
 		pm_unregister(usb_char_pm_dev);
 #endif 
+#endif
+#ifdef CONFIG_PROC_FS
+	remove_proc_entry( "usbchar", NULL );
 #endif
 	misc_deregister( &usbc_misc_device );
 }
@@ -25,5 +25,8 @@
 /* do both of above */
 #define USBC_IOC_FLUSH_ALL         _IO( USBC_MAGIC, 0x03 )
 
+/* zero the transfer counters shown in /proc/usbchar */
+#define USBC_IOC_RESET_STATS       _IO( USBC_MAGIC, 0x04 )
+
 #endif /* _USB_CHAR_H */
 
@@ -46,10 +46,20 @@ ep1_dma_callback(void *buf_id, int size)
 #endif
 }
 
+static void ep1_rx_packets(void);
+
 static void
 ep1_start(void)
 {
 	LOG("\n");
+
+	/*
+	 * A packet that arrived while no buffer was posted has been left
+	 * in the FIFO (the host is being NAKed meanwhile); pick it up now.
+	 */
+	UD_INDEX = UD_INDEX_EP1;
+	if (UD_OCSR1 & UD_OCSR1_PKTRDY)
+		ep1_rx_packets();
 #if 0
 	s3c2410_dma_flush_all(dmachn_rx);
 	if (!ep1_curdmalen) {
@@ -132,6 +142,61 @@ ep1_reset(void)
 	ep1_done(-EINTR);
 }
 
+static inline void
+ep1_read_fifo(unsigned char *buf, int len)
+{
+	while (len >= 4) {
+		buf[0] = (u_char) UD_FIFO1;
+		buf[1] = (u_char) UD_FIFO1;
+		buf[2] = (u_char) UD_FIFO1;
+		buf[3] = (u_char) UD_FIFO1;
+		buf += 4;
+		len -= 4;
+	}
+	while (len--)
+		*buf++ = (u_char) UD_FIFO1;
+}
+
+/*
+ * Move every packet waiting in the OUT FIFO straight into the client
+ * buffer, so one request covers many packets.  The request completes
+ * once the FIFO runs dry, on a short packet, or when the next packet
+ * would not fit; such a packet stays in the FIFO until the client
+ * posts a new buffer.
+ */
+static void
+ep1_rx_packets(void)
+{
+	int recv_cnt, len = 0;
+
+	if (!ep1_len)
+		return;
+
+	UD_INDEX = UD_INDEX_EP1;
+	while (UD_OCSR1 & UD_OCSR1_PKTRDY) {
+		UD_INDEX = UD_INDEX_EP1;
+		recv_cnt = ((UD_OFCNTH << 8) | UD_OFCNTL) &0xffff;
+		LOG("recv_count = %d\n", recv_cnt);
+
+		if (recv_cnt > ep1_remain)
+			break;
+
+		ep1_read_fifo(ep1_buf + (ep1_len - ep1_remain), recv_cnt);
+		ep1_remain -= recv_cnt;
+		len += recv_cnt;
+
+		UD_INDEX = UD_INDEX_EP1;
+		UD_OCSR1 &= ~UD_OCSR1_PKTRDY;
+
+		if (recv_cnt < rx_pktsize || ep1_remain < rx_pktsize)
+			break;
+		UD_INDEX = UD_INDEX_EP1;
+	}
+
+	if (len)
+		ep1_done(0);
+}
+
 void
 ep1_int_hndlr(int udcsr)
 {
@@ -158,29 +223,16 @@ ep1_int_hndlr(int udcsr)
 	if (status & UD_OCSR1_PKTRDY) { /* sa Receive Packet Complete, s3c2410 . OPR ̿Ѵ. */
 		LOG("ep1_len=%x\n",ep1_len);
 	    
+		/*
+		 * No buffer posted (client ring full): leave the packet in
+		 * the FIFO so the host is NAKed instead of losing data.
+		 * ep1_start() collects it.
+		 */
 		if (!ep1_len) {
-			printk("usb_recv: RPC for non-existent buffer\n");
-			UD_INDEX = UD_INDEX_EP1;
-			UD_OCSR1 |= UD_OCSR1_FFLUSH;
-			//udelay(20);
-			UD_INDEX = UD_INDEX_EP1;
-			UD_OCSR1 &= ~UD_OCSR1_PKTRDY;
+			LOG("RPC for non-existent buffer\n");
 			return;
 		}
-		UD_INDEX = UD_INDEX_EP1;
-		recv_cnt = ((UD_OFCNTH << 8) | UD_OFCNTL) &0xffff;
-		LOG("recv_count = %d\n", recv_cnt);
-
-		for (len = 0; len < recv_cnt; len++) {
-		    ep1_buf[len] = (u_char) UD_FIFO1;
-		    LOG("ep1_buf[%d]=%x\n", len, ep1_buf[len]);
-		}
-
-
-		ep1_remain -= recv_cnt;
-		ep1_done(0);
-		UD_INDEX = UD_INDEX_EP1;
-		UD_OCSR1 &= ~UD_OCSR1_PKTRDY;
+		ep1_rx_packets();
 
 #if 0
 
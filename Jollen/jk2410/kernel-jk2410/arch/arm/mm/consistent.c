@@ -31,8 +31,12 @@
  * here is not interrupt context safe.
  *
  * Note that this does *not* zero the allocated area!
+ *
+ * "flags" are the extra L_PTE_ bits for the mapping: none gives uncached,
+ * unbuffered memory.
  */
-void *consistent_alloc(int gfp, size_t size, dma_addr_t *dma_handle)
+static void *__consistent_alloc(int gfp, size_t size, dma_addr_t *dma_handle,
+				unsigned long flags)
 {
 	struct page *page, *end, *free;
 	unsigned long order;
@@ -53,7 +57,7 @@ void *consistent_alloc(int gfp, size_t size, dma_addr_t *dma_handle)
 	 */
 	virt = page_address(page);
 	*dma_handle = virt_to_bus(virt);
-	ret = __ioremap(virt_to_phys(virt), size, 0);
+	ret = __ioremap(virt_to_phys(virt), size, flags);
 	if (!ret)
 		goto no_remap;
 
@@ -91,6 +95,23 @@ no_page:
 	return NULL;
 }
 
+void *consistent_alloc(int gfp, size_t size, dma_addr_t *dma_handle)
+{
+	return __consistent_alloc(gfp, size, dma_handle, 0);
+}
+
+/*
+ * As consistent_alloc(), but the mapping is bufferable: CPU writes are
+ * merged in the write buffer instead of going out one at a time.  For
+ * buffers the CPU fills and a device only reads after being started by
+ * a register write, such as frame buffers and audio DMA buffers.  It is
+ * freed with consistent_free().
+ */
+void *consistent_alloc_writecombine(int gfp, size_t size, dma_addr_t *dma_handle)
+{
+	return __consistent_alloc(gfp, size, dma_handle, L_PTE_BUFFERABLE);
+}
+
 void *pci_alloc_consistent(struct pci_dev *hwdev, size_t size, dma_addr_t *handle)
 {
 	void *__ret;
@@ -0,0 +1,387 @@
+/*
+ *  linux/arch/arm/mm/dmapool.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *  Pools of small DMA-consistent blocks for descriptors and the like.
+ *
+ *  Each pool carves pages from consistent_alloc() (or its write-combining
+ *  variant) into fixed size blocks.  The free blocks of a page are chained
+ *  through their first word, so allocating and freeing a block is O(1),
+ *  and pages with free blocks are kept at the front of the pool's list so
+ *  that the first page looked at always has one.  Pages are not given back
+ *  until the pool is destroyed: consistent_free() can't be called from
+ *  interrupts, and a driver that needed the page once will need it again.
+ *
+ *  Derived from the pci_pool allocator in drivers/pci/pci.c.
+ */
+#include <linux/config.h>
+#include <linux/module.h>
+#include <linux/types.h>
+#include <linux/kernel.h>
+#include <linux/sched.h>
+#include <linux/string.h>
+#include <linux/init.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/interrupt.h>
+#include <linux/proc_fs.h>
+
+#include <asm/io.h>
+#include <asm/page.h>
+#include <asm/ptrace.h>
+#include <asm/system.h>
+#include <asm/dmapool.h>
+
+struct dma_pool {
+	struct list_head	page_list;	/* pages with free blocks first */
+	struct list_head	pools;		/* on dma_pools */
+	spinlock_t		lock;
+	size_t			size;
+	size_t			allocation;	/* bytes per page */
+	size_t			boundary;
+	int			flags;
+	char			name[32];
+	wait_queue_head_t	waitq;
+	unsigned long		nr_pages;
+	unsigned long		nr_blocks;	/* blocks in use */
+	unsigned long		nr_allocs;
+};
+
+struct dma_page {	/* cacheable header for 'allocation' bytes */
+	struct list_head	page_list;
+	void			*vaddr;
+	dma_addr_t		dma;
+	unsigned int		in_use;
+	unsigned int		offset;		/* first free block */
+};
+
+#define	POOL_TIMEOUT_JIFFIES	((100 /* msec */ * HZ) / 1000)
+#define	POOL_POISON_BYTE	0xa7
+
+static LIST_HEAD(dma_pools);
+static spinlock_t dma_pools_lock = SPIN_LOCK_UNLOCKED;
+
+/**
+ * dma_pool_create - create a pool of consistent memory blocks for DMA
+ * @name: name of pool, for diagnostics
+ * @size: size of the blocks in this pool
+ * @align: alignment requirement for blocks; must be a power of two
+ * @boundary: returned blocks won't cross this boundary (or zero)
+ * @flags: DMA_POOL_POISON and/or DMA_POOL_WRITECOMBINE
+ *
+ * Returns a pool with the requested characteristics, or null if one
+ * can't be created.  The blocks have consistent DMA mappings, accessible
+ * by the device and its driver without cache flushing; with
+ * DMA_POOL_WRITECOMBINE, CPU writes may sit in the write buffer until
+ * the next uncached access.  The actual size of the blocks may be larger
+ * than requested because of alignment.
+ */
+struct dma_pool *
+dma_pool_create(const char *name, size_t size, size_t align, size_t boundary,
+		int flags)
+{
+	struct dma_pool *pool;
+	size_t allocation;
+
+	if (align == 0)
+		align = 1;
+	if (size == 0)
+		return NULL;
+	if (size < sizeof(unsigned int))
+		size = sizeof(unsigned int);
+	size = (size + align - 1) & ~(align - 1);
+
+	allocation = PAGE_ALIGN(size);
+	if (boundary == 0)
+		boundary = allocation;
+	else if (boundary < size || (boundary & (boundary - 1)))
+		return NULL;
+	if (boundary > allocation)
+		boundary = allocation;
+
+	pool = kmalloc(sizeof(*pool), GFP_KERNEL);
+	if (!pool)
+		return NULL;
+
+	strncpy(pool->name, name, sizeof(pool->name));
+	pool->name[sizeof(pool->name) - 1] = 0;
+
+	INIT_LIST_HEAD(&pool->page_list);
+	spin_lock_init(&pool->lock);
+	pool->size = size;
+	pool->allocation = allocation;
+	pool->boundary = boundary;
+	pool->flags = flags;
+	init_waitqueue_head(&pool->waitq);
+	pool->nr_pages = 0;
+	pool->nr_blocks = 0;
+	pool->nr_allocs = 0;
+
+	spin_lock(&dma_pools_lock);
+	list_add_tail(&pool->pools, &dma_pools);
+	spin_unlock(&dma_pools_lock);
+
+	return pool;
+}
+
+/*
+ * Chain the blocks of a new page, skipping the tail of each boundary
+ * that a block would straddle.
+ */
+static void pool_init_page(struct dma_pool *pool, struct dma_page *page)
+{
+	unsigned int offset = 0;
+	unsigned int next_boundary = pool->boundary;
+
+	do {
+		unsigned int next = offset + pool->size;
+
+		if (next + pool->size > next_boundary) {
+			next = next_boundary;
+			next_boundary += pool->boundary;
+		} else if (next + pool->size > pool->allocation)
+			next = pool->allocation;	/* no room for another */
+		*(unsigned int *)(page->vaddr + offset) = next;
+		offset = next;
+	} while (offset < pool->allocation);
+}
+
+static struct dma_page *pool_alloc_page(struct dma_pool *pool, int mem_flags)
+{
+	struct dma_page *page;
+	int gfp;
+
+	if (mem_flags != SLAB_KERNEL) {
+		unsigned long flags;
+
+		/* consistent_alloc() maps the page, which may sleep */
+		__save_flags(flags);
+		if (flags & I_BIT)
+			return NULL;
+		gfp = GFP_ATOMIC | GFP_DMA;
+	} else
+		gfp = GFP_KERNEL | GFP_DMA;
+
+	page = kmalloc(sizeof(*page), mem_flags);
+	if (!page)
+		return NULL;
+
+	if (pool->flags & DMA_POOL_WRITECOMBINE)
+		page->vaddr = consistent_alloc_writecombine(gfp,
+						pool->allocation, &page->dma);
+	else
+		page->vaddr = consistent_alloc(gfp,
+						pool->allocation, &page->dma);
+	if (!page->vaddr) {
+		kfree(page);
+		return NULL;
+	}
+
+	if (pool->flags & DMA_POOL_POISON)
+		memset(page->vaddr, POOL_POISON_BYTE, pool->allocation);
+	pool_init_page(pool, page);
+	page->in_use = 0;
+	page->offset = 0;
+	return page;
+}
+
+static void pool_free_page(struct dma_pool *pool, struct dma_page *page)
+{
+	consistent_free(page->vaddr, pool->allocation, page->dma);
+	list_del(&page->page_list);
+	kfree(page);
+}
+
+/**
+ * dma_pool_destroy - destroy a pool of DMA memory blocks
+ * @pool: the pool to destroy
+ *
+ * Caller guarantees that no more memory from the pool is in use,
+ * and that nothing will try to use the pool after this call.
+ */
+void dma_pool_destroy(struct dma_pool *pool)
+{
+	spin_lock(&dma_pools_lock);
+	list_del(&pool->pools);
+	spin_unlock(&dma_pools_lock);
+
+	while (!list_empty(&pool->page_list)) {
+		struct dma_page *page;
+
+		page = list_entry(pool->page_list.next, struct dma_page, page_list);
+		if (page->in_use) {
+			printk(KERN_ERR "dma_pool_destroy %s, %p busy\n",
+			       pool->name, page->vaddr);
+			/* leak the still-in-use consistent memory */
+			list_del(&page->page_list);
+			kfree(page);
+		} else
+			pool_free_page(pool, page);
+	}
+	kfree(pool);
+}
+
+/**
+ * dma_pool_alloc - get a block of consistent memory
+ * @pool: the pool that will produce the block
+ * @mem_flags: SLAB_KERNEL or SLAB_ATOMIC
+ * @handle: pointer to dma address of block
+ *
+ * This returns the kernel virtual address of a currently unused block,
+ * and reports its dma address through the handle.  The pool can only
+ * grow outside interrupt context, and for SLAB_ATOMIC callers only with
+ * interrupts enabled; if no block can be had, null is returned.
+ */
+void *dma_pool_alloc(struct dma_pool *pool, int mem_flags, dma_addr_t *handle)
+{
+	unsigned long flags;
+	struct dma_page *page;
+	unsigned int offset;
+	void *retval;
+
+restart:
+	spin_lock_irqsave(&pool->lock, flags);
+	if (!list_empty(&pool->page_list)) {
+		page = list_entry(pool->page_list.next, struct dma_page, page_list);
+		if (page->offset < pool->allocation)
+			goto ready;
+	}
+	spin_unlock_irqrestore(&pool->lock, flags);
+
+	if (in_interrupt())
+		return NULL;
+
+	page = pool_alloc_page(pool, mem_flags);
+	if (!page) {
+		if (mem_flags == SLAB_KERNEL) {
+			DECLARE_WAITQUEUE(wait, current);
+
+			current->state = TASK_INTERRUPTIBLE;
+			add_wait_queue(&pool->waitq, &wait);
+			schedule_timeout(POOL_TIMEOUT_JIFFIES);
+			current->state = TASK_RUNNING;
+			remove_wait_queue(&pool->waitq, &wait);
+			goto restart;
+		}
+		return NULL;
+	}
+
+	spin_lock_irqsave(&pool->lock, flags);
+	list_add(&page->page_list, &pool->page_list);
+	pool->nr_pages++;
+ready:
+	offset = page->offset;
+	page->offset = *(unsigned int *)(page->vaddr + offset);
+	page->in_use++;
+	if (page->offset >= pool->allocation) {
+		/* full: keep the pages with free blocks in front */
+		list_del(&page->page_list);
+		list_add_tail(&page->page_list, &pool->page_list);
+	}
+	pool->nr_blocks++;
+	pool->nr_allocs++;
+	retval = page->vaddr + offset;
+	*handle = page->dma + offset;
+	spin_unlock_irqrestore(&pool->lock, flags);
+	return retval;
+}
+
+static struct dma_page *pool_find_page(struct dma_pool *pool, dma_addr_t dma)
+{
+	struct list_head *entry;
+
+	list_for_each(entry, &pool->page_list) {
+		struct dma_page *page;
+
+		page = list_entry(entry, struct dma_page, page_list);
+		if (dma >= page->dma && dma < page->dma + pool->allocation)
+			return page;
+	}
+	return NULL;
+}
+
+/**
+ * dma_pool_free - put block back into its pool
+ * @pool: the pool holding the block
+ * @vaddr: virtual address of block
+ * @dma: dma address of block
+ *
+ * Caller promises neither device nor driver will again touch this block
+ * unless it is first re-allocated.
+ */
+void dma_pool_free(struct dma_pool *pool, void *vaddr, dma_addr_t dma)
+{
+	struct dma_page *page;
+	unsigned long flags;
+	unsigned int offset;
+
+	spin_lock_irqsave(&pool->lock, flags);
+	page = pool_find_page(pool, dma);
+	if (!page || page->vaddr + (dma - page->dma) != vaddr) {
+		spin_unlock_irqrestore(&pool->lock, flags);
+		printk(KERN_ERR "dma_pool_free %s, %p/%x (bad dma)\n",
+		       pool->name, vaddr, dma);
+		return;
+	}
+
+	if (pool->flags & DMA_POOL_POISON)
+		memset(vaddr, POOL_POISON_BYTE, pool->size);
+
+	if (page->offset >= pool->allocation) {
+		/* it has a free block again */
+		list_del(&page->page_list);
+		list_add(&page->page_list, &pool->page_list);
+	}
+	offset = dma - page->dma;
+	*(unsigned int *)vaddr = page->offset;
+	page->offset = offset;
+	page->in_use--;
+	pool->nr_blocks--;
+
+	if (waitqueue_active(&pool->waitq))
+		wake_up(&pool->waitq);
+	spin_unlock_irqrestore(&pool->lock, flags);
+}
+
+EXPORT_SYMBOL(dma_pool_create);
+EXPORT_SYMBOL(dma_pool_destroy);
+EXPORT_SYMBOL(dma_pool_alloc);
+EXPORT_SYMBOL(dma_pool_free);
+
+static int dma_pools_read_proc(char *page, char **start, off_t off,
+			       int count, int *eof, void *data)
+{
+	struct list_head *entry;
+	char *p = page;
+	int len;
+
+	p += sprintf(p, "pool                 size  in use  pages    allocs\n");
+	spin_lock(&dma_pools_lock);
+	list_for_each(entry, &dma_pools) {
+		struct dma_pool *pool = list_entry(entry, struct dma_pool, pools);
+
+		p += sprintf(p, "%-20s %4u %7lu %6lu %9lu%s\n",
+			     pool->name, pool->size, pool->nr_blocks,
+			     pool->nr_pages, pool->nr_allocs,
+			     pool->flags & DMA_POOL_WRITECOMBINE ? " wc" : "");
+	}
+	spin_unlock(&dma_pools_lock);
+
+	len = (p - page) - off;
+	if (len < 0)
+		len = 0;
+	*eof = (len <= count) ? 1 : 0;
+	*start = page + off;
+	return len;
+}
+
+static int __init dma_pools_init(void)
+{
+	create_proc_read_entry("dma_pools", 0, NULL, dma_pools_read_proc, NULL);
+	return 0;
+}
+
+__initcall(dma_pools_init);
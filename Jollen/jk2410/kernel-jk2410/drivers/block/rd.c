@@ -948,6 +948,7 @@ static void error(char *m);
 static void gzip_mark(void **);
 static void gzip_release(void **);
 
+#define INFLATE_HAVE_INSIZE
 #include "../../lib/inflate.c"
 
 static void __init *malloc(int size)
@@ -992,9 +993,7 @@ static int __init fill_inbuf(void)
  */
 static void __init flush_window(void)
 {
-    ulg c = crc;         /* temporary variable */
-    unsigned n, written;
-    uch *in, ch;
+    unsigned written;
     
     written = crd_outfp->f_op->write(crd_outfp, window, outcnt, &crd_outfp->f_pos);
     if (written != outcnt && exit_code == 0) {
@@ -1002,12 +1001,7 @@ static void __init flush_window(void)
 		"(%d != %d)\n", written, outcnt);
 	exit_code = 1;
     }
-    in = window;
-    for (n = 0; n < outcnt; n++) {
-	    ch = *in++;
-	    c = crc_32_tab[((int)c ^ ch) & 0xff] ^ (c >> 8);
-    }
-    crc = c;
+    updcrc(window, outcnt);
     bytes_out += (ulg)outcnt;
     outcnt = 0;
 }
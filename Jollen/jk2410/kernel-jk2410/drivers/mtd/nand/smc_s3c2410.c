@@ -18,6 +18,7 @@
 
 #ifdef CONFIG_PM
 #include <linux/pm.h>
+#include <asm/arch/pm.h>
 #endif
 
 #ifdef CONFIG_PM
@@ -130,17 +131,20 @@ inline void smc_remove(struct nand_chip *this) {
 }
 
 #ifdef CONFIG_PM
-static unsigned long nfcon;
+static struct sleep_save smc_save[] = {
+	SAVE_ITEM(NFCONF),
+};
+
 static int
 s3c2410_smc_pm_callback(struct pm_dev *pm_dev, pm_request_t req, void *data)
 {
 	struct nand_chip *this = (struct nand_chip *)pm_dev->data;
 	switch (req) {
 		case PM_SUSPEND:
-			nfcon = NFCONF;
+			s3c2410_pm_do_save(smc_save, ARRAY_SIZE(smc_save));
 			break;
 		case PM_RESUME:
-			NFCONF = nfcon;
+			s3c2410_pm_do_restore(smc_save, ARRAY_SIZE(smc_save));
 			/* Chip Enable -> RESET -> Wait for Ready -> Chip Disable */
 			this->hwcontrol(NAND_CTL_SETNCE);
 			this->write_cmd(NAND_CMD_RESET);
@@ -211,8 +215,10 @@ int __init smc_s3c2410_init (void)
 
 #ifdef CONFIG_PM
 	smc_pm_dev = pm_register(PM_DEBUG_DEV, PM_SYS_MISC, s3c2410_smc_pm_callback);
-	if (smc_pm_dev)
+	if (smc_pm_dev) {
 		smc_pm_dev->data = &s3c2410_mtd[1];
+		smc_pm_dev->flags |= PM_FLAG_ASYNC_RESUME;
+	}
 #endif
 
     return 0;
@@ -13,6 +13,9 @@
    Wed Aug 16 2002 Yong-iL Joh <tolkien@mizi.com>
    - working!
 
+   - receive through dev->poll: the rx interrupt is masked while the
+     device sits on the poll list, so a flood can't live-lock the board
+
  *
  * This file is subject to the terms and conditions of the GNU General Public
  * License.  See the file COPYING in the main directory of this archive
@@ -99,9 +102,29 @@ struct net_local {
 	int send_underrun;	/* keep track of how many underruns
 				   in a row we get */
 	int force;		/* force various values; see FORCE* above. */
+	int rx_event;		/* RxEvent taken off the ISQ, not yet polled */
 	spinlock_t lock;
 };
 
+/* RxCFG interrupt enables masked while polling */
+#define RX_IRQ_ENBL	(RX_OK_ENBL | RX_CRC_ERROR_ENBL | \
+			 RX_RUNT_ENBL | RX_EXTRA_DATA_ENBL)
+/* RxEvent bits telling a frame (good or bad) is waiting */
+#define RX_EVENT_FRAME	(RX_OK | RX_CRC_ERROR | RX_RUNT | \
+			 RX_EXTRA_DATA | RX_DRIBBLE)
+
+/* rx weight, frames per poll round; 10Mbit won't need more */
+#define CS8900_WEIGHT	16
+
+/* in promiscuous mode, we accept errored packets,
+   so we have to enable interrupts on them also */
+static inline int rx_cfg(struct net_local *lp)
+{
+	return lp->curr_rx_cfg |
+		(lp->rx_mode == RX_ALL_ACCEPT ?
+		 (RX_CRC_ERROR_ENBL|RX_RUNT_ENBL|RX_EXTRA_DATA_ENBL) : 0);
+}
+
 /* Index to functions, as function prototypes. */
 
 extern int cs89x0_probe(struct net_device *dev);
@@ -112,6 +135,7 @@ static void net_interrupt(int irq, void *dev_id, struct pt_regs *regs);
 static void set_multicast_list(struct net_device *dev);
 static void net_timeout(struct net_device *dev);
 static void net_rx(struct net_device *dev);
+static int net_poll(struct net_device *dev, int *budget);
 static int net_close(struct net_device *dev);
 static struct net_device_stats *net_get_stats(struct net_device *dev);
 static void reset_chip(struct net_device *dev);
@@ -292,6 +316,8 @@ static int __init cs89x0_probe1(struct net_device *dev, int ioaddr) {
     dev->get_stats		= net_get_stats;
     dev->set_multicast_list	= set_multicast_list;
     dev->set_mac_address 	= set_mac_address;
+    dev->poll			= net_poll;
+    dev->weight			= CS8900_WEIGHT;
 
     /* Fill in the fields of the device structure with ethernet values. */
     ether_setup(dev);
@@ -377,6 +403,8 @@ static int net_open(struct net_device *dev)
 	     READY_FOR_TX_ENBL | RX_MISS_COUNT_OVRFLOW_ENBL |
 	     TX_COL_COUNT_OVRFLOW_ENBL | TX_UNDERRUN_ENBL);
 
+    lp->rx_event = 0;
+
     /* now that we've got our act together, enable everything */
     writereg(dev, PP_BusCTL, readreg(dev, PP_BusCTL) | ENABLE_IRQ);
     enable_irq(dev->irq);
@@ -480,8 +508,12 @@ static void net_interrupt(int irq, void *dev_id, struct pt_regs * regs)
       DPRINTK(4, "%s: event=%04x\n", dev->name, status);
       switch(status & ISQ_EVENT_MASK) {
       case ISQ_RECEIVER_EVENT:
-	/* Got a packet(s). */
-	net_rx(dev);
+	/* Got a packet(s): leave it in the chip and poll for it. */
+	lp->rx_event = status;
+	if (netif_rx_schedule_prep(dev)) {
+	  writereg(dev, PP_RxCFG, rx_cfg(lp) & ~RX_IRQ_ENBL);
+	  __netif_rx_schedule(dev);
+	}
 	break;
       case ISQ_TRANSMITTER_EVENT:
 	lp->stats.tx_packets++;
@@ -528,6 +560,55 @@ static void net_interrupt(int irq, void *dev_id, struct pt_regs * regs)
     }
 }
 
+/*
+ * Receive up to the quota, then either stay on the poll list or, with
+ * the chip drained, unmask the rx interrupt again.
+ */
+static int net_poll(struct net_device *dev, int *budget)
+{
+    struct net_local *lp = (struct net_local *)dev->priv;
+    int limit = min(*budget, dev->quota);
+    int received = 0;
+    int status;
+    unsigned long flags;
+
+    while (received < limit) {
+      if (!lp->rx_event) {
+	status = readreg(dev, PP_RxEvent);
+	if (!(status & RX_EVENT_FRAME))
+	  break;
+      }
+      lp->rx_event = 0;
+      net_rx(dev);
+      received++;
+    }
+
+    dev->quota -= received;
+    *budget -= received;
+    if (received >= limit)
+      return 1;		/* not done, poll again */
+
+    /* The irq handler moves the PacketPage pointer too: keep it out
+       until the register accesses below are done. */
+    spin_lock_irqsave(&lp->lock, flags);
+    netif_rx_complete(dev);
+    writereg(dev, PP_RxCFG, rx_cfg(lp));
+
+    /* A frame that came in before the unmask raised no interrupt. */
+    status = readreg(dev, PP_RxEvent);
+    if (!(status & RX_EVENT_FRAME))
+      goto done;
+    lp->rx_event = status;
+    if (!netif_rx_reschedule(dev, received))
+      goto done;		/* already back on the poll list */
+    writereg(dev, PP_RxCFG, rx_cfg(lp) & ~RX_IRQ_ENBL);
+    spin_unlock_irqrestore(&lp->lock, flags);
+    return 1;
+done:
+    spin_unlock_irqrestore(&lp->lock, flags);
+    return 0;
+}
+
 static void count_rx_errors(int status, struct net_local *lp) {
     lp->stats.rx_errors++;
     if (status & RX_RUNT) lp->stats.rx_length_errors++;
@@ -571,7 +652,7 @@ static void net_rx(struct net_device *dev) {
 	    (skb->data[ETH_ALEN+ETH_ALEN] << 8) | skb->data[ETH_ALEN+ETH_ALEN+1]);
 
     skb->protocol=eth_type_trans(skb,dev);
-    netif_rx(skb);
+    netif_receive_skb(skb);
     dev->last_rx = jiffies;
     lp->stats.rx_packets++;
     lp->stats.rx_bytes += length;
@@ -627,11 +708,11 @@ static void set_multicast_list(struct net_device *dev)
 
 	writereg(dev, PP_RxCTL, DEF_RX_ACCEPT | lp->rx_mode);
 
-	/* in promiscuous mode, we accept errored packets,
-	   so we have to enable interrupts on them also */
-	writereg(dev, PP_RxCFG, lp->curr_rx_cfg |
-		 (lp->rx_mode == RX_ALL_ACCEPT ?
-		  (RX_CRC_ERROR_ENBL|RX_RUNT_ENBL|RX_EXTRA_DATA_ENBL) : 0));
+	/* keep the rx interrupt masked while we are being polled */
+	if (test_bit(__LINK_STATE_RX_SCHED, &dev->state))
+		writereg(dev, PP_RxCFG, rx_cfg(lp) & ~RX_IRQ_ENBL);
+	else
+		writereg(dev, PP_RxCFG, rx_cfg(lp));
 	spin_unlock_irqrestore(&lp->lock, flags);
 }
 
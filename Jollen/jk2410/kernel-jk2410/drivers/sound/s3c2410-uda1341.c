@@ -130,7 +130,7 @@ static void init_s3c2410_iis_bus_tx(void);
 #define AUDIO_NAME		"UDA1341"
 #define AUDIO_NAME_VERBOSE	"UDA1341 audio driver"
 
-#define AUDIO_FMT_MASK          (AFMT_S16_LE)
+#define AUDIO_FMT_MASK          (AFMT_S16_LE | AFMT_U8 | AFMT_S8)
 #define AUDIO_FMT_DEFAULT       (AFMT_S16_LE)
 
 #define AUDIO_CHANNELS_DEFAULT	2
@@ -142,21 +142,30 @@ static void init_s3c2410_iis_bus_tx(void);
 #define S_CLOCK_FREQ	384
 #define PCM_ABS(a) (a < 0 ? -a : a)
 
+/* user data is widened through this much stack per copy_from_user() */
+#define AUDIO_BOUNCE_SIZE	256
+
 typedef struct {
 	int size;		/* buffer size */
 	char *start;		/* point to actual buffer */
 	dma_addr_t dma_addr;	/* physical buffer address */
 	struct semaphore sem;	/* down before touching the buffer */
 	int master;		/* owner for buffer allocation, contain size when true */
+	struct audio_stream_s *stream;	/* owning stream */
 } audio_buf_t;
 
-typedef struct {
+typedef struct audio_stream_s {
 	audio_buf_t *buffers;	/* pointer to audio buffer structures */
 	audio_buf_t *buf;	/* current buffer used by read/write */
 	u_int buf_idx;		/* index for the pointer above */
 	u_int fragsize;		/* fragment i.e. buffer size */
 	u_int nbfrags;		/* nbr of fragments */
+	int bytecount;		/* nbr of processed bytes */
+	int fragcount;		/* nbr of fragment transitions */
 	dmach_t dma_ch;		/* DMA channel (channel2 for audio) */
+	wait_queue_head_t wq;	/* woken once per completed fragment */
+	int mapped:1;		/* mmap()'ed buffers */
+	int active:1;		/* actually in progress */
 } audio_stream_t;
 
 static audio_stream_t output_stream;
@@ -287,6 +296,8 @@ static void audio_clear_buf(audio_stream_t * s)
 
 	s->buf_idx = 0;
 	s->buf = NULL;
+	s->mapped = 0;
+	s->active = 0;
 }
 
 static int audio_setup_buf(audio_stream_t * s)
@@ -314,7 +325,7 @@ static int audio_setup_buf(audio_stream_t * s)
 		if (!dmasize) {
 			dmasize = (s->nbfrags - frag) * s->fragsize;
 			do {
-				dmabuf = consistent_alloc(GFP_KERNEL|GFP_DMA,
+				dmabuf = consistent_alloc_writecombine(GFP_KERNEL|GFP_DMA,
 							  dmasize, &dmaphys);
 				if (!dmabuf) 
 				    	dmasize -= s->fragsize;
@@ -322,10 +333,12 @@ static int audio_setup_buf(audio_stream_t * s)
 			if (!dmabuf)
 				goto err;
 			b->master = dmasize;
+			memzero(dmabuf, dmasize);
 		}
 
 		b->start = dmabuf;
 		b->dma_addr = dmaphys;
+		b->stream = s;
 		sema_init(&b->sem, 1);
 		DPRINTK("buf %d: start %p dma %d\n", frag, b->start, b->dma_addr);
 
@@ -336,6 +349,8 @@ static int audio_setup_buf(audio_stream_t * s)
 
 	s->buf_idx = 0;
 	s->buf = &s->buffers[0];
+	s->bytecount = 0;
+	s->fragcount = 0;
 
 	return 0;
 
@@ -345,21 +360,80 @@ static int audio_setup_buf(audio_stream_t * s)
 	return -ENOMEM;
 }
 
+/*
+ * Return every buffer to the caller and stop the DMA, keeping the
+ * buffers (and any user mapping of them) around.
+ */
+static void audio_reset_buf(audio_stream_t * s)
+{
+	int frag;
+
+	s->active = 0;
+	s3c2410_dma_flush_all(s->dma_ch);
+	if (s->buffers) {
+		for (frag = 0; frag < s->nbfrags; frag++) {
+			audio_buf_t *b = &s->buffers[frag];
+			b->size = 0;
+			sema_init(&b->sem, 1);
+		}
+	}
+	s->bytecount = 0;
+	s->fragcount = 0;
+}
+
+/*
+ * Hand the whole ring to the DMA.  Used for capture and for mmap()'ed
+ * playback, where the buffers are recycled straight from the DMA
+ * callback and never go through read()/write().
+ */
+static void audio_prime_dma(audio_stream_t * s, int write)
+{
+	int i;
+
+	s->active = 1;
+	for (i = 0; i < s->nbfrags; i++) {
+		audio_buf_t *b = s->buf;
+		down(&b->sem);
+		s3c2410_dma_queue_buffer(s->dma_ch, (void *) b,
+					 b->dma_addr, s->fragsize, write);
+		NEXT_BUF(s, buf);
+	}
+}
+
 static void audio_dmaout_done_callback(void *buf_id, int size)
 {
 	audio_buf_t *b = (audio_buf_t *) buf_id;
-	
-	up(&b->sem);
-	wake_up(&b->sem.wait);
+	audio_stream_t *s = b->stream;
+
+	s->bytecount += size;
+	s->fragcount++;
+
+	if (s->mapped)
+		s3c2410_dma_queue_buffer(s->dma_ch, buf_id, b->dma_addr,
+					 s->fragsize, DMA_BUF_WR);
+	else
+		up(&b->sem);
+
+	wake_up(&s->wq);
 }
 
 static void audio_dmain_done_callback(void *buf_id, int size)
 {
 	audio_buf_t *b = (audio_buf_t *) buf_id;
-	
-  	b->size = size;
-	up(&b->sem);
-	wake_up(&b->sem.wait);		
+	audio_stream_t *s = b->stream;
+
+	s->bytecount += size;
+	s->fragcount++;
+
+	if (s->mapped) {
+		s3c2410_dma_queue_buffer(s->dma_ch, buf_id, b->dma_addr,
+					 s->fragsize, DMA_BUF_RD);
+	} else {
+		b->size = size;
+		up(&b->sem);
+	}
+
+	wake_up(&s->wq);
 }
  /* using when write */
 static int audio_sync(struct file *file)
@@ -369,7 +443,7 @@ static int audio_sync(struct file *file)
 
 	DPRINTK("audio_sync\n");
 
-	if (!s->buffers)
+	if (!s->buffers || s->mapped)
 		return 0;
 
 	if (b->size != 0) {
@@ -388,35 +462,107 @@ static int audio_sync(struct file *file)
 	return 0;
 }
 
-static inline int copy_from_user_mono_stereo(char *to, const char *from, int count)
+/*
+ * The codec always runs 16-bit stereo.  Mono and 8-bit data is widened
+ * on the way in, so one user byte becomes (1 << audio_in_shift()) bytes
+ * in the fragment.
+ */
+static inline int audio_in_shift(void)
 {
-	u_int *dst = (u_int *)to;
-	const char *end = from + count;
+	int shift = 0;
 
-	if (verify_area(VERIFY_READ, from, count))
-		return -EFAULT;
+	if (audio_channels == 1)
+		shift++;
+	if (audio_fmt != AFMT_S16_LE)
+		shift++;
+	return shift;
+}
 
-	if ((int)from & 0x2) {
-		u_int v;
-		__get_user(v, (const u_short *)from); from += 2;
+/* 16-bit mono to stereo, two input words per pass */
+static u_int *audio_expand_s16_mono(u_int *dst, const u_int *src, int count)
+{
+	while (count >= 8) {
+		u_int v = *src++;
+		u_int w = *src++;
+		dst[0] = (v & 0xffff) | (v << 16);
+		dst[1] = (v >> 16) | (v & 0xffff0000);
+		dst[2] = (w & 0xffff) | (w << 16);
+		dst[3] = (w >> 16) | (w & 0xffff0000);
+		dst += 4;
+		count -= 8;
+	}
+	if (count >= 4) {
+		u_int v = *src++;
+		*dst++ = (v & 0xffff) | (v << 16);
+		*dst++ = (v >> 16) | (v & 0xffff0000);
+		count -= 4;
+	}
+	if (count) {
+		u_int v = *(const u_short *)src;
 		*dst++ = v | (v << 16);
 	}
+	return dst;
+}
 
-	while (from < end-2) {
-		u_int v, x, y;
-		__get_user(v, (const u_int *)from); from += 4;
-		x = v << 16;
-		x |= x >> 16;
-		y = v >> 16;
-		y |= y << 16;
-		*dst++ = x;
-		*dst++ = y;
+/* 8-bit mono or stereo to 16-bit stereo; xor is 0x80 for unsigned data */
+static u_int *audio_expand_8(u_int *dst, const u_char *src, int count,
+			     int channels, u_int xor)
+{
+	u_int l, r;
+
+	if (channels == 2) {
+		while (count >= 2) {
+			l = (src[0] ^ xor) << 8;
+			r = (src[1] ^ xor) << 8;
+			*dst++ = l | (r << 16);
+			src += 2;
+			count -= 2;
+		}
+	} else {
+		while (count >= 4) {
+			l = (src[0] ^ xor) << 8;
+			r = (src[1] ^ xor) << 8;
+			dst[0] = l | (l << 16);
+			dst[1] = r | (r << 16);
+			l = (src[2] ^ xor) << 8;
+			r = (src[3] ^ xor) << 8;
+			dst[2] = l | (l << 16);
+			dst[3] = r | (r << 16);
+			dst += 4;
+			src += 4;
+			count -= 4;
+		}
+		while (count--) {
+			l = (*src++ ^ xor) << 8;
+			*dst++ = l | (l << 16);
+		}
 	}
+	return dst;
+}
 
-	if (from < end) {
-		u_int v;
-		__get_user(v, (const u_short *)from);
-		*dst = v | (v << 16);
+/*
+ * Pull user data through a small cached bounce buffer and widen it
+ * into the (uncached) DMA fragment a word at a time, instead of doing
+ * a __get_user() per sample.
+ */
+static int audio_convert_from_user(char *to, const char *from, int count)
+{
+	u_int bounce[AUDIO_BOUNCE_SIZE / 4];
+	u_int *dst = (u_int *)to;
+
+	while (count > 0) {
+		int n = (count > AUDIO_BOUNCE_SIZE) ? AUDIO_BOUNCE_SIZE : count;
+
+		if (copy_from_user(bounce, from, n))
+			return -EFAULT;
+		if (audio_fmt == AFMT_S16_LE)
+			dst = audio_expand_s16_mono(dst, bounce, n);
+		else
+			dst = audio_expand_8(dst, (u_char *)bounce, n,
+					     audio_channels,
+					     (audio_fmt == AFMT_U8) ? 0x80 : 0);
+		from += n;
+		count -= n;
 	}
 
 	return 0;
@@ -428,7 +574,7 @@ static ssize_t smdk2410_audio_write(struct file *file, const char *buffer,
 {
 	const char *buffer0 = buffer;
 	audio_stream_t *s = &output_stream;
-	int chunksize, ret = 0;
+	int chunksize, shift, ret = 0;
 
 	DPRINTK("audio_write : start count=%d\n", count);
 
@@ -440,10 +586,14 @@ static ssize_t smdk2410_audio_write(struct file *file, const char *buffer,
 		  	return -EPERM;
 	}
 
+	if (s->mapped)
+		return -ENXIO;
 	if (!s->buffers && audio_setup_buf(s))
 		return -ENOMEM;
 
-	count &= ~0x03;
+	/* whole frames only, measured in user bytes */
+	shift = audio_in_shift();
+	count &= ~((4 >> shift) - 1);
 
 	while (count > 0) {
 		audio_buf_t *b = s->buf;
@@ -458,30 +608,21 @@ static ssize_t smdk2410_audio_write(struct file *file, const char *buffer,
 				break;
 		}
 
-		if (audio_channels == 2) {
-			chunksize = s->fragsize - b->size;
-			if (chunksize > count)
-				chunksize = count;
-			DPRINTK("write %d to %d\n", chunksize, s->buf_idx);
+		chunksize = (s->fragsize - b->size) >> shift;
+		if (chunksize > count)
+			chunksize = count;
+		DPRINTK("write %d to %d\n", chunksize << shift, s->buf_idx);
+		if (shift == 0) {
 			if (copy_from_user(b->start + b->size, buffer, chunksize)) {
 				up(&b->sem);
 				return -EFAULT;
 			}
-			b->size += chunksize;
-		} else {
-			chunksize = (s->fragsize - b->size) >> 1;
-
-			if (chunksize > count)
-				chunksize = count;
-			DPRINTK("write %d to %d\n", chunksize*2, s->buf_idx);
-			if (copy_from_user_mono_stereo(b->start + b->size, 
-				    		       buffer, chunksize)) {
-				up(&b->sem);
-				return -EFAULT;
-			}
-
-			b->size += chunksize*2;
+		} else if (audio_convert_from_user(b->start + b->size,
+						   buffer, chunksize)) {
+			up(&b->sem);
+			return -EFAULT;
 		}
+		b->size += chunksize << shift;
 
 		buffer += chunksize;
 		count -= chunksize;
@@ -490,6 +631,7 @@ static ssize_t smdk2410_audio_write(struct file *file, const char *buffer,
 			break;
 		}
 
+		s->active = 1;
 		s3c2410_dma_queue_buffer(s->dma_ch, (void *) b,
 					   b->dma_addr, b->size, DMA_BUF_WR);
 		b->size = 0;
@@ -517,20 +659,14 @@ static ssize_t smdk2410_audio_read(struct file *file, char *buffer,
         if (ppos != &file->f_pos)
                 return -ESPIPE;
 
-	if (!s->buffers) {
-		int i;
- 
-                 if (audio_setup_buf(s))
-                         return -ENOMEM;
- 
-                 for (i = 0; i < s->nbfrags; i++) {
-                         audio_buf_t *b = s->buf; 
-                         down(&b->sem); 
-                         s3c2410_dma_queue_buffer(s->dma_ch, (void *) b,
-                                         b->dma_addr, s->fragsize, DMA_BUF_RD);
-                         NEXT_BUF(s, buf);
-                 }
-         }
+	if (s->mapped)
+		return -ENXIO;
+
+	if (!s->active) {
+		if (!s->buffers && audio_setup_buf(s))
+			return -ENOMEM;
+		audio_prime_dma(s, DMA_BUF_RD);
+	}
 	
         while (count > 0) {
                 audio_buf_t *b = s->buf;
@@ -581,9 +717,62 @@ static ssize_t smdk2410_audio_read(struct file *file, char *buffer,
 }
 
 
+static int smdk2410_audio_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	audio_stream_t *s;
+	unsigned long size, vma_addr;
+	int i, ret;
+
+	if (vma->vm_pgoff != 0)
+		return -EINVAL;
+
+	if (vma->vm_flags & VM_WRITE) {
+		if (!(file->f_mode & FMODE_WRITE))
+			return -EINVAL;
+		s = &output_stream;
+	} else if (vma->vm_flags & VM_READ) {
+		if (!(file->f_mode & FMODE_READ))
+			return -EINVAL;
+		s = &input_stream;
+	} else
+		return -EINVAL;
+
+	/* the ring is handed to the codec as is: no widening possible */
+	if (audio_channels != 2 || audio_fmt != AFMT_S16_LE)
+		return -EINVAL;
+
+	if (s->mapped)
+		return -EINVAL;
+	if (!s->buffers && audio_setup_buf(s))
+		return -ENOMEM;
+	size = vma->vm_end - vma->vm_start;
+	if (size != s->fragsize * s->nbfrags)
+		return -EINVAL;
+
+	/* the kernel side is uncached too, so nothing to flush per period */
+	vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+	vma_addr = vma->vm_start;
+	for (i = 0; i < s->nbfrags; i++) {
+		audio_buf_t *buf = &s->buffers[i];
+		if (!buf->master)
+			continue;
+		ret = remap_page_range(vma_addr, buf->dma_addr, buf->master,
+				       vma->vm_page_prot);
+		if (ret)
+			return ret;
+		vma_addr += buf->master;
+	}
+	s->mapped = 1;
+
+	return 0;
+}
+
+
 static unsigned int smdk2410_audio_poll(struct file *file, 
 					struct poll_table_struct *wait)
 {
+	audio_stream_t *is = &input_stream;
+	audio_stream_t *os = &output_stream;
 	unsigned int mask = 0;
 	int i;
 
@@ -591,27 +780,46 @@ static unsigned int smdk2410_audio_poll(struct file *file,
 		(file->f_mode & FMODE_WRITE) ? "w" : "");
 
 	if (file->f_mode & FMODE_READ) {
-                if (!input_stream.buffers && audio_setup_buf(&input_stream))
-                        return -ENOMEM;
-                poll_wait(file, &input_stream.buf->sem.wait, wait);
-
-                for (i = 0; i < input_stream.nbfrags; i++) {
-                        if (atomic_read(&input_stream.buffers[i].sem.count) > 0)
-                                mask |= POLLIN | POLLWRNORM;
-				break;
-                }
-        }
-
+		if (!is->active) {
+			if (!is->buffers && audio_setup_buf(is))
+				return -ENOMEM;
+			if (!is->mapped)
+				audio_prime_dma(is, DMA_BUF_RD);
+		}
+		poll_wait(file, &is->wq, wait);
+	}
 
 	if (file->f_mode & FMODE_WRITE) {
-		if (!output_stream.buffers && audio_setup_buf(&output_stream))
+		if (!os->buffers && audio_setup_buf(os))
 			return -ENOMEM;
-		poll_wait(file, &output_stream.buf->sem.wait, wait);
+		poll_wait(file, &os->wq, wait);
+	}
 
-		for (i = 0; i < output_stream.nbfrags; i++) {
-			if (atomic_read(&output_stream.buffers[i].sem.count) > 0)
+	if (file->f_mode & FMODE_READ) {
+		if (is->mapped) {
+			if (is->bytecount > 0)
+				mask |= POLLIN | POLLRDNORM;
+		} else {
+			for (i = 0; i < is->nbfrags; i++) {
+				if (atomic_read(&is->buffers[i].sem.count) > 0) {
+					mask |= POLLIN | POLLRDNORM;
+					break;
+				}
+			}
+		}
+	}
+
+	if (file->f_mode & FMODE_WRITE) {
+		if (os->mapped) {
+			if (os->bytecount > 0)
 				mask |= POLLOUT | POLLWRNORM;
-				break;
+		} else {
+			for (i = 0; i < os->nbfrags; i++) {
+				if (atomic_read(&os->buffers[i].sem.count) > 0) {
+					mask |= POLLOUT | POLLWRNORM;
+					break;
+				}
+			}
 		}
 	}
 
@@ -758,9 +966,13 @@ static int smdk2410_audio_ioctl(struct inode *inode, struct file *file,
 	switch (cmd) {
 	  	case SNDCTL_DSP_SETFMT:
 			get_user(val, (long *) arg);
-		  	if (val & AUDIO_FMT_MASK) {
+			if (val == AFMT_QUERY)
+				return put_user(audio_fmt, (long *) arg);
+		  	if (val == AFMT_S16_LE || val == AFMT_U8 || val == AFMT_S8) {
+				if (output_stream.mapped || input_stream.mapped)
+					return -EBUSY;
 			    	audio_fmt = val;
-			    	break;
+				return put_user(audio_fmt, (long *) arg);
 		  	} else
 				return -EINVAL;
 
@@ -771,6 +983,9 @@ static int smdk2410_audio_ioctl(struct inode *inode, struct file *file,
 			  	val = val ? 2 : 1;
 		  	if (val != 1 && val != 2)
 			  	return -EINVAL;
+			if (val != audio_channels &&
+			    (output_stream.mapped || input_stream.mapped))
+				return -EBUSY;
 		  	audio_channels = val;
 		  	break;
 
@@ -852,6 +1067,8 @@ static int smdk2410_audio_ioctl(struct inode *inode, struct file *file,
 
 			if (err)
 				return err;
+			if (!s->buffers && audio_setup_buf(s))
+				return -ENOMEM;
 			for (i = 0; i < s->nbfrags; i++) {
 				if (atomic_read(&s->buffers[i].sem.count) > 0) {
 					if (s->buffers[i].size == 0) frags++;
@@ -878,6 +1095,8 @@ static int smdk2410_audio_ioctl(struct inode *inode, struct file *file,
 
 			if (err)
 				return err;
+			if (!s->buffers && audio_setup_buf(s))
+				return -ENOMEM;
 			for(i = 0; i < s->nbfrags; i++){
 			if (atomic_read(&s->buffers[i].sem.count) > 0)
                                 {
@@ -893,23 +1112,98 @@ static int smdk2410_audio_ioctl(struct inode *inode, struct file *file,
                         break;
 		}
 	  	case SNDCTL_DSP_RESET:
+			/* mmap()'ed buffers stay: user space still maps them */
 			if (file->f_mode & FMODE_READ) {
-                                audio_clear_buf(&input_stream);
+				if (input_stream.mapped)
+					audio_reset_buf(&input_stream);
+				else
+					audio_clear_buf(&input_stream);
                         }
                         if (file->f_mode & FMODE_WRITE) {
-                                audio_clear_buf(&output_stream);
+				if (output_stream.mapped)
+					audio_reset_buf(&output_stream);
+				else
+					audio_clear_buf(&output_stream);
                         }
                         return 0;
 		case SNDCTL_DSP_NONBLOCK:
 			file->f_flags |= O_NONBLOCK;
                         return 0;
+		case SNDCTL_DSP_GETCAPS:
+			return put_user(DSP_CAP_REALTIME | DSP_CAP_TRIGGER |
+					DSP_CAP_MMAP, (int *) arg);
+
+		case SNDCTL_DSP_GETTRIGGER:
+			val = 0;
+			if ((file->f_mode & FMODE_READ) && input_stream.active)
+				val |= PCM_ENABLE_INPUT;
+			if ((file->f_mode & FMODE_WRITE) && output_stream.active)
+				val |= PCM_ENABLE_OUTPUT;
+			return put_user(val, (int *) arg);
+
+		case SNDCTL_DSP_SETTRIGGER:
+			if (get_user(val, (int *) arg))
+				return -EFAULT;
+			if (file->f_mode & FMODE_READ) {
+				audio_stream_t *s = &input_stream;
+				if (val & PCM_ENABLE_INPUT) {
+					if (!s->active) {
+						if (!s->buffers && audio_setup_buf(s))
+							return -ENOMEM;
+						audio_prime_dma(s, DMA_BUF_RD);
+					}
+				} else if (s->active)
+					audio_reset_buf(s);
+			}
+			if (file->f_mode & FMODE_WRITE) {
+				audio_stream_t *s = &output_stream;
+				if (val & PCM_ENABLE_OUTPUT) {
+					if (!s->active) {
+						if (!s->buffers && audio_setup_buf(s))
+							return -ENOMEM;
+						if (s->mapped)
+							audio_prime_dma(s, DMA_BUF_WR);
+					}
+				} else if (s->active)
+					audio_reset_buf(s);
+			}
+			return 0;
+
+		case SNDCTL_DSP_GETOPTR:
+		case SNDCTL_DSP_GETIPTR:
+		{
+			count_info inf = { 0, };
+			audio_stream_t *s = (cmd == SNDCTL_DSP_GETOPTR) ?
+					    &output_stream : &input_stream;
+			audio_buf_t *b;
+			dma_addr_t ptr = 0;
+			int bytecount, offset, flags;
+
+			if ((s == &input_stream && !(file->f_mode & FMODE_READ)) ||
+			    (s == &output_stream && !(file->f_mode & FMODE_WRITE)))
+				return -EINVAL;
+			if (s->active) {
+				local_irq_save(flags);
+				if (s3c2410_dma_get_current(s->dma_ch, (void *)&b, &ptr) == 0 &&
+				    b && ptr) {
+					offset = ptr - b->dma_addr;
+					inf.ptr = (b - s->buffers) * s->fragsize + offset;
+				} else
+					offset = 0;
+				bytecount = s->bytecount + offset;
+				s->bytecount = -offset;
+				inf.blocks = s->fragcount;
+				s->fragcount = 0;
+				local_irq_restore(flags);
+				if (bytecount < 0)
+					bytecount = 0;
+				inf.bytes = bytecount;
+			}
+			return copy_to_user((void *)arg, &inf, sizeof(inf)) ? -EFAULT : 0;
+		}
+
 	 	case SNDCTL_DSP_POST:
 	      	case SNDCTL_DSP_SUBDIVIDE:
-	      	case SNDCTL_DSP_GETCAPS:
-	      	case SNDCTL_DSP_GETTRIGGER:
-	      	case SNDCTL_DSP_SETTRIGGER:
-	      	case SNDCTL_DSP_GETIPTR:
-	      	case SNDCTL_DSP_GETOPTR:
 	      	case SNDCTL_DSP_MAPINBUF:
 	      	case SNDCTL_DSP_MAPOUTBUF:
 	      	case SNDCTL_DSP_SETSYNCRO:
@@ -948,6 +1242,7 @@ static int smdk2410_audio_open(struct inode *inode, struct file *file)
 	if (cold) {
 		audio_rate = AUDIO_RATE_DEFAULT;
 		audio_channels = AUDIO_CHANNELS_DEFAULT;
+		audio_fmt = AUDIO_FMT_DEFAULT;
 		audio_fragsize = AUDIO_FRAGSIZE_DEFAULT;
 		audio_nbfrags = AUDIO_NBFRAGS_DEFAULT;
 		if ((file->f_mode & FMODE_WRITE)){
@@ -1009,6 +1304,7 @@ static struct file_operations smdk2410_audio_fops = {
 	write:		smdk2410_audio_write,
 	read:		smdk2410_audio_read,
 	poll:		smdk2410_audio_poll,
+	mmap:		smdk2410_audio_mmap,
 	ioctl:		smdk2410_audio_ioctl,
 	open:		smdk2410_audio_open,
 	release:	smdk2410_audio_release
@@ -1154,6 +1450,7 @@ int __init s3c2410_uda1341_init(void)
 	init_uda1341();
 
 	output_stream.dma_ch = DMA_CH2;
+	init_waitqueue_head(&output_stream.wq);
 
 	if (audio_init_dma(&output_stream, "UDA1341 out")) {
 		audio_clear_dma(&output_stream);
@@ -1163,6 +1460,7 @@ int __init s3c2410_uda1341_init(void)
 	}
 
 	input_stream.dma_ch = DMA_CH1;
+	init_waitqueue_head(&input_stream.wq);
 
         if (audio_init_dma(&input_stream, "UDA1341 in")) {
                 audio_clear_dma(&input_stream);
@@ -1188,5 +1486,5 @@ void __exit s3c2410_uda1341_exit(void)
 	printk(AUDIO_NAME_VERBOSE " unloaded\n");
 }
 
-module_init(s3c2410_uda1341_init);
+module_init_async(s3c2410_uda1341_init);
 module_exit(s3c2410_uda1341_exit);
@@ -174,6 +174,8 @@ static int queuecommand( Scsi_Cmnd *srb , void (*done)(Scsi_Cmnd *))
 static int command_abort( Scsi_Cmnd *srb )
 {
 	struct us_data *us = (struct us_data *)srb->host->hostdata[0];
+	int pending = 0;
+	int i;
 
 	US_DEBUGP("command_abort() called\n");
 
@@ -189,11 +191,20 @@ static int command_abort( Scsi_Cmnd *srb )
 		return SUCCESS;
 	}
 
-	/* if we have an urb pending, let's wake the control thread up */
+	/* if we have urbs pending, let's wake the control thread up */
 	if (us->current_urb->status == -EINPROGRESS) {
 		/* cancel the URB -- this will automatically wake the thread */
 		usb_unlink_urb(us->current_urb);
+		pending = 1;
+	}
+	for (i = 0; i < US_SG_URBS; i++) {
+		if (us->sg_urb[i].status == -EINPROGRESS) {
+			usb_unlink_urb(&us->sg_urb[i]);
+			pending = 1;
+		}
+	}
 
+	if (pending) {
 		/* wait for us to be done */
 		wait_for_completion(&(us->notify));
 		return SUCCESS;
@@ -482,34 +482,12 @@ int usb_stor_bulk_msg(struct us_data *us, void *data, int pipe,
 }
 
 /*
- * Transfer one SCSI scatter-gather buffer via bulk transfer
- *
- * Note that this function is necessary because we want the ability to
- * use scatter-gather memory.  Good performance is achieved by a combination
- * of scatter-gather and clustering (which makes each chunk bigger).
- *
- * Note that the lower layer will always retry when a NAK occurs, up to the
- * timeout limit.  Thus we don't have to worry about it for individual
- * packets.
+ * Turn the URB status and byte count of a data transfer into one of
+ * the US_BULK_TRANSFER_* codes, clearing a stalled pipe on the way
  */
-int usb_stor_transfer_partial(struct us_data *us, char *buf, int length)
+static int usb_stor_transfer_result(struct us_data *us, int pipe,
+				    int result, int partial, int length)
 {
-	int result;
-	int partial;
-	int pipe;
-
-	/* calculate the appropriate pipe information */
-	if (us->srb->sc_data_direction == SCSI_DATA_READ)
-		pipe = usb_rcvbulkpipe(us->pusb_dev, us->ep_in);
-	else
-		pipe = usb_sndbulkpipe(us->pusb_dev, us->ep_out);
-
-	/* transfer the data */
-	US_DEBUGP("usb_stor_transfer_partial(): xfer %d bytes\n", length);
-	result = usb_stor_bulk_msg(us, buf, pipe, length, &partial);
-	US_DEBUGP("usb_stor_bulk_msg() returned %d xferred %d/%d\n",
-		  result, partial, length);
-
 	/* if we stall, we need to clear it before we go on */
 	if (result == -EPIPE) {
 		US_DEBUGP("clearing endpoint halt for pipe 0x%x\n", pipe);
@@ -546,6 +524,132 @@ int usb_stor_transfer_partial(struct us_data *us, char *buf, int length)
 	return US_BULK_TRANSFER_SHORT;
 }
 
+/*
+ * Transfer one SCSI scatter-gather buffer via bulk transfer
+ *
+ * Note that this function is necessary because we want the ability to
+ * use scatter-gather memory.  Good performance is achieved by a combination
+ * of scatter-gather and clustering (which makes each chunk bigger).
+ *
+ * Note that the lower layer will always retry when a NAK occurs, up to the
+ * timeout limit.  Thus we don't have to worry about it for individual
+ * packets.
+ */
+int usb_stor_transfer_partial(struct us_data *us, char *buf, int length)
+{
+	int result;
+	int partial;
+	int pipe;
+
+	/* calculate the appropriate pipe information */
+	if (us->srb->sc_data_direction == SCSI_DATA_READ)
+		pipe = usb_rcvbulkpipe(us->pusb_dev, us->ep_in);
+	else
+		pipe = usb_sndbulkpipe(us->pusb_dev, us->ep_out);
+
+	/* transfer the data */
+	US_DEBUGP("usb_stor_transfer_partial(): xfer %d bytes\n", length);
+	result = usb_stor_bulk_msg(us, buf, pipe, length, &partial);
+	US_DEBUGP("usb_stor_bulk_msg() returned %d xferred %d/%d\n",
+		  result, partial, length);
+
+	return usb_stor_transfer_result(us, pipe, result, partial, length);
+}
+
+/*
+ * Write a scatter-gather list to the bulk out pipe, keeping up to
+ * US_SG_URBS URBs queued so that the host controller starts on the next
+ * buffer as soon as it finishes one, rather than idling while we are
+ * woken up to submit it.
+ *
+ * Only writes are queued like this: a device may end a read early, and
+ * a read URB queued behind the short one would swallow whatever the
+ * device sends next.
+ */
+static int usb_stor_transfer_sg_write(struct us_data *us,
+				      struct scatterlist *sg, int nents,
+				      unsigned int length)
+{
+	struct completion urb_done[US_SG_URBS];
+	struct urb *urb;
+	int pipe = usb_sndbulkpipe(us->pusb_dev, us->ep_out);
+	unsigned int queued_len = 0;
+	unsigned int partial = 0;
+	int queued = 0;
+	int done = 0;
+	int result = 0;
+	int i;
+
+	US_DEBUGP("usb_stor_transfer_sg_write(): xfer %u bytes in %d\n",
+		  length, nents);
+
+	/* lock the URBs */
+	down(&(us->current_urb_sem));
+
+	for (;;) {
+		/* top up the queue, unless something has gone wrong */
+		while (!result && queued < nents && queued_len < length &&
+		       queued - done < US_SG_URBS) {
+			unsigned int len = sg[queued].length;
+
+			if (len > length - queued_len)
+				len = length - queued_len;
+
+			i = queued % US_SG_URBS;
+			urb = &us->sg_urb[i];
+			init_completion(&urb_done[i]);
+			FILL_BULK_URB(urb, us->pusb_dev, pipe,
+				      sg[queued].address, len,
+				      usb_stor_blocking_completion,
+				      &urb_done[i]);
+			urb->actual_length = 0;
+			urb->error_count = 0;
+			urb->transfer_flags = USB_ASYNC_UNLINK | USB_QUEUE_BULK;
+
+			result = usb_submit_urb(urb);
+			if (result) {
+				/* don't let the ones before it run on */
+				for (i = done; i < queued; i++)
+					usb_unlink_urb(&us->sg_urb[i % US_SG_URBS]);
+				break;
+			}
+			queued_len += len;
+			queued++;
+		}
+
+		if (done == queued)
+			break;
+
+		/* wait for the oldest URB; we can't hold the lock while
+		 * sleeping, or command_abort() couldn't get at the URBs */
+		i = done % US_SG_URBS;
+		up(&(us->current_urb_sem));
+		wait_for_completion(&urb_done[i]);
+		down(&(us->current_urb_sem));
+
+		urb = &us->sg_urb[i];
+		partial += urb->actual_length;
+		done++;
+
+		/* on the first failure, cancel what is still queued and
+		 * collect their completions */
+		if (!result && (urb->status ||
+		    urb->actual_length != urb->transfer_buffer_length)) {
+			result = urb->status;
+			queued_len = length;
+			for (i = done; i < queued; i++)
+				usb_unlink_urb(&us->sg_urb[i % US_SG_URBS]);
+		}
+	}
+
+	/* release the lock */
+	up(&(us->current_urb_sem));
+
+	US_DEBUGP("usb_stor_transfer_sg_write() returned %d xferred %u/%u\n",
+		  result, partial, length);
+	return usb_stor_transfer_result(us, pipe, result, partial, length);
+}
+
 /*
  * Transfer an entire SCSI command's worth of data payload over the bulk
  * pipe.
@@ -570,8 +674,14 @@ void usb_stor_transfer(Scsi_Cmnd *srb, struct us_data* us)
 	if (transfer_amount > srb->request_bufflen)
 		transfer_amount = srb->request_bufflen;
 
+	/* are we writing a scatter-gather list?  then keep the pipe busy */
+	if (srb->use_sg > 1 && srb->sc_data_direction == SCSI_DATA_WRITE)
+		result = usb_stor_transfer_sg_write(us,
+				(struct scatterlist *) srb->request_buffer,
+				srb->use_sg, transfer_amount);
+
 	/* are we scatter-gathering? */
-	if (srb->use_sg) {
+	else if (srb->use_sg) {
 
 		/* loop over all the scatter gather structures and 
 		 * make the appropriate requests for each, until done
@@ -93,6 +93,9 @@ struct us_unusual_dev {
 	unsigned int flags;
 };
 
+/* how many bulk URBs a scatter-gather write keeps queued */
+#define US_SG_URBS	4
+
 /* Flag definitions */
 #define US_FL_SINGLE_LUN      0x00000001 /* allow access to only LUN 0	    */
 #define US_FL_MODE_XLATE      0x00000002 /* translate _6 to _10 commands for
@@ -169,6 +172,7 @@ struct us_data {
 	/* control and bulk communications data */
 	struct semaphore	current_urb_sem; /* to protect irq_urb	 */
 	struct urb		*current_urb;	 /* non-int USB requests */
+	struct urb		sg_urb[US_SG_URBS]; /* queued s-g writes */
 
 	/* the semaphore for sleeping the control thread */
 	struct semaphore	sema;		 /* to sleep thread on   */
@@ -336,7 +336,7 @@ ohci_pci_resume (struct pci_dev *dev)
 			enable_irq (ohci->irq);
 #endif
 		if (ohci->hcca->done_head)
-			dl_done_list (ohci, dl_reverse_done_list (ohci));
+			dl_reverse_done_list (ohci);
 		writel (OHCI_INTR_WDH, &ohci->regs->intrenable); 
 		writel (OHCI_BLF, &ohci->regs->cmdstatus); /* start bulk list */
 		writel (OHCI_CLF, &ohci->regs->cmdstatus); /* start Control list */
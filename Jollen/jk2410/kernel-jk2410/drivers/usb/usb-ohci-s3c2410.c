@@ -103,5 +103,5 @@ static void __exit s3c2410_ohci_exit(void)
 	CLKCON &= ~CLKCON_USBH;
 }
 
-module_init(s3c2410_ohci_init);
+module_init_async(s3c2410_ohci_init);
 module_exit(s3c2410_ohci_exit);
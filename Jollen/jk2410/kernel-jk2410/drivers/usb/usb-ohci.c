@@ -478,11 +478,14 @@ static int sohci_return_urb (struct ohci *hc, urb_t * urb)
 #if 1
 			urb->complete (urb);
 
-			/* implicitly requeued */
+			/* implicitly requeued; we're in the bottom half,
+			 * so keep dl_del_list off the ED meanwhile */
+			spin_lock_irqsave (&usb_ed_lock, flags);
   			urb->actual_length = 0;
   			urb->status = USB_ST_URB_PENDING;
   			if (urb_priv->state != URB_DEL)
   				td_submit_urb (urb);
+			spin_unlock_irqrestore (&usb_ed_lock, flags);
 #else
 			if (urb->interval) {
 				urb->complete (urb);
@@ -1357,6 +1360,14 @@ td_fill (ohci_t * ohci, unsigned int info,
 
 /*-------------------------------------------------------------------------*/
  
+/* Only the last TD of a bulk or control transfer asks for a done-queue
+ * interrupt; the ones before it let the HC hold them for up to 6 frames,
+ * so a 64K bulk URB costs one interrupt instead of 16.  A TD retired
+ * with an error interrupts at once whatever its DI, and the 6-frame cap
+ * keeps an unlinked URB's early TDs from sitting in the HC forever.
+ */
+#define TD_DI_LATER	TD_DI_SET (6)
+
 /* prepare all TDs of a transfer */
 
 static void td_submit_urb (urb_t * urb)
@@ -1367,6 +1378,7 @@ static void td_submit_urb (urb_t * urb)
 	int data_len = urb->transfer_buffer_length;
 	int maxps = usb_maxpacket (urb->dev, urb->pipe, usb_pipeout (urb->pipe));
 	int cnt = 0; 
+	int zero_packet;
 	__u32 info = 0;
   	unsigned int toggle = 0;
 
@@ -1392,25 +1404,27 @@ static void td_submit_urb (urb_t * urb)
 	
 	switch (usb_pipetype (urb->pipe)) {
 		case PIPE_BULK:
+			/* If the transfer size is multiple of the pipe mtu,
+			 * we may need an extra TD to create a empty frame
+			 * Note : another way to check this condition is
+			 * to test if(urb_priv->length > cnt) - Jean II */
+			zero_packet = (urb->transfer_flags & USB_ZERO_PACKET) &&
+			    usb_pipeout (urb->pipe) &&
+			    (urb->transfer_buffer_length != 0) && 
+			    ((urb->transfer_buffer_length % maxps) == 0);
+
 			info = usb_pipeout (urb->pipe)? 
 				TD_CC | TD_DP_OUT : TD_CC | TD_DP_IN ;
 			while(data_len > 4096) {		
-				td_fill (ohci, info | (cnt? TD_T_TOGGLE:toggle), data, 4096, urb, cnt);
+				td_fill (ohci, info | TD_DI_LATER | (cnt? TD_T_TOGGLE:toggle), data, 4096, urb, cnt);
 				data += 4096; data_len -= 4096; cnt++;
 			}
 			info = usb_pipeout (urb->pipe)?
 				TD_CC | TD_DP_OUT : TD_CC | TD_R | TD_DP_IN ;
-			td_fill (ohci, info | (cnt? TD_T_TOGGLE:toggle), data, data_len, urb, cnt);
+			td_fill (ohci, info | (zero_packet? TD_DI_LATER:0) | (cnt? TD_T_TOGGLE:toggle), data, data_len, urb, cnt);
 			cnt++;
 
-			/* If the transfer size is multiple of the pipe mtu,
-			 * we may need an extra TD to create a empty frame
-			 * Note : another way to check this condition is
-			 * to test if(urb_priv->length > cnt) - Jean II */
-			if ((urb->transfer_flags & USB_ZERO_PACKET) &&
-			    usb_pipeout (urb->pipe) &&
-			    (urb->transfer_buffer_length != 0) && 
-			    ((urb->transfer_buffer_length % maxps) == 0)) {
+			if (zero_packet) {
 				td_fill (ohci, info | (cnt? TD_T_TOGGLE:toggle), 0, 0, urb, cnt);
 				cnt++;
 			}
@@ -1429,7 +1443,7 @@ static void td_submit_urb (urb_t * urb)
 			break;
 
 		case PIPE_CONTROL:
-			info = TD_CC | TD_DP_SETUP | TD_T_DATA0;
+			info = TD_CC | TD_DP_SETUP | TD_T_DATA0 | TD_DI_LATER;
 			td_fill (ohci, info,
 				pci_map_single (ohci->ohci_dev,
 					urb->setup_packet, 8,
@@ -1439,7 +1453,7 @@ static void td_submit_urb (urb_t * urb)
 				info = usb_pipeout (urb->pipe)? 
 					TD_CC | TD_R | TD_DP_OUT | TD_T_DATA1 : TD_CC | TD_R | TD_DP_IN | TD_T_DATA1;
 				/* NOTE:  mishandles transfers >8K, some >4K */
-				td_fill (ohci, info, data, data_len, urb, cnt++);  
+				td_fill (ohci, info | TD_DI_LATER, data, data_len, urb, cnt++);  
 			} 
 			info = usb_pipeout (urb->pipe)? 
  				TD_CC | TD_DP_IN | TD_T_DATA1: TD_CC | TD_DP_OUT | TD_T_DATA1;
@@ -1537,13 +1551,17 @@ static void dl_del_urb (urb_t * urb)
 /*-------------------------------------------------------------------------*/
 
 /* replies to the request have to be on a FIFO basis so
- * we reverse the reversed done-list */
+ * we reverse the reversed done-list, and queue it for dl_done_tasklet.
+ * This part stays in the interrupt handler: the HC can't write the next
+ * done_head back until we have taken this one, and a halted ED has to
+ * be skipped past its failed URB before the HC looks at it again. */
  
-static td_t * dl_reverse_done_list (ohci_t * ohci)
+static void dl_reverse_done_list (ohci_t * ohci)
 {
 	__u32 td_list_hc;
 	td_t * td_rev = NULL;
 	td_t * td_list = NULL;
+	td_t * td_tail = NULL;
   	urb_priv_t * urb_priv = NULL;
   	unsigned long flags;
   	
@@ -1570,12 +1588,22 @@ static td_t * dl_reverse_done_list (ohci_t * ohci)
 			}
 		}
 
+		if (!td_rev)
+			td_tail = td_list;
 		td_list->next_dl_td = td_rev;	
 		td_rev = td_list;
 		td_list_hc = le32_to_cpup (&td_list->hwNextTD) & 0xfffffff0;	
 	}	
+
+	if (td_list) {
+		if (ohci->dl_tail)
+			ohci->dl_tail->next_dl_td = td_list;
+		else
+			ohci->dl_head = td_list;
+		ohci->dl_tail = td_tail;
+		tasklet_schedule (&ohci->dl_tasklet);
+	}
 	spin_unlock_irqrestore (&usb_ed_lock, flags);
-	return td_list;
 }
 
 /*-------------------------------------------------------------------------*/
@@ -1695,6 +1723,7 @@ static void dl_done_list (ohci_t * ohci, td_t * td_list)
 	urb_t * urb;
 	urb_priv_t * urb_priv;
  	__u32 tdINFO, edHeadP, edTailP;
+	int last;
  	
  	unsigned long flags;
  	
@@ -1707,7 +1736,12 @@ static void dl_done_list (ohci_t * ohci, td_t * td_list)
   		
    		ed = td_list->ed;
    		
+		/* we run in the bottom half, so dl_del_list and
+		 * dl_reverse_done_list may count this URB's TDs too */
+		spin_lock_irqsave (&usb_ed_lock, flags);
    		dl_transfer_length(td_list);
+		last = (++(urb_priv->td_cnt) == urb_priv->length);
+		spin_unlock_irqrestore (&usb_ed_lock, flags);
  			
   		/* error code of transfer */
   		cc = TD_CC_GET (tdINFO);
@@ -1720,7 +1754,7 @@ static void dl_done_list (ohci_t * ohci, td_t * td_list)
 				&& (cc == TD_DATAUNDERRUN))
 			cc = TD_CC_NOERROR;
 
-  		if (++(urb_priv->td_cnt) == urb_priv->length) {
+  		if (last) {
 			if ((ed->state & (ED_OPER | ED_UNLINK))
 					&& (urb_priv->state != URB_DEL)) {
   				urb->status = cc_to_error[cc];
@@ -1747,6 +1781,23 @@ static void dl_done_list (ohci_t * ohci, td_t * td_list)
   	}  
 }
 
+/* bottom half: give back the URBs of the queued done list, so that
+ * completion handlers (and their resubmits) don't run in hard irq */
+
+static void dl_done_tasklet (unsigned long __ohci)
+{
+	ohci_t * ohci = (ohci_t *) __ohci;
+	td_t * td_list;
+	unsigned long flags;
+
+	spin_lock_irqsave (&usb_ed_lock, flags);
+	td_list = ohci->dl_head;
+	ohci->dl_head = ohci->dl_tail = NULL;
+	spin_unlock_irqrestore (&usb_ed_lock, flags);
+
+	dl_done_list (ohci, td_list);
+}
+
 
 
 
@@ -2340,7 +2391,7 @@ static void hc_interrupt (int irq, void * __ohci, struct pt_regs * k)
   
 	if (ints & OHCI_INTR_WDH) {
 		writel (OHCI_INTR_WDH, &regs->intrdisable);	
-		dl_done_list (ohci, dl_reverse_done_list (ohci));
+		dl_reverse_done_list (ohci);
 		writel (OHCI_INTR_WDH, &regs->intrenable); 
 	}
   
@@ -2410,6 +2461,7 @@ static ohci_t * __devinit hc_alloc_ohci (struct pci_dev *dev, void * mem_base)
 	list_add (&ohci->ohci_hcd_list, &ohci_hcd_list);
 
 	INIT_LIST_HEAD (&ohci->timeout_list);
+	tasklet_init (&ohci->dl_tasklet, dl_done_tasklet, (unsigned long) ohci);
 
 	bus = usb_alloc_bus (&sohci_device_operations);
 	if (!bus) {
@@ -2443,6 +2495,7 @@ static void hc_release_ohci (ohci_t * ohci)
 		free_irq (ohci->irq, ohci);
 		ohci->irq = -1;
 	}
+	tasklet_kill (&ohci->dl_tasklet);
 #ifdef CONFIG_PCI
 	pci_set_drvdata(ohci->ohci_dev, 0);
 #endif
@@ -415,9 +415,17 @@ typedef struct ohci {
 	struct hash_list_t	td_hash[TD_HASH_SIZE];
 	struct hash_list_t	ed_hash[ED_HASH_SIZE];
 
+	struct td *td_free_list;	/* recycled TDs, still hashed */
+
+	/* done list, handed from hc_interrupt to the bottom half */
+	struct td *dl_head;
+	struct td *dl_tail;
+	struct tasklet_struct dl_tasklet;
+
 } ohci_t;
 
 #define NUM_EDS 32		/* num of preallocated endpoint descriptors */
+#define NUM_TDS 64		/* num of preallocated transfer descriptors */
 
 struct ohci_device {
 	ed_t 	ed[NUM_EDS];
@@ -564,8 +572,54 @@ hash_free_td (struct ohci * hc, struct td * td)
 }
 
 
+/* TDs ... */
+static inline struct td *
+td_alloc_new (struct ohci *hc, int mem_flags)
+{
+	dma_addr_t	dma;
+	struct td	*td;
+
+	td = pci_pool_alloc (hc->td_cache, mem_flags, &dma);
+	if (td) {
+		td->td_dma = dma;
+
+		/* hash it for later reverse mapping */
+		if (!hash_add_td (hc, td)) {
+			pci_pool_free (hc->td_cache, td, dma);
+			return NULL;
+		}
+	}
+	return td;
+}
+
+/*
+ * Freed TDs go on a per-controller free list, keeping their hash entry,
+ * so that a bulk stream doesn't pay for a pool allocation and a hash
+ * insert and removal on every 4K of data.  Callers hold usb_ed_lock.
+ */
+static inline struct td *
+td_alloc (struct ohci *hc, int mem_flags)
+{
+	struct td	*td = hc->td_free_list;
+
+	if (td) {
+		hc->td_free_list = td->next_dl_td;
+		return td;
+	}
+	return td_alloc_new (hc, mem_flags);
+}
+
+static inline void
+td_free (struct ohci *hc, struct td *td)
+{
+	td->next_dl_td = hc->td_free_list;
+	hc->td_free_list = td;
+}
+
 static int ohci_mem_init (struct ohci *ohci)
 {
+	int i;
+
 	ohci->td_cache = pci_pool_create ("ohci_td", ohci->ohci_dev,
 		sizeof (struct td),
 		32 /* byte alignment */,
@@ -580,11 +634,26 @@ static int ohci_mem_init (struct ohci *ohci)
 		GFP_KERNEL | OHCI_MEM_FLAGS);
 	if (!ohci->dev_cache)
 		return -ENOMEM;
+
+	for (i = 0; i < NUM_TDS; i++) {
+		struct td *td = td_alloc_new (ohci, SLAB_KERNEL);
+
+		if (!td)
+			return -ENOMEM;
+		td_free (ohci, td);
+	}
 	return 0;
 }
 
 static void ohci_mem_cleanup (struct ohci *ohci)
 {
+	while (ohci->td_free_list) {
+		struct td *td = ohci->td_free_list;
+
+		ohci->td_free_list = td->next_dl_td;
+		hash_free_td (ohci, td);
+		pci_pool_free (ohci->td_cache, td, td->td_dma);
+	}
 	if (ohci->td_cache) {
 		printk(__FUNCTION__"(%d)\n", __LINE__);
 		pci_pool_destroy (ohci->td_cache);
@@ -599,34 +668,6 @@ static void ohci_mem_cleanup (struct ohci *ohci)
 	}
 }
 
-/* TDs ... */
-static inline struct td *
-td_alloc (struct ohci *hc, int mem_flags)
-{
-	dma_addr_t	dma;
-	struct td	*td;
-
-	td = pci_pool_alloc (hc->td_cache, mem_flags, &dma);
-	if (td) {
-		td->td_dma = dma;
-
-		/* hash it for later reverse mapping */
-		if (!hash_add_td (hc, td)) {
-			pci_pool_free (hc->td_cache, td, dma);
-			return NULL;
-		}
-	}
-	return td;
-}
-
-static inline void
-td_free (struct ohci *hc, struct td *td)
-{
-	hash_free_td (hc, td);
-	pci_pool_free (hc->td_cache, td, td->td_dma);
-}
-
-
 /* DEV + EDs ... only the EDs need to be consistent */
 static inline struct ohci_device *
 dev_alloc (struct ohci *hc, int mem_flags)
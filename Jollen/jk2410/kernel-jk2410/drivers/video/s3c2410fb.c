@@ -15,6 +15,9 @@
 #include <asm/io.h>
 #include <asm/irq.h>
 #include <asm/mach-types.h>
+#ifdef CONFIG_PM
+#include <asm/arch/pm.h>
+#endif
 #include <asm/uaccess.h>
 
 #include <video/fbcon.h>
@@ -619,41 +622,39 @@ static int s3c2410fb_switch(int con, struct fb_info *info)
 }
 
 #ifdef CONFIG_PM
+/*
+ * LCD controller state across sleep, LCDCON1 last so the controller
+ * is only enabled again once it is fully set up.
+ */
+static struct sleep_save lcd_save[] = {
+	SAVE_ITEM(LCDCON2), SAVE_ITEM(LCDCON3), SAVE_ITEM(LCDCON4),
+	SAVE_ITEM(LCDCON5),
+	SAVE_ITEM(LCDADDR1), SAVE_ITEM(LCDADDR2), SAVE_ITEM(LCDADDR3),
+	SAVE_ITEM(LCDLPCSEL),
+	SAVE_ITEM(LCDCON1),
+};
+
 /*
  * Power management hook. Note that we won't be called from IRQ context,
  * unlike the blank functions above, so we may sleep
  */
 static int s3c2410_pm_callback(struct pm_dev *pm_dev, pm_request_t req, void *data)
 {
-	struct s3c2410fb_info *fbi = pm_dev->data;
 	u_long flags;
 
 	//printk("pm_callback: %d\n", req);
 
 	if (req == PM_SUSPEND) {
+		s3c2410_pm_do_save(lcd_save, ARRAY_SIZE(lcd_save));
 		/* disable LCD controller */
 		LCDCON1 &= ~(1 << 0);
 	} else if (req == PM_RESUME) {
 		/* reinitialize LCD controllers and GPIOs */
 		save_flags_cli(flags);
 
-		LCDCON1 = fbi->reg.lcdcon1;
-		LCDCON2 = fbi->reg.lcdcon2;
-		LCDCON3 = fbi->reg.lcdcon3;
-		LCDCON4 = fbi->reg.lcdcon4;
-		LCDCON5 = fbi->reg.lcdcon5;
-		LCDADDR1 = fbi->reg.lcdsaddr1;
-		LCDADDR2 = fbi->reg.lcdsaddr2;
-		LCDADDR3 = fbi->reg.lcdsaddr3;
-
-#if defined(CONFIG_S3C2410_SMDK) && !defined(CONFIG_SMDK_AIJI)
-		LCDLPCSEL = 0x2;	
-#elif defined(CONFIG_S3C2410_SMDK) && defined(CONFIG_SMDK_AIJI)
-		LCDLPCSEL = 0x7;
-#endif
-
+		LCDCON1 &= ~LCD1_ENVID;
+		s3c2410_pm_do_restore(lcd_save, ARRAY_SIZE(lcd_save));
 		TPAL = 0;
-		LCDCON1 |= LCD1_ENVID;
 
 		restore_flags(flags);
 	}
@@ -665,7 +666,7 @@ static int s3c2410_pm_callback(struct pm_dev *pm_dev, pm_request_t req, void *da
 static int __init s3c2410fb_map_video_memory(struct s3c2410fb_info *fbi)
 {
     fbi->map_size = PAGE_ALIGN(fbi->fb.fix.smem_len + PAGE_SIZE);
-    fbi->map_cpu = consistent_alloc(GFP_KERNEL, fbi->map_size,
+    fbi->map_cpu = consistent_alloc_writecombine(GFP_KERNEL, fbi->map_size,
 	    			    &fbi->map_dma);
 
     if (fbi->map_cpu) {
@@ -810,8 +811,10 @@ int __init s3c2410fb_init(void)
 	 * power donw the display prior to sleeping
 	 */
 	fbi->pm = pm_register(PM_DEBUG_DEV, PM_SYS_VGA, s3c2410_pm_callback);
-	if (fbi->pm)
+	if (fbi->pm) {
 		fbi->pm->data = fbi;
+		fbi->pm->flags |= PM_FLAG_ASYNC_RESUME;
+	}
 #endif
 
    /* enable the LCD controller) */
@@ -47,6 +47,7 @@
 #include <linux/highmem.h>
 #include <linux/module.h>
 #include <linux/completion.h>
+#include <linux/proc_fs.h>
 
 #include <asm/uaccess.h>
 #include <asm/io.h>
@@ -119,6 +120,87 @@ union bdflush_param {
 int bdflush_min[N_PARAM] = {  0,  10,    5,   25,  0,   1*HZ,   0, 0, 0};
 int bdflush_max[N_PARAM] = {100,50000, 20000, 20000,10000*HZ, 6000*HZ, 100, 0, 0};
 
+/*
+ * Per-device writeback.  Each block device that gets dirty buffers is
+ * given a slot here with its own count of dirty and in-flight bytes and,
+ * once bdflush has started it, its own flush thread.  Writers are only
+ * throttled on the I/O of the device they dirty, and a slow device only
+ * holds up its own thread.  Slots are never given back; the buffers of a
+ * device that finds the table full are left to bdflush and kupdate.
+ */
+#define NR_WB_DEVS	16
+
+struct wb_dev {
+	kdev_t dev;
+	int started;			/* bdflush has forked its thread */
+	int running;			/* ... and the thread is up */
+	int flush_old;			/* kupdate found aged buffers */
+	unsigned long dirty;		/* bytes on BUF_DIRTY and BUF_LOCKED */
+	unsigned long nr_dirty;		/* buffers on BUF_DIRTY */
+	unsigned long written;		/* buffers submitted */
+	unsigned long throttled;	/* writers made to wait */
+	wait_queue_head_t wait;
+};
+
+static struct wb_dev wb_devs[NR_WB_DEVS];
+static struct wb_dev *wb_last;		/* last lookup */
+static int nr_wb_devs;
+static unsigned long wb_tracked;	/* sum of wb_devs[].dirty */
+
+/* Called with the LRU lock held */
+static struct wb_dev *wb_dev_find(kdev_t dev, int create)
+{
+	struct wb_dev *wb = wb_last;
+	int i;
+
+	if (dev == NODEV)
+		return NULL;
+	if (wb && wb->dev == dev)
+		return wb;
+	for (i = 0; i < nr_wb_devs; i++) {
+		wb = wb_devs + i;
+		if (wb->dev == dev)
+			return wb_last = wb;
+	}
+	if (!create || nr_wb_devs == NR_WB_DEVS)
+		return NULL;
+
+	wb = wb_devs + nr_wb_devs;
+	wb->dev = dev;
+	init_waitqueue_head(&wb->wait);
+	nr_wb_devs++;
+	wakeup_bdflush();		/* to start its thread */
+	return wb_last = wb;
+}
+
+static inline void wb_account(struct buffer_head *bh, int blist, long size)
+{
+	if (blist == BUF_DIRTY || blist == BUF_LOCKED) {
+		struct wb_dev *wb = wb_dev_find(bh->b_dev, 1);
+
+		if (wb) {
+			wb->dirty += size;
+			wb_tracked += size;
+			if (blist == BUF_DIRTY)
+				wb->nr_dirty += size > 0 ? 1 : -1;
+		}
+	}
+}
+
+/* Dirty and in-flight bytes that no device thread looks after */
+static unsigned long wb_unowned(void)
+{
+	unsigned long n;
+	int i;
+
+	n = size_buffers_type[BUF_DIRTY] + size_buffers_type[BUF_LOCKED];
+	n -= wb_tracked;
+	for (i = 0; i < nr_wb_devs; i++)
+		if (!wb_devs[i].running)
+			n += wb_devs[i].dirty;
+	return n;
+}
+
 void unlock_buffer(struct buffer_head *bh)
 {
 	clear_bit(BH_Wait_IO, &bh->b_state);
@@ -172,38 +254,85 @@ void end_buffer_io_sync(struct buffer_head *bh, int uptodate)
  * The buffers have been marked clean and locked.  Just submit the dang
  * things.. 
  */
+static inline int bh_before(struct buffer_head *a, struct buffer_head *b)
+{
+	if (a->b_dev != b->b_dev)
+		return kdev_t_to_nr(a->b_dev) < kdev_t_to_nr(b->b_dev);
+	return a->b_blocknr * (a->b_size >> 9) < b->b_blocknr * (b->b_size >> 9);
+}
+
 static void write_locked_buffers(struct buffer_head **array, unsigned int count)
 {
+	unsigned int i, j;
+
+	/* hand them to the driver in block order */
+	for (i = 1; i < count; i++) {
+		struct buffer_head *bh = array[i];
+
+		for (j = i; j > 0 && bh_before(bh, array[j-1]); j--)
+			array[j] = array[j-1];
+		array[j] = bh;
+	}
+
 	do {
 		struct buffer_head * bh = *array++;
+		struct wb_dev *wb = wb_dev_find(bh->b_dev, 0);
+
+		if (wb)
+			wb->written++;
 		bh->b_end_io = end_buffer_io_sync;
 		submit_bh(WRITE, bh);
 	} while (--count);
 }
 
 /*
- * Write some buffers from the head of the dirty queue.
+ * Write some buffers from the head of the dirty queue.  With "aged"
+ * set, stop at the first buffer not due to be flushed by "before".
+ * For a device with a slot, the walk ends after the last of its
+ * nr_dirty buffers, and doesn't start if it has none, so that the
+ * per-device threads don't each scan the whole of BUF_DIRTY.
  *
  * This must be called with the LRU lock held, and will
  * return without it!
  */
 #define NRSYNC (32)
-static int write_some_buffers(kdev_t dev)
+static int __write_some_buffers(kdev_t dev, int aged, unsigned long before)
 {
 	struct buffer_head *next;
 	struct buffer_head *array[NRSYNC];
+	unsigned long left = ~0UL;
 	unsigned int count;
 	int nr;
 
+	if (dev) {
+		struct wb_dev *wb = wb_dev_find(dev, 0);
+
+		if (wb)
+			left = wb->nr_dirty;
+		if (!left) {
+			spin_unlock(&lru_list_lock);
+			return 0;
+		}
+	}
+
 	next = lru_list[BUF_DIRTY];
 	nr = nr_buffers_type[BUF_DIRTY];
 	count = 0;
 	while (next && --nr >= 0) {
 		struct buffer_head * bh = next;
+
+		if (conditional_schedule_needed())
+			break;
 		next = bh->b_next_free;
 
+		if (aged && time_after(bh->b_flushtime, before)) {
+			next = NULL;
+			break;
+		}
 		if (dev && bh->b_dev != dev)
 			continue;
+		if (dev && !--left)
+			next = NULL;	/* the device's last one */
 		if (test_and_set_bit(BH_Lock, &bh->b_state))
 			continue;
 		if (atomic_set_buffer_clean(bh)) {
@@ -224,15 +353,29 @@ static int write_some_buffers(kdev_t dev)
 
 	if (count)
 		write_locked_buffers(array, count);
+	/* stopped early to reschedule: ask the caller to come back */
+	if (next && nr >= 0)
+		return -EAGAIN;
 	return 0;
 }
 
+static inline int write_some_buffers(kdev_t dev)
+{
+	return __write_some_buffers(dev, 0, 0);
+}
+
+static inline int write_old_buffers(kdev_t dev, unsigned long before)
+{
+	return __write_some_buffers(dev, 1, before);
+}
+
 /*
  * Write out all buffers on the dirty list.
  */
 static void write_unlocked_buffers(kdev_t dev)
 {
 	do {
+		conditional_schedule();
 		spin_lock(&lru_list_lock);
 	} while (write_some_buffers(dev));
 	run_task_queue(&tq_disk);
@@ -253,6 +396,26 @@ static int wait_for_buffers(kdev_t dev, int index, int refile)
 	nr = nr_buffers_type[index];
 	while (next && --nr >= 0) {
 		struct buffer_head *bh = next;
+
+		if (conditional_schedule_needed()) {
+			/*
+			 * Reschedule and carry on with the walk: returning
+			 * here would let wait_for_some_buffers() callers skip
+			 * their throttling.  Resume at bh if it is still on
+			 * this list, else start over.
+			 */
+			get_bh(bh);
+			spin_unlock(&lru_list_lock);
+			conditional_schedule();
+			spin_lock(&lru_list_lock);
+			put_bh(bh);
+			if (bh->b_list != index) {
+				next = lru_list[index];
+				nr = nr_buffers_type[index];
+			} else
+				nr++;	/* bh is looked at again */
+			continue;
+		}
 		next = bh->b_next_free;
 
 		if (!buffer_locked(bh)) {
@@ -282,6 +445,7 @@ static inline void wait_for_some_buffers(kdev_t dev)
 static int wait_for_locked_buffers(kdev_t dev, int index, int refile)
 {
 	do {
+		conditional_schedule();
 		spin_lock(&lru_list_lock);
 	} while (wait_for_buffers(dev, index, refile));
 	return 0;
@@ -518,6 +682,7 @@ static void __insert_into_lru_list(struct buffer_head * bh, int blist)
 	(*bhp)->b_prev_free = bh;
 	nr_buffers_type[blist]++;
 	size_buffers_type[blist] += bh->b_size;
+	wb_account(bh, blist, bh->b_size);
 }
 
 static void __remove_from_lru_list(struct buffer_head * bh)
@@ -538,6 +703,7 @@ static void __remove_from_lru_list(struct buffer_head * bh)
 		bh->b_prev_free = NULL;
 		nr_buffers_type[blist]--;
 		size_buffers_type[blist] -= bh->b_size;
+		wb_account(bh, blist, -(long)bh->b_size);
 	}
 }
 
@@ -1063,20 +1229,79 @@ static int balance_dirty_state(void)
 	return -1;
 }
 
+static unsigned long wb_limit(unsigned long limit, unsigned long others, int active)
+{
+	unsigned long share = limit / active;
+
+	return limit > others + share ? limit - others : share;
+}
+
+/*
+ * The same for one device.  A device may fill the dirty limits less what
+ * the other devices hold, and always at least an even share of them
+ * among the devices that have dirty buffers, so that a heavy writer to
+ * one device can't get the writers to another throttled.
+ */
+static int wb_dirty_state(struct wb_dev *wb)
+{
+	unsigned long dirty, others, tot, limit;
+	int i, active = 0;
+
+	for (i = 0; i < nr_wb_devs; i++)
+		if (wb_devs[i].dirty)
+			active++;
+	if (!active)
+		active = 1;
+
+	others = size_buffers_type[BUF_DIRTY] + size_buffers_type[BUF_LOCKED];
+	others = (others - wb->dirty) >> PAGE_SHIFT;
+	dirty = wb->dirty >> PAGE_SHIFT;
+	tot = nr_free_buffer_pages();
+
+	limit = wb_limit(tot * bdf_prm.b_un.nfract / 100, others, active);
+	if (dirty > limit) {
+		limit = wb_limit(tot * bdf_prm.b_un.nfract_sync / 100, others, active);
+		if (dirty > limit && !(current->flags & PF_NOIO))
+			return 1;
+		return 0;
+	}
+
+	return -1;
+}
+
 /*
  * if a new dirty buffer is created we need to balance bdflush.
  *
- * in the future we might want to make bdflush aware of different
- * pressures on different devices - thus the (currently unused)
- * 'dev' parameter.
+ * When the device is known and has its own flush thread, only that
+ * device's buffers are written and waited on here, and only once it
+ * holds more than its share.
  */
-void balance_dirty(void)
+static void balance_dirty_dev(kdev_t dev)
 {
+	struct wb_dev *wb;
 	int state = balance_dirty_state();
 
 	if (state < 0)
 		return;
 
+	wb = wb_dev_find(dev, 0);
+	if (wb && wb->running) {
+		state = wb_dirty_state(wb);
+		if (state < 0) {
+			/* other devices' buffers, bdflush kicks their threads */
+			wakeup_bdflush();
+			return;
+		}
+		spin_lock(&lru_list_lock);
+		write_some_buffers(dev);
+		if (state > 0) {
+			wb->throttled++;
+			wait_for_some_buffers(dev);
+		}
+		wake_up_interruptible(&wb->wait);
+		return;
+	}
+
 	/* If we're getting into imbalance, start write-out */
 	spin_lock(&lru_list_lock);
 	write_some_buffers(NODEV);
@@ -1093,6 +1318,11 @@ void balance_dirty(void)
 	}
 }
 
+void balance_dirty(void)
+{
+	balance_dirty_dev(NODEV);
+}
+
 inline void __mark_dirty(struct buffer_head *bh)
 {
 	bh->b_flushtime = jiffies + bdf_prm.b_un.age_buffer;
@@ -1111,7 +1341,7 @@ void mark_buffer_dirty(struct buffer_head *bh)
 {
 	if (!atomic_set_buffer_dirty(bh)) {
 		__mark_dirty(bh);
-		balance_dirty();
+		balance_dirty_dev(bh->b_dev);
 	}
 }
 
@@ -1731,7 +1961,7 @@ static int __block_commit_write(struct inode *inode, struct page *page,
 	}
 
 	if (need_balance_dirty)
-		balance_dirty();
+		balance_dirty_dev(head->b_dev);
 	/*
 	 * is this a partial write that happened to make all buffers
 	 * uptodate then we can optimize away a bogus readpage() for
@@ -2830,6 +3060,64 @@ void wakeup_bdflush(void)
 	wake_up_interruptible(&bdflush_wait);
 }
 
+/*
+ * Start a flush thread for every device that got a slot since the last
+ * time round.  Only bdflush does this, so the threads are children of a
+ * kernel thread rather than of whoever dirtied the first buffer.
+ */
+static int wb_flush(void *data);
+
+static void wb_start_threads(void)
+{
+	int i;
+
+	for (i = 0; i < nr_wb_devs; i++) {
+		struct wb_dev *wb = wb_devs + i;
+
+		if (wb->started)
+			continue;
+		wb->started = 1;
+		if (kernel_thread(wb_flush, wb, CLONE_FS | CLONE_FILES | CLONE_SIGNAL) < 0)
+			wb->started = 0;
+	}
+}
+
+static void wb_wakeup_all(void)
+{
+	int i;
+
+	for (i = 0; i < nr_wb_devs; i++)
+		if (wb_devs[i].running && wb_devs[i].dirty)
+			wake_up_interruptible(&wb_devs[i].wait);
+}
+
+/*
+ * Tell the threads of the devices whose oldest dirty buffers are due.
+ * The dirty list is in the order the buffers were dirtied, so the scan
+ * stops at the first buffer that is not.
+ */
+static void wb_kick_old(void)
+{
+	struct buffer_head *bh;
+	int nr;
+
+	spin_lock(&lru_list_lock);
+	bh = lru_list[BUF_DIRTY];
+	nr = nr_buffers_type[BUF_DIRTY];
+	while (bh && --nr >= 0 && !time_before(jiffies, bh->b_flushtime)) {
+		struct wb_dev *wb = wb_dev_find(bh->b_dev, 0);
+
+		if (wb && wb->running && !wb->flush_old) {
+			wb->flush_old = 1;
+			wake_up_interruptible(&wb->wait);
+		}
+		if (conditional_schedule_needed())
+			break;
+		bh = bh->b_next_free;
+	}
+	spin_unlock(&lru_list_lock);
+}
+
 /* 
  * Here we attempt to write back old buffers.  We also try to flush inodes 
  * and supers as well, since this function is essentially "update", and 
@@ -2845,9 +3133,14 @@ static int sync_old_buffers(void)
 	sync_supers(0);
 	unlock_kernel();
 
+	wb_kick_old();
+	if (!wb_unowned())
+		return 0;
+
 	for (;;) {
 		struct buffer_head *bh;
 
+		conditional_schedule();
 		spin_lock(&lru_list_lock);
 		bh = lru_list[BUF_DIRTY];
 		if (!bh || time_before(jiffies, bh->b_flushtime))
@@ -2950,6 +3243,15 @@ int bdflush(void *startup)
 	for (;;) {
 		CHECK_EMERGENCY_SYNC
 
+		wb_start_threads();
+		conditional_schedule();
+		if (!wb_unowned()) {
+			/* the device threads have all of it */
+			if (balance_dirty_state() >= 0)
+				wb_wakeup_all();
+			interruptible_sleep_on(&bdflush_wait);
+			continue;
+		}
 		spin_lock(&lru_list_lock);
 		if (!write_some_buffers(NODEV) || balance_dirty_state() < 0) {
 			wait_for_some_buffers(NODEV);
@@ -2958,6 +3260,61 @@ int bdflush(void *startup)
 	}
 }
 
+/*
+ * The flush thread of one device.  It writes while the device is over
+ * its share of the dirty limits, or while the buffer cache as a whole is
+ * and bdflush has woken it.  When kupdate finds its oldest buffers due it
+ * also takes along everything that would fall due before the next pass,
+ * so the device sees one batch per pass rather than a trickle.
+ */
+static int wb_flush(void *data)
+{
+	struct wb_dev *wb = data;
+	struct task_struct *tsk = current;
+	DECLARE_WAITQUEUE(wait, tsk);
+
+	tsk->session = 1;
+	tsk->pgrp = 1;
+	sprintf(tsk->comm, "bdflush/%02x:%02x", MAJOR(wb->dev), MINOR(wb->dev));
+
+	/* avoid getting signals */
+	spin_lock_irq(&tsk->sigmask_lock);
+	flush_signals(tsk);
+	sigfillset(&tsk->blocked);
+	recalc_sigpending(tsk);
+	spin_unlock_irq(&tsk->sigmask_lock);
+
+	wb->running = 1;
+
+	for (;;) {
+		int more;
+
+		conditional_schedule();
+		spin_lock(&lru_list_lock);
+		if (wb_dirty_state(wb) >= 0 || balance_dirty_state() >= 0)
+			more = write_some_buffers(wb->dev);
+		else if (wb->flush_old)
+			more = write_old_buffers(wb->dev, jiffies + bdf_prm.b_un.interval);
+		else {
+			spin_unlock(&lru_list_lock);
+			more = 0;
+		}
+		if (more)
+			continue;
+
+		wb->flush_old = 0;
+		wait_for_some_buffers(wb->dev);
+
+		/* a wakeup from here on isn't lost: we're on the queue */
+		add_wait_queue(&wb->wait, &wait);
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (wb_dirty_state(wb) < 0 && !wb->flush_old)
+			schedule();
+		__set_current_state(TASK_RUNNING);
+		remove_wait_queue(&wb->wait, &wait);
+	}
+}
+
 /*
  * This is the kernel update daemon. It was used to live in userspace
  * but since it's need to run safely we want it unkillable by mistake.
@@ -2983,7 +3340,8 @@ int kupdate(void *startup)
 	complete((struct completion *)startup);
 
 	for (;;) {
-		wait_for_some_buffers(NODEV);
+		if (wb_unowned())
+			wait_for_some_buffers(NODEV);
 
 		/* update interval */
 		interval = bdf_prm.b_un.interval;
@@ -3015,14 +3373,58 @@ int kupdate(void *startup)
 	}
 }
 
+static int writeback_read_proc(char *page, char **start, off_t off,
+				int count, int *eof, void *data)
+{
+	char *p = page;
+	int i, len;
+
+	p += sprintf(p, "dev   dirty(kB)   written throttled thread\n");
+	for (i = 0; i < nr_wb_devs; i++) {
+		struct wb_dev *wb = wb_devs + i;
+
+		p += sprintf(p, "%02x:%02x %9lu %9lu %9lu %s\n",
+			     MAJOR(wb->dev), MINOR(wb->dev), wb->dirty >> 10,
+			     wb->written, wb->throttled,
+			     wb->running ? "yes" : "no");
+	}
+	p += sprintf(p, "unowned dirty(kB): %lu\n", wb_unowned() >> 10);
+
+	len = (p - page) - off;
+	if (len < 0)
+		len = 0;
+	*eof = (len <= count) ? 1 : 0;
+	*start = page + off;
+	return len;
+}
+
+static int writeback_write_proc(struct file *file, const char *buffer,
+				unsigned long count, void *data)
+{
+	int i;
+
+	for (i = 0; i < nr_wb_devs; i++) {
+		wb_devs[i].written = 0;
+		wb_devs[i].throttled = 0;
+	}
+	return count;
+}
+
 static int __init bdflush_init(void)
 {
 	static struct completion startup __initdata = COMPLETION_INITIALIZER(startup);
+	struct proc_dir_entry *ent;
 
 	kernel_thread(bdflush, &startup, CLONE_FS | CLONE_FILES | CLONE_SIGNAL);
 	wait_for_completion(&startup);
 	kernel_thread(kupdate, &startup, CLONE_FS | CLONE_FILES | CLONE_SIGNAL);
 	wait_for_completion(&startup);
+
+	ent = create_proc_entry("writeback", S_IWUSR | S_IRUGO, NULL);
+	if (ent) {
+		ent->read_proc = writeback_read_proc;
+		ent->write_proc = writeback_write_proc;
+	}
 	return 0;
 }
 
@@ -55,6 +55,18 @@ static LIST_HEAD(dentry_unused);
 /* Statistics gathering. */
 struct dentry_stat_t dentry_stat = {0, 0, 45, 0,};
 
+/*
+ * Negative dentries make repeated lookups of missing names cheap, but
+ * a workload probing many different names can fill the dcache with
+ * them.  Past this many unused ones, dput() frees a negative dentry
+ * instead of keeping it.  0 means no limit.  Set to the number of hash
+ * buckets at boot, /proc/sys/fs/dentry-negative-max.
+ */
+int dentry_negative_max;
+
+/* Size of the hash table from the command line, see dcache_init() */
+static unsigned long dhash_entries __initdata;
+
 /* no dcache_lock, please */
 static inline void d_free(struct dentry *dentry)
 {
@@ -137,6 +149,12 @@ repeat:
 	/* Unreachable? Get rid of it */
 	if (list_empty(&dentry->d_hash))
 		goto kill_it;
+	if (!dentry->d_inode) {
+		if (dentry_negative_max &&
+		    dentry_stat.nr_negative >= dentry_negative_max)
+			goto unhash_it;
+		dentry_stat.nr_negative++;
+	}
 	list_add(&dentry->d_lru, &dentry_unused);
 	dentry_stat.nr_unused++;
 	spin_unlock(&dcache_lock);
@@ -213,13 +231,25 @@ int d_invalidate(struct dentry * dentry)
 	return 0;
 }
 
+/*
+ * A dentry has just left dentry_unused.  Whether it is negative cannot
+ * change while it sits there unreferenced, so nr_negative stays exact.
+ * Called with dcache_lock held.
+ */
+static inline void dentry_unused_dec(struct dentry *dentry)
+{
+	dentry_stat.nr_unused--;
+	if (!dentry->d_inode)
+		dentry_stat.nr_negative--;
+}
+
 /* This should be called _only_ with dcache_lock held */
 
 static inline struct dentry * __dget_locked(struct dentry *dentry)
 {
 	atomic_inc(&dentry->d_count);
 	if (atomic_read(&dentry->d_count) == 1) {
-		dentry_stat.nr_unused--;
+		dentry_unused_dec(dentry);
 		list_del_init(&dentry->d_lru);
 	}
 	return dentry;
@@ -332,13 +362,17 @@ void prune_dcache(int count)
 		list_del_init(tmp);
 		dentry = list_entry(tmp, struct dentry, d_lru);
 
-		/* If the dentry was recently referenced, don't free it. */
-		if (dentry->d_vfs_flags & DCACHE_REFERENCED) {
+		/*
+		 * If the dentry was recently referenced, don't free it.
+		 * Negative ones get no second chance: they pin no inode
+		 * and are cheap to recreate.
+		 */
+		if ((dentry->d_vfs_flags & DCACHE_REFERENCED) && dentry->d_inode) {
 			dentry->d_vfs_flags &= ~DCACHE_REFERENCED;
 			list_add(&dentry->d_lru, &dentry_unused);
 			continue;
 		}
-		dentry_stat.nr_unused--;
+		dentry_unused_dec(dentry);
 
 		/* Unused dentry with a count? */
 		if (atomic_read(&dentry->d_count))
@@ -407,7 +441,7 @@ repeat:
 			continue;
 		if (atomic_read(&dentry->d_count))
 			continue;
-		dentry_stat.nr_unused--;
+		dentry_unused_dec(dentry);
 		list_del_init(tmp);
 		prune_one_dentry(dentry);
 		goto repeat;
@@ -731,6 +765,11 @@ struct dentry * d_lookup(struct dentry * parent, struct qstr * name)
 		}
 		__dget_locked(dentry);
 		dentry->d_vfs_flags |= DCACHE_REFERENCED;
+		/* keep the names being walked at the front of their chain */
+		if (head->next != &dentry->d_hash) {
+			list_del(&dentry->d_hash);
+			list_add(&dentry->d_hash, head);
+		}
 		spin_unlock(&dcache_lock);
 		return dentry;
 	}
@@ -1164,6 +1203,16 @@ out:
 	return ino;
 }
 
+static int __init set_dhash_entries(char *str)
+{
+	if (!str)
+		return 0;
+	dhash_entries = simple_strtoul(str, &str, 0);
+	return 1;
+}
+
+__setup("dhash_entries=", set_dhash_entries);
+
 static void __init dcache_init(unsigned long mempages)
 {
 	struct list_head *d;
@@ -1187,9 +1236,14 @@ static void __init dcache_init(unsigned long mempages)
 	if (!dentry_cache)
 		panic("Cannot create dentry cache");
 
+	/* dhash_entries= overrides the sizing by memory, rounded up */
+	if (dhash_entries)
+		mempages = dhash_entries;
+	else {
 #if PAGE_SHIFT < 13
-	mempages >>= (13 - PAGE_SHIFT);
+		mempages >>= (13 - PAGE_SHIFT);
 #endif
+	}
 	mempages *= sizeof(struct list_head);
 	for (order = 0; ((1UL << order) << PAGE_SHIFT) < mempages; order++)
 		;
@@ -1216,6 +1270,8 @@ static void __init dcache_init(unsigned long mempages)
 	if (!dentry_hashtable)
 		panic("Failed to allocate dcache hash table\n");
 
+	dentry_negative_max = nr_hash;
+
 	d = dentry_hashtable;
 	i = nr_hash;
 	do {
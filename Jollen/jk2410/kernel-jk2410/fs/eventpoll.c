@@ -0,0 +1,743 @@
+/*
+ *  linux/fs/eventpoll.c
+ *
+ *  Event based readiness notification (epoll).
+ *
+ *  select() and poll() build a wait table on every call and tear it
+ *  down again before returning, so every wakeup costs O(number of fds).
+ *  Here the interest set lives in the kernel: a file is hooked into its
+ *  wait queues once, at EPOLL_CTL_ADD time, with callback entries that
+ *  move it onto a ready list, and epoll_wait() only looks at that list.
+ *
+ *  Any file whose f_op->poll() uses poll_wait() can be watched: sockets,
+ *  pipes, ttys and the char drivers.
+ */
+
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/sched.h>
+#include <linux/fs.h>
+#include <linux/file.h>
+#include <linux/slab.h>
+#include <linux/poll.h>
+#include <linux/string.h>
+#include <linux/list.h>
+#include <linux/wait.h>
+#include <linux/eventpoll.h>
+#include <asm/uaccess.h>
+#include <asm/semaphore.h>
+
+#define EVENTPOLLFS_MAGIC	0x03111965
+
+/* Hash table size limits, picked from the epoll_create() size hint */
+#define EP_MIN_HASH_BITS	4
+#define EP_MAX_HASH_BITS	10
+
+/* Most events one epoll_wait() can return */
+#define EP_MAX_EVENTS		(INT_MAX / sizeof(struct epoll_event))
+
+/* Always reported, asked for or not */
+#define EP_PRIVATE_BITS		(POLLERR | POLLHUP)
+
+struct eventpoll {
+	/* protects the hash and the items; held for write by ctl */
+	struct rw_semaphore sem;
+	/* protects rdllist, taken from the wakeup callbacks */
+	spinlock_t lock;
+	/* tasks sleeping in epoll_wait() */
+	wait_queue_head_t wq;
+	/* poll()/select() on the epoll fd itself */
+	wait_queue_head_t poll_wait;
+	/* items that (may) have events to report */
+	struct list_head rdllist;
+	unsigned int hashbits;
+	struct list_head *hash;
+};
+
+/* One wait queue an item is hooked into */
+struct eppoll_entry {
+	struct list_head llink;		/* epitem->pwqlist */
+	struct epitem *base;
+	wait_queue_t wait;
+	wait_queue_head_t *whead;
+};
+
+/* One watched (file, fd) pair */
+struct epitem {
+	struct list_head llink;		/* hash chain */
+	struct list_head rdllink;	/* ep->rdllist, or empty */
+	struct list_head fllink;	/* file->f_ep_links */
+	struct list_head pwqlist;	/* eppoll_entry's */
+	int nwait;			/* wait queues hooked, -1 on failure */
+	struct eventpoll *ep;
+	struct file *file;
+	int fd;
+	struct epoll_event event;
+};
+
+/* poll_table handed to f_op->poll() when an item is inserted */
+struct ep_pqueue {
+	poll_table pt;
+	struct epitem *epi;
+};
+
+/* Serializes releasing watched files against releasing epoll fds */
+static DECLARE_MUTEX(epsem);
+
+static kmem_cache_t *epi_cache;
+static kmem_cache_t *pwq_cache;
+static struct vfsmount *eventpoll_mnt;
+
+static int ep_eventpoll_close(struct inode *inode, struct file *file);
+static unsigned int ep_eventpoll_poll(struct file *file, poll_table *wait);
+
+static struct file_operations eventpoll_fops = {
+	release:	ep_eventpoll_close,
+	poll:		ep_eventpoll_poll,
+};
+
+static inline int is_file_epoll(struct file *f)
+{
+	return f->f_op == &eventpoll_fops;
+}
+
+static inline struct list_head *ep_hash_entry(struct eventpoll *ep,
+					      struct file *file, int fd)
+{
+	unsigned long h = ((unsigned long) file / sizeof(struct file)) + fd;
+
+	h ^= h >> ep->hashbits;
+	return &ep->hash[h & ((1 << ep->hashbits) - 1)];
+}
+
+static struct epitem *ep_find(struct eventpoll *ep, struct file *file, int fd)
+{
+	struct list_head *head = ep_hash_entry(ep, file, fd);
+	struct list_head *p;
+
+	list_for_each(p, head) {
+		struct epitem *epi = list_entry(p, struct epitem, llink);
+
+		if (epi->file == file && epi->fd == fd)
+			return epi;
+	}
+	return NULL;
+}
+
+static void ep_wake(struct eventpoll *ep)
+{
+	wake_up(&ep->wq);
+	if (waitqueue_active(&ep->poll_wait))
+		wake_up(&ep->poll_wait);
+}
+
+/*
+ * Wakeup callback hooked into the watched file's wait queues.  Runs
+ * under the wait queue lock, possibly from an interrupt.
+ */
+static int ep_poll_callback(wait_queue_t *wait, unsigned int mode, int sync)
+{
+	struct epitem *epi = list_entry(wait, struct eppoll_entry, wait)->base;
+	struct eventpoll *ep = epi->ep;
+	unsigned long flags;
+
+	spin_lock_irqsave(&ep->lock, flags);
+	if (list_empty(&epi->rdllink)) {
+		list_add_tail(&epi->rdllink, &ep->rdllist);
+		ep_wake(ep);
+	}
+	spin_unlock_irqrestore(&ep->lock, flags);
+	return 1;
+}
+
+/* poll_wait() at insert time: hook a callback entry into the queue */
+static void ep_ptable_queue_proc(struct file *file, wait_queue_head_t *whead,
+				 poll_table *pt)
+{
+	struct epitem *epi = ((struct ep_pqueue *) pt)->epi;
+	struct eppoll_entry *pwq;
+
+	if (epi->nwait < 0)
+		return;
+	pwq = kmem_cache_alloc(pwq_cache, SLAB_KERNEL);
+	if (!pwq) {
+		epi->nwait = -1;
+		return;
+	}
+	init_waitqueue_func_entry(&pwq->wait, ep_poll_callback);
+	pwq->whead = whead;
+	pwq->base = epi;
+	add_wait_queue(whead, &pwq->wait);
+	list_add_tail(&pwq->llink, &epi->pwqlist);
+	epi->nwait++;
+}
+
+/* After this returns no callback of the item can be running */
+static void ep_unregister_pollwait(struct epitem *epi)
+{
+	while (!list_empty(&epi->pwqlist)) {
+		struct eppoll_entry *pwq;
+
+		pwq = list_entry(epi->pwqlist.next, struct eppoll_entry, llink);
+		list_del(&pwq->llink);
+		remove_wait_queue(pwq->whead, &pwq->wait);
+		kmem_cache_free(pwq_cache, pwq);
+	}
+	epi->nwait = 0;
+}
+
+/* Called with ep->sem held for writing */
+static int ep_insert(struct eventpoll *ep, struct epoll_event *event,
+		     struct file *tfile, int fd)
+{
+	struct epitem *epi;
+	struct ep_pqueue epq;
+	unsigned int revents;
+	unsigned long flags;
+
+	epi = kmem_cache_alloc(epi_cache, SLAB_KERNEL);
+	if (!epi)
+		return -ENOMEM;
+	INIT_LIST_HEAD(&epi->rdllink);
+	INIT_LIST_HEAD(&epi->fllink);
+	INIT_LIST_HEAD(&epi->pwqlist);
+	epi->nwait = 0;
+	epi->ep = ep;
+	epi->file = tfile;
+	epi->fd = fd;
+	epi->event = *event;
+
+	/* Hook into the file's wait queues and fetch its current state */
+	poll_initwait(&epq.pt);
+	epq.pt.qproc = ep_ptable_queue_proc;
+	epq.epi = epi;
+	revents = tfile->f_op->poll(tfile, &epq.pt);
+
+	if (epi->nwait < 0) {
+		ep_unregister_pollwait(epi);
+		spin_lock_irqsave(&ep->lock, flags);
+		list_del_init(&epi->rdllink);
+		spin_unlock_irqrestore(&ep->lock, flags);
+		kmem_cache_free(epi_cache, epi);
+		return -ENOMEM;
+	}
+
+	spin_lock(&tfile->f_ep_lock);
+	list_add_tail(&epi->fllink, &tfile->f_ep_links);
+	spin_unlock(&tfile->f_ep_lock);
+
+	list_add(&epi->llink, ep_hash_entry(ep, tfile, fd));
+
+	spin_lock_irqsave(&ep->lock, flags);
+	if ((revents & event->events) && list_empty(&epi->rdllink)) {
+		list_add_tail(&epi->rdllink, &ep->rdllist);
+		ep_wake(ep);
+	}
+	spin_unlock_irqrestore(&ep->lock, flags);
+	return 0;
+}
+
+/* Called with ep->sem held for writing */
+static int ep_modify(struct eventpoll *ep, struct epitem *epi,
+		     struct epoll_event *event)
+{
+	unsigned int revents;
+	unsigned long flags;
+
+	epi->event = *event;
+	revents = epi->file->f_op->poll(epi->file, NULL);
+
+	spin_lock_irqsave(&ep->lock, flags);
+	if ((revents & event->events) && list_empty(&epi->rdllink)) {
+		list_add_tail(&epi->rdllink, &ep->rdllist);
+		ep_wake(ep);
+	}
+	spin_unlock_irqrestore(&ep->lock, flags);
+	return 0;
+}
+
+/* Called with ep->sem held for writing, or from ep_free() */
+static int ep_remove(struct eventpoll *ep, struct epitem *epi)
+{
+	struct file *file = epi->file;
+	unsigned long flags;
+
+	ep_unregister_pollwait(epi);
+
+	spin_lock(&file->f_ep_lock);
+	list_del_init(&epi->fllink);
+	spin_unlock(&file->f_ep_lock);
+
+	list_del(&epi->llink);
+
+	spin_lock_irqsave(&ep->lock, flags);
+	list_del_init(&epi->rdllink);
+	spin_unlock_irqrestore(&ep->lock, flags);
+
+	kmem_cache_free(epi_cache, epi);
+	return 0;
+}
+
+/*
+ * Copy up to maxevents ready events to user space.  Each item is taken
+ * off the ready list before its f_op->poll() is asked, so a wakeup
+ * racing with us queues it again instead of getting lost.  Level
+ * triggered items that reported something go back on the list; the
+ * next call drops them once poll() says they are no longer ready.
+ */
+static int ep_events_transfer(struct eventpoll *ep,
+			      struct epoll_event *events, int maxevents)
+{
+	struct list_head txlist;
+	unsigned long flags;
+	int eventcnt = 0;
+
+	INIT_LIST_HEAD(&txlist);
+
+	down_read(&ep->sem);
+
+	spin_lock_irqsave(&ep->lock, flags);
+	list_splice(&ep->rdllist, &txlist);
+	INIT_LIST_HEAD(&ep->rdllist);
+	spin_unlock_irqrestore(&ep->lock, flags);
+
+	while (eventcnt < maxevents && !list_empty(&txlist)) {
+		struct epitem *epi;
+		struct epoll_event ev;
+
+		epi = list_entry(txlist.next, struct epitem, rdllink);
+
+		spin_lock_irqsave(&ep->lock, flags);
+		list_del_init(&epi->rdllink);
+		spin_unlock_irqrestore(&ep->lock, flags);
+
+		ev.events = epi->file->f_op->poll(epi->file, NULL) &
+				epi->event.events;
+		if (!ev.events)
+			continue;
+		ev.data = epi->event.data;
+
+		if (__copy_to_user(&events[eventcnt], &ev, sizeof(ev))) {
+			spin_lock_irqsave(&ep->lock, flags);
+			if (list_empty(&epi->rdllink))
+				list_add(&epi->rdllink, &ep->rdllist);
+			spin_unlock_irqrestore(&ep->lock, flags);
+			eventcnt = -EFAULT;
+			break;
+		}
+		eventcnt++;
+
+		if (!(epi->event.events & EPOLLET)) {
+			spin_lock_irqsave(&ep->lock, flags);
+			if (list_empty(&epi->rdllink))
+				list_add_tail(&epi->rdllink, &ep->rdllist);
+			spin_unlock_irqrestore(&ep->lock, flags);
+		}
+	}
+
+	/* What did not fit goes back to the front of the ready list */
+	if (!list_empty(&txlist)) {
+		spin_lock_irqsave(&ep->lock, flags);
+		list_splice(&txlist, &ep->rdllist);
+		spin_unlock_irqrestore(&ep->lock, flags);
+	}
+
+	up_read(&ep->sem);
+	return eventcnt;
+}
+
+static int ep_poll(struct eventpoll *ep, struct epoll_event *events,
+		   int maxevents, int timeout)
+{
+	int res, eavail;
+	unsigned long flags;
+	long jtimeout;
+	wait_queue_t wait;
+
+	/* timeout is in milliseconds, negative waits forever */
+	if (timeout < 0)
+		jtimeout = MAX_SCHEDULE_TIMEOUT;
+	else
+		jtimeout = (timeout / 1000) * HZ +
+			((timeout % 1000) * HZ + 999) / 1000;
+
+retry:
+	res = 0;
+	spin_lock_irqsave(&ep->lock, flags);
+	if (list_empty(&ep->rdllist)) {
+		init_waitqueue_entry(&wait, current);
+		add_wait_queue(&ep->wq, &wait);
+
+		for (;;) {
+			set_current_state(TASK_INTERRUPTIBLE);
+			if (!list_empty(&ep->rdllist) || !jtimeout)
+				break;
+			if (signal_pending(current)) {
+				res = -EINTR;
+				break;
+			}
+			spin_unlock_irqrestore(&ep->lock, flags);
+			jtimeout = schedule_timeout(jtimeout);
+			spin_lock_irqsave(&ep->lock, flags);
+		}
+		remove_wait_queue(&ep->wq, &wait);
+		set_current_state(TASK_RUNNING);
+	}
+	eavail = !list_empty(&ep->rdllist);
+	spin_unlock_irqrestore(&ep->lock, flags);
+
+	/*
+	 * The ready items may all turn out stale; then go back to sleep
+	 * for whatever is left of the timeout.
+	 */
+	if (!res && eavail &&
+	    !(res = ep_events_transfer(ep, events, maxevents)) && jtimeout)
+		goto retry;
+
+	return res;
+}
+
+static struct eventpoll *ep_alloc(int size)
+{
+	struct eventpoll *ep;
+	unsigned int i;
+
+	ep = kmalloc(sizeof(struct eventpoll), GFP_KERNEL);
+	if (!ep)
+		return NULL;
+	memset(ep, 0, sizeof(*ep));
+
+	ep->hashbits = EP_MIN_HASH_BITS;
+	while (ep->hashbits < EP_MAX_HASH_BITS && (1 << ep->hashbits) < size)
+		ep->hashbits++;
+	ep->hash = kmalloc(sizeof(struct list_head) << ep->hashbits,
+			   GFP_KERNEL);
+	if (!ep->hash) {
+		kfree(ep);
+		return NULL;
+	}
+	for (i = 0; i < (1 << ep->hashbits); i++)
+		INIT_LIST_HEAD(&ep->hash[i]);
+
+	init_rwsem(&ep->sem);
+	spin_lock_init(&ep->lock);
+	init_waitqueue_head(&ep->wq);
+	init_waitqueue_head(&ep->poll_wait);
+	INIT_LIST_HEAD(&ep->rdllist);
+	return ep;
+}
+
+static void ep_free(struct eventpoll *ep)
+{
+	unsigned int i;
+
+	down(&epsem);
+
+	/* Unhook everything first, so no callback can run any more */
+	for (i = 0; i < (1 << ep->hashbits); i++) {
+		struct list_head *p;
+
+		list_for_each(p, &ep->hash[i])
+			ep_unregister_pollwait(list_entry(p, struct epitem,
+							  llink));
+	}
+
+	for (i = 0; i < (1 << ep->hashbits); i++) {
+		while (!list_empty(&ep->hash[i]))
+			ep_remove(ep, list_entry(ep->hash[i].next,
+						 struct epitem, llink));
+	}
+
+	up(&epsem);
+
+	kfree(ep->hash);
+	kfree(ep);
+}
+
+void eventpoll_release_file(struct file *file)
+{
+	down(&epsem);
+	while (!list_empty(&file->f_ep_links)) {
+		struct epitem *epi;
+		struct eventpoll *ep;
+
+		epi = list_entry(file->f_ep_links.next, struct epitem, fllink);
+		ep = epi->ep;
+		down_write(&ep->sem);
+		ep_remove(ep, epi);
+		up_write(&ep->sem);
+	}
+	up(&epsem);
+}
+
+static int ep_eventpoll_close(struct inode *inode, struct file *file)
+{
+	struct eventpoll *ep = file->private_data;
+
+	if (ep)
+		ep_free(ep);
+	return 0;
+}
+
+static unsigned int ep_eventpoll_poll(struct file *file, poll_table *wait)
+{
+	struct eventpoll *ep = file->private_data;
+	unsigned int pollflags = 0;
+	unsigned long flags;
+
+	poll_wait(file, &ep->poll_wait, wait);
+
+	spin_lock_irqsave(&ep->lock, flags);
+	if (!list_empty(&ep->rdllist))
+		pollflags = POLLIN | POLLRDNORM;
+	spin_unlock_irqrestore(&ep->lock, flags);
+
+	return pollflags;
+}
+
+static int eventpollfs_delete_dentry(struct dentry *dentry)
+{
+	return 1;
+}
+
+static struct dentry_operations eventpollfs_dentry_operations = {
+	d_delete:	eventpollfs_delete_dentry,
+};
+
+/* Same scheme as do_pipe(): an anonymous inode on a kernel-only fs */
+static int ep_getfd(struct eventpoll *ep)
+{
+	struct qstr this;
+	char name[32];
+	struct dentry *dentry;
+	struct inode *inode;
+	struct file *file;
+	int error, fd;
+
+	error = -ENFILE;
+	file = get_empty_filp();
+	if (!file)
+		goto no_file;
+
+	inode = new_inode(eventpoll_mnt->mnt_sb);
+	if (!inode)
+		goto close_file;
+	inode->i_fop = &eventpoll_fops;
+	/* never put it on a dirty list, see get_pipe_inode() */
+	inode->i_state = I_DIRTY;
+	inode->i_mode = S_IRUSR | S_IWUSR;
+	inode->i_uid = current->fsuid;
+	inode->i_gid = current->fsgid;
+	inode->i_atime = inode->i_mtime = inode->i_ctime = CURRENT_TIME;
+	inode->i_blksize = PAGE_SIZE;
+
+	error = get_unused_fd();
+	if (error < 0)
+		goto close_file_inode;
+	fd = error;
+
+	error = -ENOMEM;
+	sprintf(name, "[%lu]", inode->i_ino);
+	this.name = name;
+	this.len = strlen(name);
+	this.hash = inode->i_ino;
+	dentry = d_alloc(eventpoll_mnt->mnt_sb->s_root, &this);
+	if (!dentry)
+		goto close_file_inode_fd;
+	dentry->d_op = &eventpollfs_dentry_operations;
+	d_add(dentry, inode);
+
+	file->f_vfsmnt = mntget(eventpoll_mnt);
+	file->f_dentry = dentry;
+	file->f_pos = 0;
+	file->f_flags = O_RDONLY;
+	file->f_op = &eventpoll_fops;
+	file->f_mode = FMODE_READ;
+	file->f_version = 0;
+	file->private_data = ep;
+
+	fd_install(fd, file);
+	return fd;
+
+close_file_inode_fd:
+	put_unused_fd(fd);
+close_file_inode:
+	iput(inode);
+close_file:
+	put_filp(file);
+no_file:
+	return error;
+}
+
+asmlinkage long sys_epoll_create(int size)
+{
+	struct eventpoll *ep;
+	int fd;
+
+	if (size <= 0)
+		return -EINVAL;
+	if (!eventpoll_mnt)	/* eventpollfs failed to mount at boot */
+		return -ENOMEM;
+
+	ep = ep_alloc(size);
+	if (!ep)
+		return -ENOMEM;
+
+	fd = ep_getfd(ep);
+	if (fd < 0)
+		ep_free(ep);
+	return fd;
+}
+
+asmlinkage long sys_epoll_ctl(int epfd, int op, int fd,
+			      struct epoll_event *event)
+{
+	struct file *file, *tfile;
+	struct eventpoll *ep;
+	struct epitem *epi;
+	struct epoll_event epds;
+	int error;
+
+	if (op != EPOLL_CTL_DEL &&
+	    copy_from_user(&epds, event, sizeof(struct epoll_event)))
+		return -EFAULT;
+
+	error = -EBADF;
+	file = fget(epfd);
+	if (!file)
+		goto out;
+	tfile = fget(fd);
+	if (!tfile)
+		goto out_fput;
+
+	error = -EPERM;
+	if (!tfile->f_op || !tfile->f_op->poll)
+		goto out_tfput;
+
+	/* No nesting: an epoll fd can't be watched by another one */
+	error = -EINVAL;
+	if (file == tfile || !is_file_epoll(file) || is_file_epoll(tfile))
+		goto out_tfput;
+
+	ep = file->private_data;
+	epds.events |= EP_PRIVATE_BITS;
+
+	down_write(&ep->sem);
+	epi = ep_find(ep, tfile, fd);
+
+	switch (op) {
+	case EPOLL_CTL_ADD:
+		error = epi ? -EEXIST : ep_insert(ep, &epds, tfile, fd);
+		break;
+	case EPOLL_CTL_DEL:
+		error = epi ? ep_remove(ep, epi) : -ENOENT;
+		break;
+	case EPOLL_CTL_MOD:
+		error = epi ? ep_modify(ep, epi, &epds) : -ENOENT;
+		break;
+	default:
+		error = -EINVAL;
+		break;
+	}
+	up_write(&ep->sem);
+
+out_tfput:
+	fput(tfile);
+out_fput:
+	fput(file);
+out:
+	return error;
+}
+
+asmlinkage long sys_epoll_wait(int epfd, struct epoll_event *events,
+			       int maxevents, int timeout)
+{
+	struct file *file;
+	int error;
+
+	if (maxevents <= 0 || maxevents > EP_MAX_EVENTS)
+		return -EINVAL;
+	if (verify_area(VERIFY_WRITE, events,
+			maxevents * sizeof(struct epoll_event)))
+		return -EFAULT;
+
+	error = -EBADF;
+	file = fget(epfd);
+	if (!file)
+		goto out;
+
+	error = -EINVAL;
+	if (is_file_epoll(file))
+		error = ep_poll(file->private_data, events, maxevents, timeout);
+
+	fput(file);
+out:
+	return error;
+}
+
+static int eventpollfs_statfs(struct super_block *sb, struct statfs *buf)
+{
+	buf->f_type = EVENTPOLLFS_MAGIC;
+	buf->f_bsize = 1024;
+	buf->f_namelen = 255;
+	return 0;
+}
+
+static struct super_operations eventpollfs_ops = {
+	statfs:		eventpollfs_statfs,
+};
+
+static struct super_block *eventpollfs_read_super(struct super_block *sb,
+						  void *data, int silent)
+{
+	struct inode *root = new_inode(sb);
+	if (!root)
+		return NULL;
+	root->i_mode = S_IFDIR | S_IRUSR | S_IWUSR;
+	root->i_uid = root->i_gid = 0;
+	root->i_atime = root->i_mtime = root->i_ctime = CURRENT_TIME;
+	sb->s_blocksize = 1024;
+	sb->s_blocksize_bits = 10;
+	sb->s_magic = EVENTPOLLFS_MAGIC;
+	sb->s_op = &eventpollfs_ops;
+	sb->s_root = d_alloc(NULL, &(const struct qstr) { "eventpoll:", 10, 0 });
+	if (!sb->s_root) {
+		iput(root);
+		return NULL;
+	}
+	sb->s_root->d_sb = sb;
+	sb->s_root->d_parent = sb->s_root;
+	d_instantiate(sb->s_root, root);
+	return sb;
+}
+
+static DECLARE_FSTYPE(eventpoll_fs_type, "eventpollfs",
+		      eventpollfs_read_super, FS_NOMOUNT);
+
+static int __init eventpoll_init(void)
+{
+	int err;
+
+	epi_cache = kmem_cache_create("eventpoll_epi", sizeof(struct epitem),
+				      0, SLAB_HWCACHE_ALIGN, NULL, NULL);
+	pwq_cache = kmem_cache_create("eventpoll_pwq",
+				      sizeof(struct eppoll_entry),
+				      0, SLAB_HWCACHE_ALIGN, NULL, NULL);
+	if (!epi_cache || !pwq_cache)
+		panic("eventpoll: cannot create slab caches");
+
+	err = register_filesystem(&eventpoll_fs_type);
+	if (!err) {
+		eventpoll_mnt = kern_mount(&eventpoll_fs_type);
+		err = PTR_ERR(eventpoll_mnt);
+		if (IS_ERR(eventpoll_mnt)) {
+			eventpoll_mnt = NULL;
+			unregister_filesystem(&eventpoll_fs_type);
+		} else
+			err = 0;
+	}
+	return err;
+}
+
+module_init(eventpoll_init);
@@ -320,6 +320,10 @@ static long do_fcntl(unsigned int fd, unsigned int cmd,
 		case F_NOTIFY:
 			err = fcntl_dirnotify(fd, filp, arg);
 			break;
+		case F_SETPIPE_SZ:
+		case F_GETPIPE_SZ:
+			err = pipe_fcntl(filp, cmd, arg);
+			break;
 		default:
 			/* sockets need a few special fcntls. */
 			err = -EINVAL;
@@ -12,6 +12,7 @@
 #include <linux/module.h>
 #include <linux/smp_lock.h>
 #include <linux/iobuf.h>
+#include <linux/eventpoll.h>
 
 /* sysctl tunables... */
 struct files_stat_struct files_stat = {0, 0, NR_FILE};
@@ -43,6 +44,7 @@ struct file * get_empty_filp(void)
 	new_one:
 		memset(f, 0, sizeof(*f));
 		atomic_set(&f->f_count,1);
+		eventpoll_init_file(f);
 		f->f_version = ++event;
 		f->f_uid = current->fsuid;
 		f->f_gid = current->fsgid;
@@ -87,6 +89,7 @@ int init_private_file(struct file *filp, struct dentry *dentry, int mode)
 	memset(filp, 0, sizeof(*filp));
 	filp->f_mode   = mode;
 	atomic_set(&filp->f_count, 1);
+	eventpoll_init_file(filp);
 	filp->f_dentry = dentry;
 	filp->f_uid    = current->fsuid;
 	filp->f_gid    = current->fsgid;
@@ -105,6 +108,7 @@ void fput(struct file * file)
 
 	if (atomic_dec_and_test(&file->f_count)) {
 		locks_remove_flock(file);
+		eventpoll_release(file);
 
 		if (file->f_iobuf)
 			free_kiovec(1, &file->f_iobuf);
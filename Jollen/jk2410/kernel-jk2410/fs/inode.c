@@ -1121,6 +1121,19 @@ int bmap(struct inode * inode, int block)
 	return res;
 }
 
+/* Size of the hash table from the command line, see inode_init() */
+static unsigned long ihash_entries __initdata;
+
+static int __init set_ihash_entries(char *str)
+{
+	if (!str)
+		return 0;
+	ihash_entries = simple_strtoul(str, &str, 0);
+	return 1;
+}
+
+__setup("ihash_entries=", set_ihash_entries);
+
 /*
  * Initialize the hash tables.
  */
@@ -1131,7 +1144,11 @@ void __init inode_init(unsigned long mempages)
 	unsigned int nr_hash;
 	int i;
 
-	mempages >>= (14 - PAGE_SHIFT);
+	/* ihash_entries= overrides the sizing by memory, rounded up */
+	if (ihash_entries)
+		mempages = ihash_entries;
+	else
+		mempages >>= (14 - PAGE_SHIFT);
 	mempages *= sizeof(struct list_head);
 	for (order = 0; ((1UL << order) << PAGE_SHIFT) < mempages; order++)
 		;
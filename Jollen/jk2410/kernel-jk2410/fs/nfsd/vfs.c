@@ -71,7 +71,8 @@ struct raparms {
 				p_ramax,
 				p_raend,
 				p_ralen,
-				p_rawin;
+				p_rawin,
+				p_ranext;
 };
 
 static struct raparms *		raparml;
@@ -567,6 +568,7 @@ nfsd_get_raparms(dev_t dev, ino_t ino)
 	ra->p_raend = 0;
 	ra->p_ralen = 0;
 	ra->p_rawin = 0;
+	ra->p_ranext = 0;
 found:
 	if (rap != &raparm_cache) {
 		*rap = ra->p_next;
@@ -612,6 +614,7 @@ nfsd_read(struct svc_rqst *rqstp, struct svc_fh *fhp, loff_t offset,
 		file.f_raend = ra->p_raend;
 		file.f_ralen = ra->p_ralen;
 		file.f_rawin = ra->p_rawin;
+		file.f_ranext = ra->p_ranext;
 	}
 	file.f_pos = offset;
 
@@ -629,6 +632,7 @@ nfsd_read(struct svc_rqst *rqstp, struct svc_fh *fhp, loff_t offset,
 		ra->p_raend = file.f_raend;
 		ra->p_ralen = file.f_ralen;
 		ra->p_rawin = file.f_rawin;
+		ra->p_ranext = file.f_ranext;
 		ra->p_count -= 1;
 	}
 
@@ -10,14 +10,17 @@
 #include <linux/slab.h>
 #include <linux/module.h>
 #include <linux/init.h>
+#include <linux/fcntl.h>
+#include <linux/uio.h>
 
 #include <asm/uaccess.h>
 #include <asm/ioctls.h>
+#include <asm/pgalloc.h>
 
 /*
- * We use a start+len construction, which provides full use of the 
- * allocated memory.
- * -- Florian Coosmann (FGC)
+ * The pipe is a ring of up to i_pipe->buffers page-sized buffers, see
+ * <linux/pipe_fs_i.h>. Small writes are merged into the last buffer, so
+ * a page is only started when the previous one is full.
  * 
  * Reads with count = 0 should always return 0.
  * -- Julian Bradfield 1999-06-07.
@@ -36,11 +39,48 @@ void pipe_wait(struct inode * inode)
 	down(PIPE_SEM(*inode));
 }
 
+static inline struct pipe_buffer *pipe_last_buf(struct pipe_inode_info *info)
+{
+	return info->bufs + ((info->curbuf + info->nrbufs - 1) & (info->buffers - 1));
+}
+
+/* Room left in the last buffer, if we may write into it */
+static inline unsigned int pipe_tail_room(struct pipe_inode_info *info)
+{
+	struct pipe_buffer *buf;
+
+	if (!info->nrbufs)
+		return 0;
+	buf = pipe_last_buf(info);
+	if (buf->flags & PIPE_BUF_GIFT)
+		return 0;
+	return PAGE_SIZE - (buf->offset + buf->len);
+}
+
+static inline unsigned int pipe_free(struct pipe_inode_info *info)
+{
+	return (info->buffers - info->nrbufs) * PAGE_SIZE + pipe_tail_room(info);
+}
+
+/* Give up a buffer's page; keep one of our own around for the next write */
+static void pipe_buf_release(struct pipe_inode_info *info, struct pipe_buffer *buf)
+{
+	struct page *page = buf->page;
+
+	buf->page = NULL;
+	if (!(buf->flags & PIPE_BUF_GIFT) && !info->tmp_page) {
+		info->tmp_page = page;
+		return;
+	}
+	put_page(page);
+}
+
 static ssize_t
 pipe_read(struct file *filp, char *buf, size_t count, loff_t *ppos)
 {
 	struct inode *inode = filp->f_dentry->d_inode;
-	ssize_t size, read, ret;
+	struct pipe_inode_info *info;
+	ssize_t read, ret;
 
 	/* Seeks are not allowed on pipes.  */
 	ret = -ESPIPE;
@@ -57,6 +97,7 @@ pipe_read(struct file *filp, char *buf, size_t count, loff_t *ppos)
 	ret = -ERESTARTSYS;
 	if (down_interruptible(PIPE_SEM(*inode)))
 		goto out_nolock;
+	info = inode->i_pipe;
 
 	if (PIPE_EMPTY(*inode)) {
 do_more_read:
@@ -85,29 +126,32 @@ do_more_read:
 
 	/* Read what data is available.  */
 	ret = -EFAULT;
-	while (count > 0 && (size = PIPE_LEN(*inode))) {
-		char *pipebuf = PIPE_BASE(*inode) + PIPE_START(*inode);
-		ssize_t chars = PIPE_MAX_RCHUNK(*inode);
+	while (count > 0 && info->nrbufs) {
+		struct pipe_buffer *pbuf = info->bufs + info->curbuf;
+		ssize_t chars = pbuf->len;
+		unsigned long left;
 
 		if (chars > count)
 			chars = count;
-		if (chars > size)
-			chars = size;
 
-		if (copy_to_user(buf, pipebuf, chars))
+		left = copy_to_user(buf, (char *)kmap(pbuf->page) + pbuf->offset, chars);
+		kunmap(pbuf->page);
+		if (left)
 			goto out;
 
 		read += chars;
-		PIPE_START(*inode) += chars;
-		PIPE_START(*inode) &= (PIPE_SIZE - 1);
+		pbuf->offset += chars;
+		pbuf->len -= chars;
 		PIPE_LEN(*inode) -= chars;
 		count -= chars;
 		buf += chars;
-	}
 
-	/* Cache behaviour optimization */
-	if (!PIPE_LEN(*inode))
-		PIPE_START(*inode) = 0;
+		if (!pbuf->len) {
+			pipe_buf_release(info, pbuf);
+			info->curbuf = (info->curbuf + 1) & (info->buffers - 1);
+			info->nrbufs--;
+		}
+	}
 
 	if (count && PIPE_WAITING_WRITERS(*inode) && !(filp->f_flags & O_NONBLOCK)) {
 		/*
@@ -136,6 +180,7 @@ static ssize_t
 pipe_write(struct file *filp, const char *buf, size_t count, loff_t *ppos)
 {
 	struct inode *inode = filp->f_dentry->d_inode;
+	struct pipe_inode_info *info;
 	ssize_t free, written, ret;
 
 	/* Seeks are not allowed on pipes.  */
@@ -152,6 +197,7 @@ pipe_write(struct file *filp, const char *buf, size_t count, loff_t *ppos)
 	ret = -ERESTARTSYS;
 	if (down_interruptible(PIPE_SEM(*inode)))
 		goto out_nolock;
+	info = inode->i_pipe;
 
 	/* No readers yields SIGPIPE.  */
 	if (!PIPE_READERS(*inode))
@@ -163,10 +209,10 @@ pipe_write(struct file *filp, const char *buf, size_t count, loff_t *ppos)
 	/* Wait, or check for, available space.  */
 	if (filp->f_flags & O_NONBLOCK) {
 		ret = -EAGAIN;
-		if (PIPE_FREE(*inode) < free)
+		if (pipe_free(info) < free)
 			goto out;
 	} else {
-		while (PIPE_FREE(*inode) < free) {
+		while (pipe_free(info) < free) {
 			PIPE_WAITING_WRITERS(*inode)++;
 			pipe_wait(inode);
 			PIPE_WAITING_WRITERS(*inode)--;
@@ -182,47 +228,84 @@ pipe_write(struct file *filp, const char *buf, size_t count, loff_t *ppos)
 	/* Copy into available space.  */
 	ret = -EFAULT;
 	while (count > 0) {
-		int space;
-		char *pipebuf = PIPE_BASE(*inode) + PIPE_END(*inode);
-		ssize_t chars = PIPE_MAX_WCHUNK(*inode);
+		struct pipe_buffer *pbuf;
+		struct page *page;
+		ssize_t chars;
+		unsigned long left;
+
+		/* Fill up the last buffer first ... */
+		if ((chars = pipe_tail_room(info)) != 0) {
+			pbuf = pipe_last_buf(info);
+			if (chars > count)
+				chars = count;
 
-		if ((space = PIPE_FREE(*inode)) != 0) {
+			left = copy_from_user((char *)kmap(pbuf->page) + pbuf->offset + pbuf->len,
+					      buf, chars);
+			kunmap(pbuf->page);
+			if (left)
+				goto out;
+
+			pbuf->len += chars;
+
+		/* ... then start a new one. */
+		} else if (info->nrbufs < info->buffers) {
+			page = info->tmp_page;
+			if (!page) {
+				page = alloc_page(GFP_HIGHUSER);
+				ret = -ENOMEM;
+				if (!page)
+					goto out;
+				ret = -EFAULT;
+			}
+			info->tmp_page = NULL;
+
+			chars = PAGE_SIZE;
 			if (chars > count)
 				chars = count;
-			if (chars > space)
-				chars = space;
 
-			if (copy_from_user(pipebuf, buf, chars))
+			left = copy_from_user(kmap(page), buf, chars);
+			kunmap(page);
+			if (left) {
+				info->tmp_page = page;
 				goto out;
+			}
+
+			pbuf = info->bufs + ((info->curbuf + info->nrbufs) & (info->buffers - 1));
+			pbuf->page = page;
+			pbuf->offset = 0;
+			pbuf->len = chars;
+			pbuf->flags = 0;
+			info->nrbufs++;
+
+		/* ... or wait for the reader. */
+		} else {
+			ret = written;
+			if (filp->f_flags & O_NONBLOCK)
+				break;
 
-			written += chars;
-			PIPE_LEN(*inode) += chars;
-			count -= chars;
-			buf += chars;
-			space = PIPE_FREE(*inode);
+			do {
+				/*
+				 * Synchronous wake-up: it knows that this process
+				 * is going to give up this CPU, so it doesnt have
+				 * to do idle reschedules.
+				 */
+				wake_up_interruptible_sync(PIPE_WAIT(*inode));
+				PIPE_WAITING_WRITERS(*inode)++;
+				pipe_wait(inode);
+				PIPE_WAITING_WRITERS(*inode)--;
+				if (signal_pending(current))
+					goto out;
+				if (!PIPE_READERS(*inode))
+					goto sigpipe;
+			} while (!pipe_free(info));
+			ret = -EFAULT;
 			continue;
 		}
 
-		ret = written;
-		if (filp->f_flags & O_NONBLOCK)
-			break;
-
-		do {
-			/*
-			 * Synchronous wake-up: it knows that this process
-			 * is going to give up this CPU, so it doesnt have
-			 * to do idle reschedules.
-			 */
-			wake_up_interruptible_sync(PIPE_WAIT(*inode));
-			PIPE_WAITING_WRITERS(*inode)++;
-			pipe_wait(inode);
-			PIPE_WAITING_WRITERS(*inode)--;
-			if (signal_pending(current))
-				goto out;
-			if (!PIPE_READERS(*inode))
-				goto sigpipe;
-		} while (!PIPE_FREE(*inode));
-		ret = -EFAULT;
+		written += chars;
+		PIPE_LEN(*inode) += chars;
+		count -= chars;
+		buf += chars;
 	}
 
 	/* Signal readers asynchronously that there is more data.  */
@@ -286,9 +369,11 @@ pipe_poll(struct file *filp, poll_table *wait)
 	poll_wait(filp, PIPE_WAIT(*inode), wait);
 
 	/* Reading only -- no need for acquiring the semaphore.  */
-	mask = POLLIN | POLLRDNORM;
-	if (PIPE_EMPTY(*inode))
-		mask = POLLOUT | POLLWRNORM;
+	mask = 0;
+	if (!PIPE_EMPTY(*inode))
+		mask = POLLIN | POLLRDNORM;
+	if (inode->i_pipe->nrbufs < inode->i_pipe->buffers)
+		mask |= POLLOUT | POLLWRNORM;
 	if (!PIPE_WRITERS(*inode) && filp->f_version != PIPE_WCOUNTER(*inode))
 		mask |= POLLHUP;
 	if (!PIPE_READERS(*inode))
@@ -307,10 +392,7 @@ pipe_release(struct inode *inode, int decr, int decw)
 	PIPE_READERS(*inode) -= decr;
 	PIPE_WRITERS(*inode) -= decw;
 	if (!PIPE_READERS(*inode) && !PIPE_WRITERS(*inode)) {
-		struct pipe_inode_info *info = inode->i_pipe;
-		inode->i_pipe = NULL;
-		free_page((unsigned long) info->base);
-		kfree(info);
+		free_pipe_info(inode);
 	} else {
 		wake_up_interruptible(PIPE_WAIT(*inode));
 	}
@@ -442,27 +524,195 @@ struct file_operations rdwr_pipe_fops = {
 
 struct inode* pipe_new(struct inode* inode)
 {
-	unsigned long page;
+	struct pipe_inode_info *info;
 
-	page = __get_free_page(GFP_USER);
-	if (!page)
+	info = kmalloc(sizeof(struct pipe_inode_info), GFP_KERNEL);
+	if (!info)
 		return NULL;
-
-	inode->i_pipe = kmalloc(sizeof(struct pipe_inode_info), GFP_KERNEL);
-	if (!inode->i_pipe)
-		goto fail_page;
+	memset(info, 0, sizeof(struct pipe_inode_info));
+	inode->i_pipe = info;
 
 	init_waitqueue_head(PIPE_WAIT(*inode));
-	PIPE_BASE(*inode) = (char*) page;
-	PIPE_START(*inode) = PIPE_LEN(*inode) = 0;
-	PIPE_READERS(*inode) = PIPE_WRITERS(*inode) = 0;
-	PIPE_WAITING_READERS(*inode) = PIPE_WAITING_WRITERS(*inode) = 0;
+	info->buffers = PIPE_BUFFERS;
 	PIPE_RCOUNTER(*inode) = PIPE_WCOUNTER(*inode) = 1;
 
 	return inode;
-fail_page:
-	free_page(page);
-	return NULL;
+}
+
+void free_pipe_info(struct inode* inode)
+{
+	struct pipe_inode_info *info = inode->i_pipe;
+
+	inode->i_pipe = NULL;
+	while (info->nrbufs) {
+		put_page(info->bufs[info->curbuf].page);
+		info->curbuf = (info->curbuf + 1) & (info->buffers - 1);
+		info->nrbufs--;
+	}
+	if (info->tmp_page)
+		put_page(info->tmp_page);
+	kfree(info);
+}
+
+/*
+ * F_SETPIPE_SZ rounds the capacity up to a power of two pages, at most
+ * PIPE_MAX_BUFFERS, and fails with -EBUSY if the pipe holds more buffers
+ * than would fit.
+ */
+long pipe_fcntl(struct file *filp, unsigned int cmd, unsigned long arg)
+{
+	struct inode *inode = filp->f_dentry->d_inode;
+	struct pipe_inode_info *info;
+	struct pipe_buffer bufs[PIPE_MAX_BUFFERS];
+	unsigned int nr, i;
+	long ret;
+
+	if (!S_ISFIFO(inode->i_mode) || !inode->i_pipe)
+		return -EBADF;
+
+	down(PIPE_SEM(*inode));
+	info = inode->i_pipe;
+	switch (cmd) {
+	case F_GETPIPE_SZ:
+		ret = info->buffers * PAGE_SIZE;
+		break;
+	case F_SETPIPE_SZ:
+		ret = -EINVAL;
+		if (arg > PIPE_MAX_BUFFERS * PAGE_SIZE)
+			break;
+		for (nr = 1; nr * PAGE_SIZE < arg; nr <<= 1)
+			;
+		ret = -EBUSY;
+		if (nr < info->nrbufs)
+			break;
+
+		/* Move the buffers in use to the front of the new ring */
+		for (i = 0; i < info->nrbufs; i++)
+			bufs[i] = info->bufs[(info->curbuf + i) & (info->buffers - 1)];
+		memcpy(info->bufs, bufs, info->nrbufs * sizeof(struct pipe_buffer));
+		info->curbuf = 0;
+		info->buffers = nr;
+
+		wake_up_interruptible(PIPE_WAIT(*inode));
+		ret = nr * PAGE_SIZE;
+		break;
+	default:
+		ret = -EINVAL;
+	}
+	up(PIPE_SEM(*inode));
+	return ret;
+}
+
+/*
+ * vmsplice() queues user memory on a pipe by reference: the pages are
+ * pinned and the reader copies straight out of them, saving the copy
+ * into the pipe. The caller gives the pages away ("gifts" them) until
+ * the data has been read, modifying them earlier changes what the
+ * reader sees. A write to the pipe never merges into such a page.
+ */
+static ssize_t pipe_gift_page(struct inode *inode, struct file *file,
+			      unsigned long addr, size_t len, unsigned int flags)
+{
+	struct pipe_inode_info *info = inode->i_pipe;
+	struct mm_struct *mm = current->mm;
+	struct pipe_buffer *pbuf;
+	struct page *page;
+	int err;
+
+	while (info->nrbufs == info->buffers) {
+		if (!PIPE_READERS(*inode))
+			return -EPIPE;
+		if ((flags & SPLICE_F_NONBLOCK) || (file->f_flags & O_NONBLOCK))
+			return -EAGAIN;
+		wake_up_interruptible_sync(PIPE_WAIT(*inode));
+		PIPE_WAITING_WRITERS(*inode)++;
+		pipe_wait(inode);
+		PIPE_WAITING_WRITERS(*inode)--;
+		if (signal_pending(current))
+			return -ERESTARTSYS;
+	}
+	if (!PIPE_READERS(*inode))
+		return -EPIPE;
+
+	down_read(&mm->mmap_sem);
+	err = get_user_pages(current, mm, addr, 1, 0, 0, &page, NULL);
+	up_read(&mm->mmap_sem);
+	if (err <= 0)
+		return err ? err : -EFAULT;
+
+	/* The data was written through the user's mapping of the page */
+	flush_cache_range(mm, addr, addr + len);
+
+	pbuf = info->bufs + ((info->curbuf + info->nrbufs) & (info->buffers - 1));
+	pbuf->page = page;
+	pbuf->offset = addr & ~PAGE_MASK;
+	pbuf->len = len;
+	pbuf->flags = PIPE_BUF_GIFT;
+	info->nrbufs++;
+	PIPE_LEN(*inode) += len;
+	return len;
+}
+
+asmlinkage long sys_vmsplice(int fd, const struct iovec *iov,
+			     unsigned long nr_segs, unsigned int flags)
+{
+	struct file *file;
+	struct inode *inode;
+	struct iovec vec;
+	long ret, done = 0;
+
+	if (flags & ~(SPLICE_F_MOVE|SPLICE_F_NONBLOCK|SPLICE_F_MORE|SPLICE_F_GIFT))
+		return -EINVAL;
+
+	file = fget(fd);
+	if (!file)
+		return -EBADF;
+	inode = file->f_dentry->d_inode;
+	ret = -EBADF;
+	if (!S_ISFIFO(inode->i_mode) || !inode->i_pipe || !(file->f_mode & FMODE_WRITE))
+		goto out_fput;
+
+	ret = -ERESTARTSYS;
+	if (down_interruptible(PIPE_SEM(*inode)))
+		goto out_fput;
+
+	ret = 0;
+	while (nr_segs--) {
+		unsigned long addr;
+		size_t left;
+
+		ret = -EFAULT;
+		if (copy_from_user(&vec, iov++, sizeof(vec)))
+			break;
+		addr = (unsigned long) vec.iov_base;
+		left = vec.iov_len;
+
+		while (left) {
+			size_t len = PAGE_SIZE - (addr & ~PAGE_MASK);
+
+			if (len > left)
+				len = left;
+			ret = pipe_gift_page(inode, file, addr, len, flags);
+			if (ret < 0)
+				goto out_up;
+			done += len;
+			addr += len;
+			left -= len;
+		}
+		ret = 0;
+	}
+out_up:
+	if (done) {
+		wake_up_interruptible(PIPE_WAIT(*inode));
+		inode->i_ctime = inode->i_mtime = CURRENT_TIME;
+		mark_inode_dirty(inode);
+	}
+	up(PIPE_SEM(*inode));
+	if (ret == -EPIPE && !done)
+		send_sig(SIGPIPE, current, 0);
+out_fput:
+	fput(file);
+	return done ? done : ret;
 }
 
 static struct vfsmount *pipe_mnt;
@@ -576,9 +826,7 @@ close_f12_inode_i_j:
 close_f12_inode_i:
 	put_unused_fd(i);
 close_f12_inode:
-	free_page((unsigned long) PIPE_BASE(*inode));
-	kfree(inode->i_pipe);
-	inode->i_pipe = NULL;
+	free_pipe_info(inode);
 	iput(inode);
 close_f12:
 	put_filp(f2);
@@ -31,3 +31,8 @@ extern int set_external_irq(int irq, int edge, int pullup);
  */
 extern unsigned int fixup_irq(int i);
 extern void do_IRQ(int irq, struct pt_regs *regs);
+
+#ifdef CONFIG_S3C2410_IRQ_STATS
+extern unsigned long s3c2410_irq_stamp(void);
+extern void s3c2410_irq_account(unsigned int irq, unsigned long stamp);
+#endif
@@ -0,0 +1,40 @@
+/*
+ * linux/include/asm-arm/arch-s3c2410/pm.h
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Register save/restore tables for suspend.  A driver lists the
+ * registers it owns once:
+ *
+ *	static struct sleep_save lcd_save[] = {
+ *		SAVE_ITEM(LCDCON2), SAVE_ITEM(LCDCON3), ...
+ *	};
+ *
+ * and calls s3c2410_pm_do_save(lcd_save, ARRAY_SIZE(lcd_save)) on
+ * PM_SUSPEND and s3c2410_pm_do_restore() on PM_RESUME.  Entries are
+ * restored in table order.
+ */
+
+#ifndef __ASM_ARCH_PM_H
+#define __ASM_ARCH_PM_H
+
+#include <asm/hardware.h>
+
+struct sleep_save {
+	volatile u32	*reg;
+	u32		val;
+};
+
+#define SAVE_ITEM(x)	{ reg: &(x) }
+
+extern void s3c2410_pm_do_save(struct sleep_save *ptr, int count);
+extern void s3c2410_pm_do_restore(struct sleep_save *ptr, int count);
+
+/* wake-up timing of the last resume, in usecs */
+extern unsigned long pm_resume_core_usec;	/* pm_do_suspend() restore */
+extern unsigned long pm_resume_dev_usec;	/* device callbacks */
+
+#endif /* __ASM_ARCH_PM_H */
@@ -192,6 +192,11 @@ static unsigned long s3c2410_gettimeoffset(void)
 	return usec;
 }
 
+#ifdef CONFIG_HIGH_RES_TIMERS
+extern u64 s3c2410_hr_ticks;
+extern void s3c2410_hrtimer_setup(unsigned long pclk);
+#endif
+
 static void s3c2410_timer_interrupt(int irq, void *dev_id, struct pt_regs *regs)
 {
 	long flags;
@@ -199,6 +204,9 @@ static void s3c2410_timer_interrupt(int irq, void *dev_id, struct pt_regs *regs)
 	do_leds();
 	do_set_rtc();
 	save_flags_cli(flags);
+#ifdef CONFIG_HIGH_RES_TIMERS
+	s3c2410_hr_ticks++;
+#endif
 	do_timer(regs);
 	restore_flags(flags);
 }
@@ -271,8 +279,15 @@ static inline void setup_timer(void)
 
 	TCON = (TCON_4_AUTO | TCON_4_UPDATE | COUNT_4_OFF);	
 	timer_irq.handler = s3c2410_timer_interrupt;
+#ifdef CONFIG_HIGH_RES_TIMERS
+	/* the hrtimer clock reads s3c2410_hr_ticks; no IRQs until it's bumped */
+	timer_irq.flags |= SA_INTERRUPT;
+#endif
 	setup_arm_irq(IRQ_TIMER4, &timer_irq);
 	TCON = (TCON_4_AUTO | COUNT_4_ON);
+#ifdef CONFIG_HIGH_RES_TIMERS
+	s3c2410_hrtimer_setup(pclk * 1000);
+#endif
 }
 
 EXPORT_SYMBOL(s3c2410_get_rtc_time);
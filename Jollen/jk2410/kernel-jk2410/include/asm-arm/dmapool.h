@@ -0,0 +1,24 @@
+/*
+ *  linux/include/asm-arm/dmapool.h
+ *
+ *  Pools of small DMA-consistent blocks, carved out of consistent_alloc()
+ *  pages.  See arch/arm/mm/dmapool.c.
+ */
+#ifndef __ASM_ARM_DMAPOOL_H
+#define __ASM_ARM_DMAPOOL_H
+
+#include <linux/types.h>
+
+/* dma_pool_create() flags */
+#define DMA_POOL_POISON		0x0001	/* fill free blocks with a pattern */
+#define DMA_POOL_WRITECOMBINE	0x0002	/* bufferable pages, see consistent.c */
+
+struct dma_pool;
+
+extern struct dma_pool *dma_pool_create(const char *name, size_t size,
+					size_t align, size_t boundary, int flags);
+extern void dma_pool_destroy(struct dma_pool *pool);
+extern void *dma_pool_alloc(struct dma_pool *pool, int mem_flags, dma_addr_t *handle);
+extern void dma_pool_free(struct dma_pool *pool, void *vaddr, dma_addr_t dma);
+
+#endif
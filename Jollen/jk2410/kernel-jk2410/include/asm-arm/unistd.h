@@ -259,6 +259,12 @@
 #define __NR_fremovexattr		(__NR_SYSCALL_BASE+237)
 #define __NR_tkill			(__NR_SYSCALL_BASE+238)
 #endif
+					/* 239 - 249 unused */
+#define __NR_epoll_create		(__NR_SYSCALL_BASE+250)
+#define __NR_epoll_ctl			(__NR_SYSCALL_BASE+251)
+#define __NR_epoll_wait			(__NR_SYSCALL_BASE+252)
+#define __NR_vmsplice			(__NR_SYSCALL_BASE+253)
+#define __NR_fadvise64			(__NR_SYSCALL_BASE+254)
 
 /*
  * The following SWIs are ARM private.
@@ -32,9 +32,11 @@ struct dentry_stat_t {
 	int nr_unused;
 	int age_limit;          /* age in seconds */
 	int want_pages;         /* pages requested by system */
-	int dummy[2];
+	int nr_negative;	/* negative dentries among the unused */
+	int dummy;
 };
 extern struct dentry_stat_t dentry_stat;
+extern int dentry_negative_max;
 
 /* Name hashing routines. Initial hash value */
 /* Hash courtesy of the R5 hash in reiserfs modulo sign bits */
@@ -0,0 +1,62 @@
+/*
+ *  include/linux/eventpoll.h
+ *
+ *  Persistent interest sets for readiness notification (epoll),
+ *  see fs/eventpoll.c.
+ */
+#ifndef _LINUX_EVENTPOLL_H
+#define _LINUX_EVENTPOLL_H
+
+#include <linux/types.h>
+
+/* Valid opcodes to issue to sys_epoll_ctl() */
+#define EPOLL_CTL_ADD	1
+#define EPOLL_CTL_DEL	2
+#define EPOLL_CTL_MOD	3
+
+/*
+ * Besides the POLL* bits of <asm/poll.h>: report an fd once per
+ * readiness change instead of for as long as it stays ready.
+ */
+#define EPOLLET		(1 << 31)
+
+struct epoll_event {
+	__u32 events;
+	__u64 data;
+};
+
+#ifdef __KERNEL__
+
+#include <linux/list.h>
+#include <linux/spinlock.h>
+#include <linux/fs.h>
+
+static inline void eventpoll_init_file(struct file *file)
+{
+	INIT_LIST_HEAD(&file->f_ep_links);
+	spin_lock_init(&file->f_ep_lock);
+}
+
+extern void eventpoll_release_file(struct file *file);
+
+/*
+ * Called by fput() on the last reference.  Nobody else can be adding
+ * this file to an interest set any more (that takes a reference), so
+ * the unlocked test is fine, and it keeps unwatched files off epsem.
+ */
+static inline void eventpoll_release(struct file *file)
+{
+	if (likely(list_empty(&file->f_ep_links)))
+		return;
+	eventpoll_release_file(file);
+}
+
+asmlinkage long sys_epoll_create(int size);
+asmlinkage long sys_epoll_ctl(int epfd, int op, int fd,
+			      struct epoll_event *event);
+asmlinkage long sys_epoll_wait(int epfd, struct epoll_event *events,
+			       int maxevents, int timeout);
+
+#endif /* __KERNEL__ */
+
+#endif /* _LINUX_EVENTPOLL_H */
@@ -0,0 +1,23 @@
+#ifndef _LINUX_FADVISE_H
+#define _LINUX_FADVISE_H
+
+/*
+ * posix_fadvise() advice values.  NORMAL, RANDOM and SEQUENTIAL set the
+ * read-ahead policy of the open file, WILLNEED and DONTNEED act on the
+ * page cache for the given range right away.
+ */
+#define POSIX_FADV_NORMAL	0	/* no further special treatment */
+#define POSIX_FADV_RANDOM	1	/* expect random page references */
+#define POSIX_FADV_SEQUENTIAL	2	/* expect sequential page references */
+#define POSIX_FADV_WILLNEED	3	/* will need these pages */
+#define POSIX_FADV_DONTNEED	4	/* don't need these pages */
+#define POSIX_FADV_NOREUSE	5	/* data will be accessed once */
+
+#ifdef __KERNEL__
+#include <linux/linkage.h>
+#include <linux/types.h>
+
+asmlinkage long sys_fadvise64(int fd, loff_t offset, size_t len, int advice);
+#endif
+
+#endif /* _LINUX_FADVISE_H */
@@ -526,6 +526,8 @@ struct file {
 	mode_t			f_mode;
 	loff_t			f_pos;
 	unsigned long 		f_reada, f_ramax, f_raend, f_ralen, f_rawin;
+	unsigned long		f_ranext;	/* where a sequential read resumes */
+	int			f_raadvice;	/* POSIX_FADV_* read-ahead policy */
 	struct fown_struct	f_owner;
 	unsigned int		f_uid, f_gid;
 	int			f_error;
@@ -538,6 +540,10 @@ struct file {
 	/* preallocated helper kiobuf to speedup O_DIRECT */
 	struct kiobuf		*f_iobuf;
 	long			f_iobuf_lock;
+
+	/* epoll interest sets watching this file, see fs/eventpoll.c */
+	struct list_head	f_ep_links;
+	spinlock_t		f_ep_lock;
 };
 extern spinlock_t files_lock;
 #define file_list_lock() spin_lock(&files_lock);
@@ -0,0 +1,77 @@
+#ifndef _LINUX_HRTIMER_H
+#define _LINUX_HRTIMER_H
+
+#include <linux/config.h>
+#include <linux/types.h>
+#include <linux/rbtree.h>
+
+/*
+ * High-resolution timers.
+ *
+ * The timer wheel in kernel/timer.c works in jiffies, so the best a
+ * driver can ask for is the next tick (10 ms at HZ=100).  An hrtimer
+ * instead carries an absolute expiry in nanoseconds on the monotonic
+ * clock returned by ktime_get(), and is fired from a one-shot hardware
+ * timer that is always programmed for the earliest pending expiry.
+ * Pending timers are kept in an rbtree ordered by expiry.
+ *
+ * The handler runs in hard interrupt context with interrupts disabled:
+ * it must not sleep and should be short.  It may re-arm its own timer
+ * with hrtimer_start().
+ */
+
+typedef s64 ktime_t;		/* nanoseconds */
+
+#define NSEC_PER_USEC		1000L
+#define NSEC_PER_MSEC		1000000L
+#define NSEC_PER_SEC		1000000000L
+
+struct hrtimer {
+	rb_node_t node;
+	ktime_t expires;
+	void (*function)(unsigned long);
+	unsigned long data;
+	int state;
+};
+
+#define HRTIMER_INACTIVE	0
+#define HRTIMER_PENDING		1
+
+/* hrtimer_start() modes */
+#define HRTIMER_ABS		0	/* expiry is a ktime_get() value */
+#define HRTIMER_REL		1	/* expiry is relative to now */
+
+static inline void init_hrtimer(struct hrtimer *timer)
+{
+	timer->state = HRTIMER_INACTIVE;
+}
+
+static inline int hrtimer_pending(const struct hrtimer *timer)
+{
+	return timer->state == HRTIMER_PENDING;
+}
+
+#ifdef CONFIG_HIGH_RES_TIMERS
+
+extern ktime_t ktime_get(void);
+extern unsigned long hrtimer_resolution(void);
+extern void hrtimer_start(struct hrtimer *timer, ktime_t expires, int mode);
+extern int hrtimer_cancel(struct hrtimer *timer);
+
+/* For the clock event code */
+extern void hrtimer_interrupt(void);
+extern void hrtimer_reprogram(void);
+
+/*
+ * Provided by the architecture: the monotonic clock, the resolution of
+ * the event timer in nanoseconds, and a way to make it interrupt once
+ * at (or as soon as possible after) "expires".  Both are called with
+ * interrupts disabled.
+ */
+extern ktime_t hrtimer_arch_now(void);
+extern unsigned long hrtimer_arch_resolution(void);
+extern void hrtimer_arch_program(ktime_t expires);
+
+#endif /* CONFIG_HIGH_RES_TIMERS */
+
+#endif /* _LINUX_HRTIMER_H */
@@ -39,6 +39,8 @@ struct sockaddr_ll
 #define PACKET_RX_RING			5
 #define PACKET_STATISTICS		6
 #define PACKET_COPY_THRESH		7
+#define PACKET_TX_RING			8
+#define PACKET_RX_COALESCE		9
 
 struct tpacket_stats
 {
@@ -54,6 +56,10 @@ struct tpacket_hdr
 #define TP_STATUS_COPY		2
 #define TP_STATUS_LOSING	4
 #define TP_STATUS_CSUMNOTREADY	8
+/* TX ring */
+#define TP_STATUS_AVAILABLE	0
+#define TP_STATUS_SEND_REQUEST	1
+#define TP_STATUS_WRONG_FORMAT	4
 	unsigned int	tp_len;
 	unsigned int	tp_snaplen;
 	unsigned short	tp_mac;
@@ -77,6 +83,18 @@ struct tpacket_hdr
    - Start+tp_mac: [ Optional MAC header ]
    - Start+tp_net: Packet data, aligned to TPACKET_ALIGNMENT=16.
    - Pad to align to TPACKET_ALIGNMENT=16
+
+   TX ring frames carry tp_len bytes of packet data right after the
+   aligned struct tpacket_hdr, i.e. at Start+TPACKET_HDRLEN-sizeof(struct
+   sockaddr_ll). The user fills the data and tp_len, sets tp_status to
+   TP_STATUS_SEND_REQUEST, and one send() transmits all such frames from
+   the ring head on. Frames are handed back as TP_STATUS_AVAILABLE, or as
+   TP_STATUS_WRONG_FORMAT if they could not be sent at all.
+
+   PACKET_RX_COALESCE takes a timeout in milliseconds. When it is not 0
+   the reader is not woken per frame, but when a block of the RX ring has
+   been filled or the timeout has passed since the first frame it was not
+   told about.
  */
 
 struct tpacket_req
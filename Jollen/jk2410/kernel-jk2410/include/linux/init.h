@@ -52,6 +52,20 @@ extern initcall_t __initcall_start, __initcall_end;
 
 #define __initcall(fn)								\
 	static initcall_t __initcall_##fn __init_call = fn
+
+/*
+ * Initcalls nothing on the way to the root filesystem depends on can
+ * be run from a kernel thread once init has been started.
+ */
+#ifdef CONFIG_ASYNC_INITCALLS
+extern initcall_t __initcall_async_start, __initcall_async_end;
+
+#define __initcall_async(fn)							\
+	static initcall_t __initcall_##fn __init_async_call = fn
+#else
+#define __initcall_async(fn)	__initcall(fn)
+#endif
+
 #define __exitcall(fn)								\
 	static exitcall_t __exitcall_##fn __exit_call = fn
 
@@ -81,6 +95,7 @@ extern struct kernel_param __setup_start, __setup_end;
 #define __exitdata	__attribute__ ((unused, __section__ (".data.exit")))
 #define __initsetup	__attribute__ ((unused,__section__ (".setup.init")))
 #define __init_call	__attribute__ ((unused,__section__ (".initcall.init")))
+#define __init_async_call	__attribute__ ((unused,__section__ (".initcall_async.init")))
 #define __exit_call	__attribute__ ((unused,__section__ (".exitcall.exit")))
 
 /* For assembly routines */
@@ -100,6 +115,17 @@ extern struct kernel_param __setup_start, __setup_end;
  */
 #define module_init(x)	__initcall(x);
 
+/**
+ * module_init_async() - driver initialization run after boot
+ * @x: function to be run once init has started, or at module insertion
+ *
+ * Same as module_init(), but a built-in driver's routine is deferred
+ * to a kernel thread that runs after the root filesystem is mounted
+ * and init has been started.  Only for drivers nothing on the way to
+ * the root filesystem depends on.
+ */
+#define module_init_async(x)	__initcall_async(x);
+
 /**
  * module_exit() - driver exit entry point
  * @x: function to be run when driver is removed
@@ -118,6 +144,7 @@ extern struct kernel_param __setup_start, __setup_end;
 #define __initdata
 #define __exitdata
 #define __initcall(fn)
+#define __initcall_async(fn)
 /* For assembly routines */
 #define __INIT
 #define __FINIT
@@ -134,6 +161,7 @@ typedef void (*__cleanup_module_func_t)(void);
 	int init_module(void) __attribute__((alias(#x))); \
 	static inline __init_module_func_t __init_module_inline(void) \
 	{ return x; }
+#define module_init_async(x)	module_init(x)
 #define module_exit(x) \
 	void cleanup_module(void) __attribute__((alias(#x))); \
 	static inline __cleanup_module_func_t __cleanup_module_inline(void) \
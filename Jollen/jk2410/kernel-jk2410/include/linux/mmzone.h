@@ -7,6 +7,8 @@
 #include <linux/config.h>
 #include <linux/spinlock.h>
 #include <linux/list.h>
+#include <linux/threads.h>
+#include <linux/cache.h>
 
 /*
  * Free memory management - zoned buddy allocator.
@@ -23,6 +25,25 @@ typedef struct free_area_struct {
 	unsigned long		*map;
 } free_area_t;
 
+/*
+ * Order-0 pages are allocated from and freed to small per-CPU lists,
+ * which are refilled from and drained to the buddy lists "batch" pages
+ * at a time under zone->lock.  Recently freed (cache-hot) pages go on
+ * one list, pages nobody touched recently on the other; the latter are
+ * handed out to __GFP_COLD callers, typically DMA targets.
+ */
+struct per_cpu_pages {
+	int			count;		/* pages on the list */
+	int			low;		/* refill below this */
+	int			high;		/* drain above this */
+	int			batch;		/* buddy pages moved at a time */
+	struct list_head	list;
+};
+
+struct per_cpu_pageset {
+	struct per_cpu_pages	pcp[2];		/* 0: hot, 1: cold */
+} ____cacheline_aligned_in_smp;
+
 struct pglist_data;
 
 /*
@@ -47,6 +68,11 @@ typedef struct zone_struct {
 	 */
 	free_area_t		free_area[MAX_ORDER];
 
+	/*
+	 * order-0 page lists, not counted in free_pages
+	 */
+	struct per_cpu_pageset	pageset[NR_CPUS];
+
 	/*
 	 * Discontig memory support fields.
 	 */
@@ -36,6 +36,12 @@ static inline struct page *page_cache_alloc(struct address_space *x)
 	return alloc_pages(x->gfp_mask, 0);
 }
 
+/* For read-ahead: the data arrives by DMA, so a cache-hot page is wasted */
+static inline struct page *page_cache_alloc_cold(struct address_space *x)
+{
+	return alloc_pages(x->gfp_mask | __GFP_COLD, 0);
+}
+
 /*
  * From a kernel address, get the "struct page *"
  */
@@ -2,11 +2,29 @@
 #define _LINUX_PIPE_FS_I_H
 
 #define PIPEFS_MAGIC 0x50495045
+
+/*
+ * A pipe is a ring of page-sized buffers. Pages are allocated as data
+ * is written and freed as it is read, so a larger capacity only costs
+ * memory while the pipe actually holds that much.
+ */
+#define PIPE_BUFFERS		4	/* default capacity, in pages */
+#define PIPE_MAX_BUFFERS	16	/* F_SETPIPE_SZ limit, a power of two */
+
+struct pipe_buffer {
+	struct page *page;
+	unsigned int offset, len;
+	unsigned int flags;
+};
+
+#define PIPE_BUF_GIFT		0x01	/* user page from vmsplice(), read only */
+
 struct pipe_inode_info {
 	wait_queue_head_t wait;
-	char *base;
-	unsigned int len;
-	unsigned int start;
+	unsigned int nrbufs, curbuf, buffers;
+	struct pipe_buffer bufs[PIPE_MAX_BUFFERS];
+	struct page *tmp_page;		/* spare page for the next write */
+	unsigned int len;		/* bytes in all buffers */
 	unsigned int readers;
 	unsigned int writers;
 	unsigned int waiting_readers;
@@ -15,14 +33,8 @@ struct pipe_inode_info {
 	unsigned int w_counter;
 };
 
-/* Differs from PIPE_BUF in that PIPE_SIZE is the length of the actual
-   memory allocation, whereas PIPE_BUF makes atomicity guarantees.  */
-#define PIPE_SIZE		PAGE_SIZE
-
 #define PIPE_SEM(inode)		(&(inode).i_sem)
 #define PIPE_WAIT(inode)	(&(inode).i_pipe->wait)
-#define PIPE_BASE(inode)	((inode).i_pipe->base)
-#define PIPE_START(inode)	((inode).i_pipe->start)
 #define PIPE_LEN(inode)		((inode).i_pipe->len)
 #define PIPE_READERS(inode)	((inode).i_pipe->readers)
 #define PIPE_WRITERS(inode)	((inode).i_pipe->writers)
@@ -32,15 +44,24 @@ struct pipe_inode_info {
 #define PIPE_WCOUNTER(inode)	((inode).i_pipe->w_counter)
 
 #define PIPE_EMPTY(inode)	(PIPE_LEN(inode) == 0)
-#define PIPE_FULL(inode)	(PIPE_LEN(inode) == PIPE_SIZE)
-#define PIPE_FREE(inode)	(PIPE_SIZE - PIPE_LEN(inode))
-#define PIPE_END(inode)	((PIPE_START(inode) + PIPE_LEN(inode)) & (PIPE_SIZE-1))
-#define PIPE_MAX_RCHUNK(inode)	(PIPE_SIZE - PIPE_START(inode))
-#define PIPE_MAX_WCHUNK(inode)	(PIPE_SIZE - PIPE_END(inode))
+
+/* vmsplice() flags */
+#define SPLICE_F_MOVE		0x01	/* accepted, pages are always moved */
+#define SPLICE_F_NONBLOCK	0x02	/* don't block on the pipe */
+#define SPLICE_F_MORE		0x04	/* accepted, no effect */
+#define SPLICE_F_GIFT		0x08	/* accepted, pages are always gifted */
 
 /* Drop the inode semaphore and wait for a pipe event, atomically */
 void pipe_wait(struct inode * inode);
 
+struct file;
+struct iovec;
+
 struct inode* pipe_new(struct inode* inode);
+void free_pipe_info(struct inode* inode);
+long pipe_fcntl(struct file *filp, unsigned int cmd, unsigned long arg);
+
+asmlinkage long sys_vmsplice(int fd, const struct iovec *iov,
+			     unsigned long nr_segs, unsigned int flags);
 
 #endif
@@ -129,8 +129,17 @@ struct pm_dev
 	int		 prev_state;
 
 	struct list_head entry;
+#ifdef CONFIG_MIZI
+	unsigned long	 suspend_usec;	/* last PM_SUSPEND callback */
+	unsigned long	 resume_usec;	/* last PM_RESUME callback */
+#endif
 };
 
+/*
+ * pm_dev flags
+ */
+#define PM_FLAG_ASYNC_RESUME	0x0001	/* may resume alongside others */
+
 #ifdef CONFIG_PM
 
 extern int pm_active;
@@ -11,10 +11,16 @@
 #include <asm/uaccess.h>
 
 struct poll_table_page;
+struct poll_table_struct;
+
+typedef void (*poll_queue_proc)(struct file *, wait_queue_head_t *,
+				struct poll_table_struct *);
 
 typedef struct poll_table_struct {
 	int error;
 	struct poll_table_page * table;
+	/* how poll_wait() queues us; __pollwait for select/poll */
+	poll_queue_proc qproc;
 } poll_table;
 
 extern void __pollwait(struct file * filp, wait_queue_head_t * wait_address, poll_table *p);
@@ -22,13 +28,14 @@ extern void __pollwait(struct file * filp, wait_queue_head_t * wait_address, pol
 static inline void poll_wait(struct file * filp, wait_queue_head_t * wait_address, poll_table *p)
 {
 	if (p && wait_address)
-		__pollwait(filp, wait_address, p);
+		p->qproc(filp, wait_address, p);
 }
 
 static inline void poll_initwait(poll_table* pt)
 {
 	pt->error = 0;
 	pt->table = NULL;
+	pt->qproc = __pollwait;
 }
 extern void poll_freewait(poll_table* pt);
 
@@ -320,6 +320,10 @@ struct task_struct {
 	 */
 	struct list_head run_list;
 	unsigned long sleep_time;
+#ifdef CONFIG_SCHED_PRIO_ARRAY
+	struct prio_array *array;	/* active or expired, NULL if not queued */
+	int prio;			/* queue index within the array */
+#endif
 
 	struct task_struct *next_task, *prev_task;
 	struct mm_struct *active_mm;
@@ -634,6 +638,32 @@ static inline int signal_pending(struct task_struct *p)
 	return (p->sigpending != 0);
 }
 
+/*
+ * Low-latency rescheduling points for long kernel loops.  Only call
+ * these where no spinlock is held.
+ */
+#ifdef CONFIG_LOLAT
+#define conditional_schedule_needed()	(current->need_resched)
+#define unconditional_schedule()			\
+	do {						\
+		__set_current_state(TASK_RUNNING);	\
+		schedule();				\
+	} while (0)
+#define conditional_schedule()				\
+	do {						\
+		if (conditional_schedule_needed())	\
+			unconditional_schedule();	\
+	} while (0)
+#else
+#define conditional_schedule_needed()	0
+#define unconditional_schedule()	do { } while (0)
+#define conditional_schedule()		do { } while (0)
+#endif
+
+#ifdef CONFIG_LOLAT_TRACE
+extern void lat_tick(struct pt_regs *regs);
+#endif
+
 /*
  * Re-calculate pending state from the set of locally pending
  * signals, globally pending signals, and blocked signals.
@@ -873,6 +903,9 @@ do {									\
 #define next_thread(p) \
 	list_entry((p)->thread_group.next, struct task_struct, thread_group)
 
+#ifdef CONFIG_SCHED_PRIO_ARRAY
+extern void del_from_runqueue(struct task_struct * p);
+#else
 static inline void del_from_runqueue(struct task_struct * p)
 {
 	nr_running--;
@@ -880,6 +913,7 @@ static inline void del_from_runqueue(struct task_struct * p)
 	list_del(&p->run_list);
 	p->run_list.next = NULL;
 }
+#endif
 
 static inline int task_on_runqueue(struct task_struct *p)
 {
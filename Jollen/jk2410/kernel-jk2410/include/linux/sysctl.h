@@ -497,7 +497,9 @@ enum {
 	NET_KHTTPD_DYNAMICSTRING= 10,
 	NET_KHTTPD_SLOPPYMIME   = 11,
 	NET_KHTTPD_THREADS	= 12,
-	NET_KHTTPD_MAXCONNECT	= 13
+	NET_KHTTPD_MAXCONNECT	= 13,
+	NET_KHTTPD_KEEPALIVE	= 14,
+	NET_KHTTPD_CACHETIME	= 15
 };
 
 /* /proc/sys/net/decnet/conf/<dev> */
@@ -543,6 +545,7 @@ enum
 	FS_LEASES=13,	/* int: leases enabled */
 	FS_DIR_NOTIFY=14,	/* int: directory notification enabled */
 	FS_LEASE_TIME=15,	/* int: maximum time to wait for a lease break */
+	FS_DENTRY_NEGMAX=16,	/* int: maximum number of unused negative dentries */
 };
 
 /* CTL_DEBUG names: */
@@ -28,10 +28,16 @@
 #define WAITQUEUE_DEBUG 0
 #endif
 
+struct __wait_queue;
+typedef int (*wait_queue_func_t)(struct __wait_queue *wait,
+				 unsigned int mode, int sync);
+
 struct __wait_queue {
 	unsigned int flags;
 #define WQ_FLAG_EXCLUSIVE	0x01
 	struct task_struct * task;
+	/* if set, called by wake_up instead of waking task */
+	wait_queue_func_t func;
 	struct list_head task_list;
 #if WAITQUEUE_DEBUG
 	long __magic;
@@ -174,6 +180,23 @@ static inline void init_waitqueue_entry(wait_queue_t *q, struct task_struct *p)
 #endif
 	q->flags = 0;
 	q->task = p;
+	q->func = NULL;
+#if WAITQUEUE_DEBUG
+	q->__magic = (long)&q->__magic;
+#endif
+}
+
+/*
+ * An entry without a task: wake_up calls func(), which returns non-zero
+ * if it counts as a woken exclusive waiter.  func runs with the wait
+ * queue lock held and maybe from interrupt context.
+ */
+static inline void init_waitqueue_func_entry(wait_queue_t *q,
+					     wait_queue_func_t func)
+{
+	q->flags = 0;
+	q->task = NULL;
+	q->func = func;
 #if WAITQUEUE_DEBUG
 	q->__magic = (long)&q->__magic;
 #endif
@@ -142,6 +142,28 @@ static int __init profile_setup(char *str)
 
 __setup("profile=", profile_setup);
 
+static int initcall_debug;
+
+static int __init initcall_debug_setup(char *str)
+{
+	initcall_debug = 1;
+	return 1;
+}
+
+__setup("initcall_debug", initcall_debug_setup);
+
+#ifdef CONFIG_ASYNC_INITCALLS
+static int initcall_sync;
+
+static int __init initcall_sync_setup(char *str)
+{
+	initcall_sync = 1;
+	return 1;
+}
+
+__setup("initcall_sync", initcall_sync_setup);
+#endif
+
 
 static struct dev_name_struct {
 	const char *name;
@@ -645,15 +667,79 @@ static int do_linuxrc(void * shell)
 
 struct task_struct *child_reaper = &init_task;
 
+/*
+ * With "initcall_debug" each initcall's address (look it up in
+ * System.map), return value and run time is printed.
+ */
+static void __init do_initcall_range(initcall_t *call, initcall_t *end)
+{
+	struct timeval t0, t1;
+	long usec;
+	int ret;
+
+	for (; call < end; call++) {
+		if (!initcall_debug) {
+			(*call)();
+			continue;
+		}
+		do_gettimeofday(&t0);
+		ret = (*call)();
+		do_gettimeofday(&t1);
+		usec = (t1.tv_sec - t0.tv_sec) * 1000000 +
+			(t1.tv_usec - t0.tv_usec);
+		printk(KERN_DEBUG "initcall %p returned %d after %ld usecs\n",
+		       *call, ret, usec);
+	}
+}
+
+#ifdef CONFIG_ASYNC_INITCALLS
+static int async_initcalls_pending;
+
+/*
+ * Not __init: this thread frees the init sections once the deferred
+ * initcalls have run, init() leaves that to us while we are pending.
+ */
+static int async_initcalls(void *unused)
+{
+	daemonize();
+	strcpy(current->comm, "kinitcalls");
+
+	lock_kernel();
+	do_initcall_range(&__initcall_async_start, &__initcall_async_end);
+	flush_scheduled_tasks();
+	free_initmem();
+	unlock_kernel();
+
+	printk(KERN_INFO "Deferred initcalls done after %lu ms\n",
+	       jiffies * (1000 / HZ));
+	return 0;
+}
+
+static void start_async_initcalls(void)
+{
+	if (async_initcalls_pending &&
+	    kernel_thread(async_initcalls, NULL, SIGCHLD) < 0) {
+		printk(KERN_ERR "Unable to start deferred initcalls\n");
+		lock_kernel();
+		do_initcall_range(&__initcall_async_start, &__initcall_async_end);
+		free_initmem();
+		unlock_kernel();
+	}
+}
+#endif
+
 static void __init do_initcalls(void)
 {
-	initcall_t *call;
+	do_initcall_range(&__initcall_start, &__initcall_end);
 
-	call = &__initcall_start;
-	do {
-		(*call)();
-		call++;
-	} while (call < &__initcall_end);
+#ifdef CONFIG_ASYNC_INITCALLS
+	if (initcall_sync)
+		do_initcall_range(&__initcall_async_start,
+				  &__initcall_async_end);
+	else
+		async_initcalls_pending =
+			&__initcall_async_start < &__initcall_async_end;
+#endif
 
 	/* Make sure there is no pending stuff from the initcall sequence */
 	flush_scheduled_tasks();
@@ -814,9 +900,17 @@ static int init(void * unused)
 	 * we're essentially up and running. Get rid of the
 	 * initmem segments and start the user-mode stuff..
 	 */
+#ifdef CONFIG_ASYNC_INITCALLS
+	if (!async_initcalls_pending)
+#endif
 	free_initmem();
 	unlock_kernel();
 
+	printk(KERN_INFO "Starting init after %lu ms\n", jiffies * (1000 / HZ));
+#ifdef CONFIG_ASYNC_INITCALLS
+	start_async_initcalls();
+#endif
+
 	if (open("/dev/console", O_RDWR, 0) < 0)
 		printk("Warning: unable to open an initial console.\n");
 
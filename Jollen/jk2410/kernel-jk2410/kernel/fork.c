@@ -628,6 +628,9 @@ int do_fork(unsigned long clone_flags, unsigned long stack_start,
 
 	p->run_list.next = NULL;
 	p->run_list.prev = NULL;
+#ifdef CONFIG_SCHED_PRIO_ARRAY
+	p->array = NULL;
+#endif
 
 	p->p_cptr = NULL;
 	init_waitqueue_head(&p->wait_chldexit);
@@ -0,0 +1,297 @@
+/*
+ *  linux/kernel/hrtimer.c
+ *
+ *  High-resolution timers, see include/linux/hrtimer.h.
+ *
+ *  Pending timers sit in an rbtree ordered by expiry, with the leftmost
+ *  node cached so that finding the next event is O(1).  The architecture
+ *  provides a monotonic nanosecond clock and a one-shot event timer; the
+ *  event timer is only reprogrammed when the earliest expiry changes.
+ *
+ *  /proc/hrtimers reports how late handlers ran relative to their
+ *  expiry.  Writing to it resets the counters.
+ */
+
+#include <linux/config.h>
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/spinlock.h>
+#include <linux/proc_fs.h>
+#include <linux/hrtimer.h>
+
+#include <asm/div64.h>
+
+static spinlock_t hrtimer_lock = SPIN_LOCK_UNLOCKED;
+static rb_root_t hrtimer_root = RB_ROOT;
+static struct hrtimer *hrtimer_first;	/* leftmost node of hrtimer_root */
+
+/*
+ * Lateness of handlers: now - expires when the handler is called.
+ * The buckets are upper bounds in microseconds, the last one is open.
+ */
+static const unsigned int late_bucket_usec[] = { 10, 50, 100, 500, 1000 };
+#define NR_LATE_BUCKETS	(ARRAY_SIZE(late_bucket_usec) + 1)
+
+static struct hrtimer_stats {
+	unsigned long fired;
+	unsigned long programmed;
+	unsigned long long late_total;	/* ns */
+	unsigned long late_max;		/* ns */
+	unsigned long late[NR_LATE_BUCKETS];
+} hrtimer_stats;
+
+ktime_t ktime_get(void)
+{
+	unsigned long flags;
+	ktime_t now;
+
+	local_irq_save(flags);
+	now = hrtimer_arch_now();
+	local_irq_restore(flags);
+	return now;
+}
+
+unsigned long hrtimer_resolution(void)
+{
+	return hrtimer_arch_resolution();
+}
+
+/* In-order successor, the 2.4 rbtree code has no rb_next() */
+static rb_node_t *hrtimer_next_node(rb_node_t *node)
+{
+	rb_node_t *parent;
+
+	if (node->rb_right) {
+		node = node->rb_right;
+		while (node->rb_left)
+			node = node->rb_left;
+		return node;
+	}
+	while ((parent = node->rb_parent) && node == parent->rb_right)
+		node = parent;
+	return parent;
+}
+
+/* Called with hrtimer_lock held; returns 1 if timer became the first */
+static int enqueue_hrtimer(struct hrtimer *timer)
+{
+	rb_node_t **link = &hrtimer_root.rb_node;
+	rb_node_t *parent = NULL;
+	struct hrtimer *entry;
+	int leftmost = 1;
+
+	while (*link) {
+		parent = *link;
+		entry = rb_entry(parent, struct hrtimer, node);
+		/* equal expiries go right, so they fire in start order */
+		if (timer->expires < entry->expires)
+			link = &parent->rb_left;
+		else {
+			link = &parent->rb_right;
+			leftmost = 0;
+		}
+	}
+	rb_link_node(&timer->node, parent, link);
+	rb_insert_color(&timer->node, &hrtimer_root);
+	timer->state = HRTIMER_PENDING;
+
+	if (leftmost)
+		hrtimer_first = timer;
+	return leftmost;
+}
+
+/* Called with hrtimer_lock held; returns 1 if timer was the first */
+static int remove_hrtimer(struct hrtimer *timer)
+{
+	int was_first = 0;
+
+	if (hrtimer_first == timer) {
+		rb_node_t *next = hrtimer_next_node(&timer->node);
+
+		hrtimer_first = next ? rb_entry(next, struct hrtimer, node) : NULL;
+		was_first = 1;
+	}
+	rb_erase(&timer->node, &hrtimer_root);
+	timer->state = HRTIMER_INACTIVE;
+	return was_first;
+}
+
+static inline void program_first(void)
+{
+	if (hrtimer_first) {
+		hrtimer_stats.programmed++;
+		hrtimer_arch_program(hrtimer_first->expires);
+	}
+}
+
+/*
+ * Start (or restart) a timer.  With HRTIMER_REL the expiry is taken
+ * relative to ktime_get().  An expiry in the past fires as soon as
+ * the event timer allows.
+ */
+void hrtimer_start(struct hrtimer *timer, ktime_t expires, int mode)
+{
+	unsigned long flags;
+	int reprogram = 0;
+
+	spin_lock_irqsave(&hrtimer_lock, flags);
+	if (timer->state == HRTIMER_PENDING)
+		reprogram = remove_hrtimer(timer);
+	if (mode == HRTIMER_REL)
+		expires += hrtimer_arch_now();
+	timer->expires = expires;
+	reprogram |= enqueue_hrtimer(timer);
+	if (reprogram)
+		program_first();
+	spin_unlock_irqrestore(&hrtimer_lock, flags);
+}
+
+/*
+ * Stop a timer.  Returns 1 if it was pending, 0 if it had already
+ * fired or was never started.  The handler is not running on return
+ * unless this is called from the handler itself (UP only).
+ */
+int hrtimer_cancel(struct hrtimer *timer)
+{
+	unsigned long flags;
+	int ret = 0;
+
+	spin_lock_irqsave(&hrtimer_lock, flags);
+	if (timer->state == HRTIMER_PENDING) {
+		/*
+		 * Leave the event timer alone even if this was the first:
+		 * an early interrupt finds nothing expired and reprograms.
+		 */
+		remove_hrtimer(timer);
+		ret = 1;
+	}
+	spin_unlock_irqrestore(&hrtimer_lock, flags);
+	return ret;
+}
+
+static void account_late(ktime_t late)
+{
+	struct hrtimer_stats *s = &hrtimer_stats;
+	unsigned long ns, usec;
+	int i;
+
+	if (late < 0)
+		ns = 0;
+	else if (late > LONG_MAX)
+		ns = LONG_MAX;
+	else
+		ns = (unsigned long)late;
+
+	s->fired++;
+	s->late_total += ns;
+	if (ns > s->late_max)
+		s->late_max = ns;
+
+	usec = ns / NSEC_PER_USEC;
+	for (i = 0; i < NR_LATE_BUCKETS - 1; i++)
+		if (usec < late_bucket_usec[i])
+			break;
+	s->late[i]++;
+}
+
+/*
+ * Called from the event timer interrupt, interrupts disabled: run every
+ * expired handler, then program the event timer for whatever is left.
+ */
+void hrtimer_interrupt(void)
+{
+	struct hrtimer *timer;
+	ktime_t now;
+
+	spin_lock(&hrtimer_lock);
+	now = hrtimer_arch_now();
+	while ((timer = hrtimer_first) != NULL && timer->expires <= now) {
+		remove_hrtimer(timer);
+		account_late(now - timer->expires);
+
+		spin_unlock(&hrtimer_lock);
+		timer->function(timer->data);
+		spin_lock(&hrtimer_lock);
+
+		now = hrtimer_arch_now();
+	}
+	program_first();
+	spin_unlock(&hrtimer_lock);
+}
+
+/* The event timer lost its state (e.g. across suspend): set it again */
+void hrtimer_reprogram(void)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&hrtimer_lock, flags);
+	program_first();
+	spin_unlock_irqrestore(&hrtimer_lock, flags);
+}
+
+#ifdef CONFIG_PROC_FS
+static int hrtimers_read_proc(char *page, char **start, off_t off,
+			      int count, int *eof, void *data)
+{
+	struct hrtimer_stats s;
+	unsigned long long avg;
+	unsigned long flags;
+	char *p = page;
+	int i, len;
+
+	local_irq_save(flags);
+	s = hrtimer_stats;
+	local_irq_restore(flags);
+
+	avg = s.late_total;
+	if (s.fired)
+		do_div(avg, s.fired);
+
+	p += sprintf(p, "resolution:   %lu ns\n", hrtimer_resolution());
+	p += sprintf(p, "fired:        %lu\n", s.fired);
+	p += sprintf(p, "programmed:   %lu\n", s.programmed);
+	p += sprintf(p, "late avg:     %lu ns\n", (unsigned long)avg);
+	p += sprintf(p, "late max:     %lu ns\n", s.late_max);
+	for (i = 0; i < NR_LATE_BUCKETS - 1; i++)
+		p += sprintf(p, "  < %4u us:  %lu\n", late_bucket_usec[i], s.late[i]);
+	p += sprintf(p, "  >=%4u us:  %lu\n", late_bucket_usec[i - 1], s.late[i]);
+
+	len = (p - page) - off;
+	if (len < 0)
+		len = 0;
+	*eof = (len <= count) ? 1 : 0;
+	*start = page + off;
+	return len;
+}
+
+static int hrtimers_write_proc(struct file *file, const char *buffer,
+			       unsigned long count, void *data)
+{
+	unsigned long flags;
+
+	local_irq_save(flags);
+	memset(&hrtimer_stats, 0, sizeof(hrtimer_stats));
+	local_irq_restore(flags);
+	return count;
+}
+
+static int __init hrtimer_proc_init(void)
+{
+	struct proc_dir_entry *ent;
+
+	ent = create_proc_entry("hrtimers", S_IWUSR | S_IRUGO, NULL);
+	if (ent) {
+		ent->read_proc = hrtimers_read_proc;
+		ent->write_proc = hrtimers_write_proc;
+	}
+	return 0;
+}
+
+__initcall(hrtimer_proc_init);
+#endif
+
+EXPORT_SYMBOL(ktime_get);
+EXPORT_SYMBOL(hrtimer_resolution);
+EXPORT_SYMBOL(hrtimer_start);
+EXPORT_SYMBOL(hrtimer_cancel);
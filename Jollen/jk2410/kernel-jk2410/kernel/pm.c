@@ -23,6 +23,8 @@
 #include <linux/slab.h>
 #include <linux/pm.h>
 #include <linux/interrupt.h>
+#include <linux/sched.h>
+#include <linux/smp_lock.h>
 
 int pm_active;
 #ifdef CONFIG_MIZI
@@ -168,8 +170,23 @@ int pm_send(struct pm_dev *dev, pm_request_t rqst, void *data)
 		prev_state = dev->state;
 		next_state = (int) data;
 		if (prev_state != next_state) {
+#ifdef CONFIG_MIZI
+			struct timeval t0, t1;
+			unsigned long usec;
+
+			do_gettimeofday(&t0);
+#endif
 			if (dev->callback)
 				status = (*dev->callback)(dev, rqst, data);
+#ifdef CONFIG_MIZI
+			do_gettimeofday(&t1);
+			usec = (t1.tv_sec - t0.tv_sec) * 1000000 +
+				(t1.tv_usec - t0.tv_usec);
+			if (rqst == PM_SUSPEND)
+				dev->suspend_usec = usec;
+			else
+				dev->resume_usec = usec;
+#endif
 			if (!status) {
 				dev->state = next_state;
 				dev->prev_state = prev_state;
@@ -294,16 +311,67 @@ int pm_send_all_tweak(pm_request_t rqst, void *data, pm_dev_t type)
 	return 0;
 }
 
+/*
+ * Devices flagged PM_FLAG_ASYNC_RESUME are resumed from a kernel
+ * thread each, so one sleeping in its callback (waiting for a panel
+ * or a chip to become ready) does not hold up the others.  The caller
+ * still returns only after all of them are done.
+ */
+static atomic_t pm_resume_pending = ATOMIC_INIT(0);
+static DECLARE_WAIT_QUEUE_HEAD(pm_resume_wait);
+static int pm_resume_status;
+static void *pm_resume_data;
+
+static int pm_resume_thread(void *arg)
+{
+	struct pm_dev *dev = arg;
+	int status;
+
+	reparent_to_init();
+	daemonize();
+	strcpy(current->comm, "kpmresume");
+
+	lock_kernel();
+	status = pm_send(dev, PM_RESUME, pm_resume_data);
+	unlock_kernel();
+
+	if (status)
+		pm_resume_status = status;
+	if (atomic_dec_and_test(&pm_resume_pending))
+		wake_up(&pm_resume_wait);
+	return 0;
+}
+
+static int pm_resume_async(struct pm_dev *dev)
+{
+	atomic_inc(&pm_resume_pending);
+	if (kernel_thread(pm_resume_thread, dev, CLONE_FS | CLONE_FILES) < 0) {
+		atomic_dec(&pm_resume_pending);
+		return pm_send(dev, PM_RESUME, pm_resume_data);
+	}
+	return 0;
+}
+
 int pm_send_all_type(pm_dev_t type, pm_request_t rqst, void *data)
 {
 	struct list_head *entry;
 
 	down(&pm_devs_lock);
+	if (rqst == PM_RESUME) {
+		pm_resume_status = 0;
+		pm_resume_data = data;
+	}
 	for(entry = pm_devs.next; entry != &pm_devs; entry = entry->next) {
 		struct pm_dev *dev = list_entry(entry, struct pm_dev, entry);
 		if (dev->type != type) continue;
 		if (dev->callback) {
-			int status = pm_send(dev, rqst, data);
+			int status;
+
+			if (rqst == PM_RESUME &&
+			    (dev->flags & PM_FLAG_ASYNC_RESUME))
+				status = pm_resume_async(dev);
+			else
+				status = pm_send(dev, rqst, data);
 			if (status) {
 				/* return devices to previous state on 
 				* failed suspend request
@@ -316,6 +384,12 @@ int pm_send_all_type(pm_dev_t type, pm_request_t rqst, void *data)
 		}
 		
 	}
+	if (rqst == PM_RESUME) {
+		wait_event(pm_resume_wait,
+			   atomic_read(&pm_resume_pending) == 0);
+		up(&pm_devs_lock);
+		return pm_resume_status;
+	}
 	up(&pm_devs_lock);
 	return 0;
 }
@@ -26,8 +26,12 @@
 #include <linux/module.h>
 #include <linux/interrupt.h>			/* For in_interrupt() */
 #include <linux/config.h>
+#include <linux/notifier.h>
+#include <linux/reboot.h>
+#include <linux/hrtimer.h>
 
 #include <asm/uaccess.h>
+#include <asm/div64.h>
 
 #ifdef CONFIG_MULTIQUAD
 #define LOG_BUF_LEN	(65536)
@@ -96,6 +100,23 @@ static int preferred_console = -1;
 /* Flag: console code may call schedule() */
 static int console_may_schedule;
 
+/*
+ * Once kconsoled runs, printk() only queues the text and the thread
+ * writes it to the consoles, so callers (interrupt handlers above all)
+ * do not wait for a 115200 baud UART.  Output is synchronous before the
+ * thread starts, while an oops is in progress, and for good after a
+ * panic or on the way to a reboot.  "printk_sync" keeps it synchronous.
+ */
+static int console_async;
+static int console_sync_only;
+static unsigned long console_dropped;	/* chars lost before reaching a console */
+static DECLARE_WAIT_QUEUE_HEAD(console_wait);
+
+#define CONSOLE_CHUNK	128		/* chars written between reschedules */
+
+/* Prefix each line with the time since boot: "printk_time" */
+static int printk_time;
+
 /*
  *	Setup a list of consoles. Called from init/main.c
  */
@@ -151,6 +172,22 @@ static int __init console_setup(char *str)
 
 __setup("console=", console_setup);
 
+static int __init printk_sync_setup(char *str)
+{
+	console_sync_only = 1;
+	return 1;
+}
+
+__setup("printk_sync", printk_sync_setup);
+
+static int __init printk_time_setup(char *str)
+{
+	printk_time = 1;
+	return 1;
+}
+
+__setup("printk_time", printk_time_setup);
+
 /*
  * Commands to do_syslog:
  *
@@ -385,12 +422,49 @@ static void emit_log_char(char c)
 	log_end++;
 	if (log_end - log_start > LOG_BUF_LEN)
 		log_start = log_end - LOG_BUF_LEN;
-	if (log_end - con_start > LOG_BUF_LEN)
+	if (log_end - con_start > LOG_BUF_LEN) {
 		con_start = log_end - LOG_BUF_LEN;
+		console_dropped++;
+	}
 	if (logged_chars < LOG_BUF_LEN)
 		logged_chars++;
 }
 
+static void emit_log_time(void)
+{
+	unsigned long sec, usec;
+	char buf[24], *p;
+#ifdef CONFIG_HIGH_RES_TIMERS
+	u64 now = ktime_get();
+
+	usec = do_div(now, NSEC_PER_SEC) / NSEC_PER_USEC;
+	sec = (unsigned long)now;
+#else
+	unsigned long now = jiffies;
+
+	sec = now / HZ;
+	usec = (now % HZ) * (1000000 / HZ);
+#endif
+	sprintf(buf, "[%5lu.%06lu] ", sec, usec);
+	for (p = buf; *p; p++)
+		emit_log_char(*p);
+}
+
+/*
+ * printk() may run under the runqueue lock, so it does not wake
+ * kconsoled itself; neither can it raise a softirq, which from
+ * process context wakes ksoftirqd.  Arming a timer takes only
+ * timerlist_lock, and the wake-up then comes from the next tick.
+ */
+static void console_timer_func(unsigned long unused)
+{
+	wake_up_interruptible(&console_wait);
+}
+
+static struct timer_list console_timer = {
+	function:	console_timer_func,
+};
+
 /*
  * This is printk.  It can be called from any context.  We want it to work.
  * 
@@ -438,8 +512,16 @@ asmlinkage int printk(const char *fmt, ...)
 				emit_log_char('<');
 				emit_log_char(default_message_loglevel + '0');
 				emit_log_char('>');
+			} else {
+				emit_log_char(*p++);
+				emit_log_char(*p++);
+				emit_log_char(*p++);
 			}
+			if (printk_time)
+				emit_log_time();
 			log_level_unknown = 0;
+			if (!*p)
+				break;
 		}
 		emit_log_char(*p);
 		if (*p == '\n')
@@ -454,6 +536,13 @@ asmlinkage int printk(const char *fmt, ...)
 		spin_unlock_irqrestore(&logbuf_lock, flags);
 		goto out;
 	}
+	if (console_async && !oops_in_progress) {
+		/* kconsoled writes it out, woken from the timer tick */
+		spin_unlock_irqrestore(&logbuf_lock, flags);
+		if (!timer_pending(&console_timer))
+			mod_timer(&console_timer, jiffies);
+		goto out;
+	}
 	if (!down_trylock(&console_sem)) {
 		/*
 		 * We own the drivers.  We can drop the spinlock and let
@@ -530,6 +619,107 @@ void release_console_sem(void)
 		wake_up_interruptible(&log_wait);
 }
 
+/* Tell the consoles that kconsoled fell behind.  console_sem held. */
+static void console_note_dropped(unsigned long dropped)
+{
+	struct console *con;
+	char buf[48];
+	int len;
+
+	len = sprintf(buf, "** %lu console chars dropped **\n", dropped);
+	for (con = console_drivers; con; con = con->next) {
+		if ((con->flags & CON_ENABLED) && con->write)
+			con->write(con, buf, len);
+	}
+}
+
+/*
+ * kconsoled: write queued text to the consoles a chunk at a time,
+ * giving up the CPU in between when asked to.  Chunks end after a
+ * newline where possible so that level tags are never split.
+ */
+static int console_thread(void *unused)
+{
+	struct task_struct *tsk = current;
+	unsigned long flags, start, end, dropped;
+
+	daemonize();
+	strcpy(tsk->comm, "kconsoled");
+	sigfillset(&tsk->blocked);
+	console_async = 1;
+
+	for (;;) {
+		wait_event_interruptible(console_wait, con_start != log_end);
+
+		acquire_console_sem();
+		spin_lock_irqsave(&logbuf_lock, flags);
+		while (console_async && con_start != log_end) {
+			start = con_start;
+			end = log_end;
+			if (end - start > CONSOLE_CHUNK) {
+				for (end = start + CONSOLE_CHUNK; end != start; end--)
+					if (LOG_BUF(end - 1) == '\n')
+						break;
+				if (end == start)
+					end = start + CONSOLE_CHUNK;
+			}
+			con_start = end;
+			dropped = console_dropped;
+			console_dropped = 0;
+			spin_unlock_irqrestore(&logbuf_lock, flags);
+
+			if (dropped)
+				console_note_dropped(dropped);
+			call_console_drivers(start, end);
+			console_conditional_schedule();
+
+			spin_lock_irqsave(&logbuf_lock, flags);
+		}
+		spin_unlock_irqrestore(&logbuf_lock, flags);
+		release_console_sem();
+	}
+	return 0;
+}
+
+/* Going down: back to synchronous output, and flush what is queued */
+static int console_reboot_notify(struct notifier_block *nb, unsigned long event, void *unused)
+{
+	console_async = 0;
+	acquire_console_sem();
+	release_console_sem();
+	return NOTIFY_DONE;
+}
+
+static int console_panic_notify(struct notifier_block *nb, unsigned long event, void *unused)
+{
+	console_async = 0;
+	/* kconsoled may hold the semaphore and will never run again */
+	init_MUTEX(&console_sem);
+	if (!down_trylock(&console_sem))
+		release_console_sem();
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block console_reboot_nb = {
+	notifier_call:	console_reboot_notify,
+};
+
+static struct notifier_block console_panic_nb = {
+	notifier_call:	console_panic_notify,
+};
+
+static int __init console_thread_init(void)
+{
+	if (console_sync_only)
+		return 0;
+	register_reboot_notifier(&console_reboot_nb);
+	notifier_chain_register(&panic_notifier_list, &console_panic_nb);
+	kernel_thread(console_thread, NULL, CLONE_FS | CLONE_FILES | CLONE_SIGNAL);
+	return 0;
+}
+
+__initcall(console_thread_init);
+
 /** console_conditional_schedule - yield the CPU if required
  *
  * If the console code is currently allowed to sleep, and
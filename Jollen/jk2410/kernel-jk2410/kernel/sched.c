@@ -30,6 +30,7 @@
 #include <linux/prefetch.h>
 #include <linux/compiler.h>
 
+#include <linux/proc_fs.h>
 #include <asm/uaccess.h>
 #include <asm/mmu_context.h>
 
@@ -92,7 +93,164 @@ struct task_struct * init_tasks[NR_CPUS] = {&init_task, };
 spinlock_t runqueue_lock __cacheline_aligned = SPIN_LOCK_UNLOCKED;  /* inner */
 rwlock_t tasklist_lock __cacheline_aligned = RW_LOCK_UNLOCKED;	/* outer */
 
+#ifdef CONFIG_SCHED_PRIO_ARRAY
+/*
+ * Priority-array runqueue (UP only).
+ *
+ * Runnable tasks sit in one list per priority: 0..99 for realtime
+ * tasks (higher rt_priority first), 100..139 for SCHED_OTHER by nice
+ * level.  A bitmap of the non-empty lists makes picking the next task
+ * independent of the number of runnable tasks.
+ *
+ * SCHED_OTHER tasks that used up their timeslice get a new one right
+ * away and move to the expired array; when the active array runs
+ * empty the two are swapped.  This replaces the goodness() scan and
+ * the recalculation of every task's counter under tasklist_lock.
+ */
+#define MAX_RT_PRIO	100
+#define MAX_PRIO	(MAX_RT_PRIO + 40)
+#define PRIO_LONGS	((MAX_PRIO + 1 + 8 * sizeof(long) - 1) / (8 * sizeof(long)))
+
+struct prio_array {
+	int nr_active;
+	unsigned long bitmap[PRIO_LONGS];
+	struct list_head queue[MAX_PRIO];
+};
+
+static struct prio_array prio_arrays[2];
+static struct prio_array *active = &prio_arrays[0];
+static struct prio_array *expired = &prio_arrays[1];
+
+static inline int task_prio(struct task_struct *p)
+{
+	if ((p->policy & ~SCHED_YIELD) != SCHED_OTHER)
+		return MAX_RT_PRIO - 1 - p->rt_priority;
+	return MAX_RT_PRIO + 20 + p->nice;
+}
+
+/* the bit at MAX_PRIO is always set, so this terminates */
+static inline int sched_find_first_bit(unsigned long *b)
+{
+	int i;
+
+	for (i = 0; !b[i]; i++)
+		;
+	return i * 8 * sizeof(long) + ffs(b[i]) - 1;
+}
+
+static inline void enqueue_task(struct task_struct *p, struct prio_array *array)
+{
+	p->prio = task_prio(p);
+	list_add_tail(&p->run_list, array->queue + p->prio);
+	__set_bit(p->prio, array->bitmap);
+	array->nr_active++;
+	p->array = array;
+}
+
+static inline void dequeue_task(struct task_struct *p)
+{
+	struct prio_array *array = p->array;
+
+	list_del(&p->run_list);
+	if (list_empty(array->queue + p->prio))
+		__clear_bit(p->prio, array->bitmap);
+	array->nr_active--;
+	p->array = NULL;
+}
+
+static inline void add_to_runqueue(struct task_struct * p)
+{
+	if (p->policy == SCHED_OTHER && !p->counter) {
+		p->counter = NICE_TO_TICKS(p->nice);
+		enqueue_task(p, expired);
+	} else
+		enqueue_task(p, active);
+	nr_running++;
+}
+
+void del_from_runqueue(struct task_struct * p)
+{
+	nr_running--;
+	p->sleep_time = jiffies;
+	dequeue_task(p);
+	p->run_list.next = NULL;
+}
+
+static inline void move_last_runqueue(struct task_struct * p)
+{
+	struct prio_array *array = p->array;
+
+	dequeue_task(p);
+	enqueue_task(p, array);
+}
+
+static inline void move_first_runqueue(struct task_struct * p)
+{
+	struct prio_array *array = p->array;
+
+	/* a task just made realtime must not wait out the expired array */
+	if ((p->policy & ~SCHED_YIELD) != SCHED_OTHER)
+		array = active;
+	dequeue_task(p);
+	enqueue_task(p, array);
+	list_del(&p->run_list);
+	list_add(&p->run_list, array->queue + p->prio);
+}
+
+/*
+ * Requeue the outgoing task if it stays runnable: yielders and
+ * SCHED_OTHER tasks out of timeslice go behind everything in the
+ * active array.
+ */
+static inline void requeue_prev(struct task_struct *prev)
+{
+	if (!prev->array)
+		return;
+	if (prev->policy == SCHED_OTHER) {
+		if (prev->counter)
+			return;
+		prev->counter = NICE_TO_TICKS(prev->nice);
+	} else if (prev->policy != (SCHED_OTHER | SCHED_YIELD)) {
+		if (prev->policy & SCHED_YIELD)
+			move_last_runqueue(prev);
+		return;
+	}
+	dequeue_task(prev);
+	enqueue_task(prev, expired);
+}
+
+static inline struct task_struct *pick_next_task(int this_cpu)
+{
+	int idx;
+
+	if (!active->nr_active && expired->nr_active) {
+		struct prio_array *array = active;
+
+		active = expired;
+		expired = array;
+	}
+	idx = sched_find_first_bit(active->bitmap);
+	if (idx >= MAX_PRIO)
+		return idle_task(this_cpu);
+	return list_entry(active->queue[idx].next, struct task_struct, run_list);
+}
+
+static void __init init_prio_arrays(void)
+{
+	int i, j;
+
+	for (i = 0; i < 2; i++) {
+		struct prio_array *array = prio_arrays + i;
+
+		for (j = 0; j < MAX_PRIO; j++)
+			INIT_LIST_HEAD(array->queue + j);
+		memset(array->bitmap, 0, sizeof(array->bitmap));
+		__set_bit(MAX_PRIO, array->bitmap);
+	}
+}
+#else
 static LIST_HEAD(runqueue_head);
+#endif
 
 /*
  * We align per-CPU scheduling data on cacheline boundaries,
@@ -127,6 +285,107 @@ extern struct task_struct *child_reaper;
 
 void scheduling_functions_start_here(void) { }
 
+#ifdef CONFIG_LOLAT_TRACE
+/*
+ * Wake-up latency tracer.  The clock starts when a wakeup sets
+ * need_resched on the running task and stops when schedule() runs.
+ * While it is running, the timer tick remembers the kernel pc it
+ * interrupted, which points at the loop that did not reschedule.
+ * The worst case is reported in /proc/latency.
+ */
+static struct lat_record {
+	unsigned long usec;
+	unsigned long pc;	/* last kernel pc seen by the tick */
+	void *sched_from;	/* caller of schedule() */
+	pid_t pid;		/* task that was woken */
+	char comm[16];
+} lat_cur, lat_max;
+
+static struct timeval lat_start;
+static int lat_pending;
+
+static inline void lat_mark(struct task_struct *p)
+{
+	if (lat_pending)
+		return;
+	do_gettimeofday(&lat_start);
+	lat_pending = 1;
+	lat_cur.pc = 0;
+	lat_cur.pid = p->pid;
+	memcpy(lat_cur.comm, p->comm, sizeof(lat_cur.comm));
+}
+
+static inline void lat_stop(void *sched_from)
+{
+	struct timeval now;
+
+	if (!lat_pending)
+		return;
+	lat_pending = 0;
+	do_gettimeofday(&now);
+	lat_cur.usec = (now.tv_sec - lat_start.tv_sec) * 1000000 +
+		(now.tv_usec - lat_start.tv_usec);
+	if (lat_cur.usec > lat_max.usec) {
+		lat_cur.sched_from = sched_from;
+		lat_max = lat_cur;
+	}
+}
+
+void lat_tick(struct pt_regs *regs)
+{
+	if (lat_pending && !user_mode(regs))
+		lat_cur.pc = instruction_pointer(regs);
+}
+
+static int latency_read_proc(char *page, char **start, off_t off,
+			     int count, int *eof, void *data)
+{
+	char *p = page;
+	int len;
+
+	p += sprintf(p, "max wakeup latency: %lu us\n", lat_max.usec);
+	if (lat_max.usec) {
+		p += sprintf(p, "woken task:     %s (%d)\n",
+			     lat_max.comm, lat_max.pid);
+		p += sprintf(p, "scheduled from: %p\n", lat_max.sched_from);
+		p += sprintf(p, "kernel pc:      %08lx\n", lat_max.pc);
+	}
+
+	len = (p - page) - off;
+	if (len < 0)
+		len = 0;
+	*eof = (len <= count) ? 1 : 0;
+	*start = page + off;
+	return len;
+}
+
+static int latency_write_proc(struct file *file, const char *buffer,
+			      unsigned long count, void *data)
+{
+	spin_lock_irq(&runqueue_lock);
+	memset(&lat_max, 0, sizeof(lat_max));
+	spin_unlock_irq(&runqueue_lock);
+	return count;
+}
+
+static int __init latency_proc_init(void)
+{
+	struct proc_dir_entry *ent;
+
+	ent = create_proc_entry("latency", S_IWUSR | S_IRUGO, NULL);
+	if (ent) {
+		ent->read_proc = latency_read_proc;
+		ent->write_proc = latency_write_proc;
+	}
+	return 0;
+}
+
+__initcall(latency_proc_init);
+#else
+#define lat_mark(p)		do { } while (0)
+#define lat_stop(from)		do { } while (0)
+#endif
+
 /*
  * This is the function that decides how desirable a process is..
  * You can weigh different processes against each other depending
@@ -310,11 +569,19 @@ send_now_idle:
 	struct task_struct *tsk;
 
 	tsk = cpu_curr(this_cpu);
-	if (preemption_goodness(tsk, p, this_cpu) > 0)
+#ifdef CONFIG_SCHED_PRIO_ARRAY
+	/* an expired task won't be picked before the arrays swap */
+	if (p->array != active)
+		return;
+#endif
+	if (preemption_goodness(tsk, p, this_cpu) > 0) {
 		tsk->need_resched = 1;
+		lat_mark(p);
+	}
 #endif
 }
 
+#ifndef CONFIG_SCHED_PRIO_ARRAY
 /*
  * Careful!
  *
@@ -339,6 +606,7 @@ static inline void move_first_runqueue(struct task_struct * p)
 	list_del(&p->run_list);
 	list_add(&p->run_list, &runqueue_head);
 }
+#endif
 
 /*
  * Wake up a process. Put it on the run-queue if it's not
@@ -549,9 +817,13 @@ asmlinkage void schedule_tail(struct task_struct *prev)
 asmlinkage void schedule(void)
 {
 	struct schedule_data * sched_data;
-	struct task_struct *prev, *next, *p;
+	struct task_struct *prev, *next;
+#ifndef CONFIG_SCHED_PRIO_ARRAY
+	struct task_struct *p;
 	struct list_head *tmp;
-	int this_cpu, c;
+	int c;
+#endif
+	int this_cpu;
 
 
 	spin_lock_prefetch(&runqueue_lock);
@@ -599,6 +871,10 @@ need_resched_back:
 	 * this is the scheduler proper:
 	 */
 
+#ifdef CONFIG_SCHED_PRIO_ARRAY
+	requeue_prev(prev);
+	next = pick_next_task(this_cpu);
+#else
 repeat_schedule:
 	/*
 	 * Default process to select..
@@ -626,6 +902,7 @@ repeat_schedule:
 		spin_lock_irq(&runqueue_lock);
 		goto repeat_schedule;
 	}
+#endif
 
 	/*
 	 * from this point on nothing can prevent us from
@@ -634,6 +911,7 @@ repeat_schedule:
 	 */
 	sched_data->curr = next;
 	task_set_cpu(next, this_cpu);
+	lat_stop(__builtin_return_address(0));
 	spin_unlock_irq(&runqueue_lock);
 
 	if (unlikely(prev == next)) {
@@ -727,6 +1005,12 @@ static inline void __wake_up_common (wait_queue_head_t *q, unsigned int mode,
                 wait_queue_t *curr = list_entry(tmp, wait_queue_t, task_list);
 
 		CHECK_MAGIC(curr->__magic);
+		if (unlikely(curr->func != NULL)) {
+			if (curr->func(curr, mode, sync) &&
+			    (curr->flags&WQ_FLAG_EXCLUSIVE) && !--nr_exclusive)
+				break;
+			continue;
+		}
 		p = curr->task;
 		state = p->state;
 		if (state & mode) {
@@ -1326,6 +1610,9 @@ void __init sched_init(void)
 	int nr;
 
 	init_task.processor = cpu;
+#ifdef CONFIG_SCHED_PRIO_ARRAY
+	init_prio_arrays();
+#endif
 
 	for(nr = 0; nr < PIDHASH_SZ; nr++)
 		pidhash[nr] = NULL;
@@ -678,6 +678,9 @@ void do_timer(struct pt_regs *regs)
 	/* SMP process accounting uses the local APIC timer */
 
 	update_process_times(user_mode(regs));
+#endif
+#ifdef CONFIG_LOLAT_TRACE
+	lat_tick(regs);
 #endif
 	mark_bh(TIMER_BH);
 	if (TQ_ACTIVE(tq_timer))
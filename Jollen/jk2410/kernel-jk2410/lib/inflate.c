@@ -225,6 +225,20 @@ STATIC const ush mask_bits[] = {
 #define NEEDBITS(n) {while(k<(n)){b|=((ulg)NEXTBYTE())<<k;k+=8;}}
 #define DUMPBITS(n) {b>>=(n);k-=(n);}
 
+/* Top the bit buffer up to more than 24 bits straight from inbuf while at
+   least four input bytes are buffered, so that the common literal/length
+   and distance decodes find their bits without going through get_byte()
+   for every byte.  The extra lookahead is undone at the end of inflate()
+   like any other.  Only includers that keep an inbuf/inptr/insize input
+   buffer can do this; they say so with INFLATE_HAVE_INSIZE, the others
+   go byte by byte through NEEDBITS as before. */
+#ifdef INFLATE_HAVE_INSIZE
+#define FILLBITS() {if(k<=24&&inptr+4<=insize)\
+  do{b|=((ulg)inbuf[inptr++])<<k;k+=8;}while(k<=24);}
+#else
+#define FILLBITS()
+#endif
+
 
 /*
    Huffman code decoding is performed using a multi-level table lookup.
@@ -535,6 +549,7 @@ int bl, bd;             /* number of bits decoded by tl[] and td[] */
   md = mask_bits[bd];
   for (;;)                      /* do until end of block */
   {
+    FILLBITS()
     NEEDBITS((unsigned)bl)
     if ((e = (t = tl + ((unsigned)b & ml))->e) > 16)
       do {
@@ -567,6 +582,7 @@ int bl, bd;             /* number of bits decoded by tl[] and td[] */
       DUMPBITS(e);
 
       /* decode distance of block to copy */
+      FILLBITS()
       NEEDBITS((unsigned)bd)
       if ((e = (t = td + ((unsigned)b & md))->e) > 16)
         do {
@@ -1008,6 +1024,7 @@ STATIC int inflate()
  **********************************************************************/
 
 static ulg crc_32_tab[256];
+static ulg crc_32_tab_w[3][256];	/* crc_32_tab[] followed by 1..3 zero bytes */
 static ulg crc;		/* initialized in makecrc() so it'll reside in bss */
 #define CRC_VALUE (crc ^ 0xffffffffL)
 
@@ -1048,10 +1065,47 @@ makecrc(void)
     crc_32_tab[i] = c;
   }
 
+  /* tables for updcrc() to fold in four bytes with four lookups */
+  for (i = 0; i < 256; i++)
+  {
+    c = crc_32_tab[i];
+    for (k = 0; k < 3; k++)
+    {
+      c = crc_32_tab[c & 0xff] ^ (c >> 8);
+      crc_32_tab_w[k][i] = c;
+    }
+  }
+
   /* this is initialized here so this code could reside in ROM */
   crc = (ulg)0xffffffffL; /* shift register contents */
 }
 
+/*
+ * Run n bytes at s through the crc, a 32-bit word at a time once s is
+ * aligned.  The word is assembled from bytes so this does not depend on
+ * the byte order of the machine.
+ */
+static inline void
+updcrc(uch *s, unsigned n)
+{
+  register ulg c = crc;
+
+  for (; n && ((unsigned long)s & 3); n--)
+    c = crc_32_tab[((int)c ^ *s++) & 0xff] ^ (c >> 8);
+
+  for (; n >= 4; n -= 4, s += 4)
+  {
+    c ^= (ulg)s[0] | ((ulg)s[1] << 8) | ((ulg)s[2] << 16) | ((ulg)s[3] << 24);
+    c = crc_32_tab_w[2][c & 0xff] ^ crc_32_tab_w[1][(c >> 8) & 0xff] ^
+        crc_32_tab_w[0][(c >> 16) & 0xff] ^ crc_32_tab[c >> 24];
+  }
+
+  for (; n; n--)
+    c = crc_32_tab[((int)c ^ *s++) & 0xff] ^ (c >> 8);
+
+  crc = c;
+}
+
 /* gzip flag byte */
 #define ASCII_FLAG   0x01 /* bit 0 set: file probably ASCII text */
 #define CONTINUATION 0x02 /* bit 1 set: continuation of multi-part gzip file */
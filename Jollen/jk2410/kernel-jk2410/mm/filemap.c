@@ -24,6 +24,7 @@
 #include <linux/mm.h>
 #include <linux/iobuf.h>
 #include <linux/compiler.h>
+#include <linux/fadvise.h>
 
 #include <asm/pgalloc.h>
 #include <asm/uaccess.h>
@@ -164,20 +165,18 @@ void set_page_dirty(struct page *page)
 	}
 }
 
-/**
- * invalidate_inode_pages - Invalidate all the unlocked pages of one inode
- * @inode: the inode which pages we want to invalidate
- *
- * This function only removes the unlocked pages, if you want to
- * remove all the pages of one inode, you must call truncate_inode_pages.
+/*
+ * Drop the clean, unmapped, unlocked pages of [start, end) from the page
+ * cache.  posix_fadvise(POSIX_FADV_DONTNEED) uses it for a range,
+ * invalidate_inode_pages() for the whole file.
  */
-
-void invalidate_inode_pages(struct inode * inode)
+static void invalidate_inode_pages_range(struct address_space * mapping,
+	unsigned long start, unsigned long end)
 {
 	struct list_head *head, *curr;
 	struct page * page;
 
-	head = &inode->i_mapping->clean_pages;
+	head = &mapping->clean_pages;
 
 	spin_lock(&pagemap_lru_lock);
 	spin_lock(&pagecache_lock);
@@ -187,6 +186,9 @@ void invalidate_inode_pages(struct inode * inode)
 		page = list_entry(curr, struct page, list);
 		curr = curr->next;
 
+		if (page->index < start || page->index >= end)
+			continue;
+
 		/* We cannot invalidate something in dirty.. */
 		if (PageDirty(page))
 			continue;
@@ -215,6 +217,19 @@ unlock:
 	spin_unlock(&pagemap_lru_lock);
 }
 
+/**
+ * invalidate_inode_pages - Invalidate all the unlocked pages of one inode
+ * @inode: the inode which pages we want to invalidate
+ *
+ * This function only removes the unlocked pages, if you want to
+ * remove all the pages of one inode, you must call truncate_inode_pages.
+ */
+
+void invalidate_inode_pages(struct inode * inode)
+{
+	invalidate_inode_pages_range(inode->i_mapping, 0, ~0UL);
+}
+
 static int do_flushpage(struct page *page, unsigned long offset)
 {
 	int (*flushpage) (struct page *, unsigned long);
@@ -706,7 +721,7 @@ static int page_cache_read(struct file * file, unsigned long offset)
 	if (page)
 		return 0;
 
-	page = page_cache_alloc(mapping);
+	page = page_cache_alloc_cold(mapping);
 	if (!page)
 		return -ENOMEM;
 
@@ -1068,6 +1083,12 @@ static void profile_readahead(int async, struct file *filp)
  *			f_rawin = f_ralen
  *		otherwise (was asynchronous)
  *			f_rawin = previous value of f_ralen + f_ralen
+ * - f_ranext: page index the last read() stopped in.  A read starting
+ *	       there continues the stream even when it falls outside the
+ *	       window, so the window is kept instead of collapsed.
+ * - f_raadvice: posix_fadvise() policy.  RANDOM disables read-ahead,
+ *	       SEQUENTIAL starts with the full window, never collapses it
+ *	       and allows twice the usual maximum.
  *
  * Read-ahead limits:
  * ------------------
@@ -1118,6 +1139,16 @@ static inline int get_max_readahead(struct inode * inode)
 	return max_readahead[MAJOR(inode->i_dev)][MINOR(inode->i_dev)];
 }
 
+/* A file advised POSIX_FADV_SEQUENTIAL may read ahead twice as far */
+static inline int get_file_max_readahead(struct file * filp, struct inode * inode)
+{
+	int max = get_max_readahead(inode);
+
+	if (filp->f_raadvice == POSIX_FADV_SEQUENTIAL)
+		max += max;
+	return max;
+}
+
 static void generic_file_readahead(int reada_ok,
 	struct file * filp, struct inode * inode,
 	struct page * page)
@@ -1126,7 +1157,7 @@ static void generic_file_readahead(int reada_ok,
 	unsigned long index = page->index;
 	unsigned long max_ahead, ahead;
 	unsigned long raend;
-	int max_readahead = get_max_readahead(inode);
+	int max_readahead = get_file_max_readahead(filp, inode);
 
 	end_index = inode->i_size >> PAGE_CACHE_SHIFT;
 
@@ -1258,7 +1289,8 @@ void do_generic_file_read(struct file * filp, loff_t *ppos, read_descriptor_t *
 	struct page *cached_page;
 	int reada_ok;
 	int error;
-	int max_readahead = get_max_readahead(inode);
+	int max_readahead = get_file_max_readahead(filp, inode);
+	int advice = filp->f_raadvice;
 
 	cached_page = NULL;
 	index = *ppos >> PAGE_CACHE_SHIFT;
@@ -1266,28 +1298,46 @@ void do_generic_file_read(struct file * filp, loff_t *ppos, read_descriptor_t *
 
 /*
  * If the current position is outside the previous read-ahead window, 
- * we reset the current read-ahead context and set read ahead max to zero
- * (will be set to just needed value later),
- * otherwise, we assume that the file accesses are sequential enough to
+ * and does not continue where the last read stopped, we reset the current
+ * read-ahead context and set read ahead max to zero (will be set to just
+ * needed value later). A read that continues the stream only restarts
+ * the window and keeps its size.
+ * Otherwise, we assume that the file accesses are sequential enough to
  * continue read-ahead.
  */
-	if (index > filp->f_raend || index + filp->f_rawin < filp->f_raend) {
+	if (advice == POSIX_FADV_RANDOM) {
 		reada_ok = 0;
 		filp->f_raend = 0;
 		filp->f_ralen = 0;
 		filp->f_ramax = 0;
 		filp->f_rawin = 0;
+	} else if (index > filp->f_raend || index + filp->f_rawin < filp->f_raend) {
+		if (index == filp->f_ranext || advice == POSIX_FADV_SEQUENTIAL) {
+			reada_ok = 1;
+		} else {
+			reada_ok = 0;
+			filp->f_ramax = 0;
+		}
+		filp->f_raend = 0;
+		filp->f_ralen = 0;
+		filp->f_rawin = 0;
 	} else {
 		reada_ok = 1;
 	}
 /*
  * Adjust the current value of read-ahead max.
+ * With POSIX_FADV_RANDOM, only read what was asked for.
+ * With POSIX_FADV_SEQUENTIAL, open the whole window at once.
  * If the read operation stay in the first half page, force no readahead.
  * Otherwise try to increase read ahead max just enough to do the read request.
  * Then, at least MIN_READAHEAD if read ahead is ok,
  * and at most MAX_READAHEAD in all cases.
  */
-	if (!index && offset + desc->count <= (PAGE_CACHE_SIZE >> 1)) {
+	if (advice == POSIX_FADV_RANDOM) {
+		filp->f_ramax = 0;
+	} else if (advice == POSIX_FADV_SEQUENTIAL) {
+		filp->f_ramax = max_readahead;
+	} else if (!index && offset + desc->count <= (PAGE_CACHE_SIZE >> 1)) {
 		filp->f_ramax = 0;
 	} else {
 		unsigned long needed;
@@ -1307,6 +1357,8 @@ void do_generic_file_read(struct file * filp, loff_t *ppos, read_descriptor_t *
 		struct page *page, **hash;
 		unsigned long end_index, nr, ret;
 
+		conditional_schedule();
+
 		end_index = inode->i_size >> PAGE_CACHE_SHIFT;
 			
 		if (index > end_index)
@@ -1456,6 +1508,7 @@ no_cached_page:
 
 	*ppos = ((loff_t) index << PAGE_CACHE_SHIFT) + offset;
 	filp->f_reada = 1;
+	filp->f_ranext = index;
 	if (cached_page)
 		page_cache_release(cached_page);
 	UPDATE_ATIME(inode);
@@ -1780,6 +1833,72 @@ asmlinkage ssize_t sys_readahead(int fd, loff_t offset, size_t count)
 	return ret;
 }
 
+/*
+ * The posix_fadvise(2) system call.  NORMAL, RANDOM and SEQUENTIAL set
+ * the read-ahead policy of this open file (see do_generic_file_read),
+ * WILLNEED starts reading the range like readahead(2), DONTNEED drops
+ * whatever of it can be dropped without I/O.  A len of 0 means up to
+ * the end of the file.
+ */
+asmlinkage long sys_fadvise64(int fd, loff_t offset, size_t len, int advice)
+{
+	struct file *file;
+	struct address_space *mapping;
+	unsigned long start, end;
+	long ret;
+
+	ret = -EBADF;
+	file = fget(fd);
+	if (!file)
+		goto out;
+
+	ret = -ESPIPE;
+	if (S_ISFIFO(file->f_dentry->d_inode->i_mode))
+		goto out_fput;
+
+	ret = -EINVAL;
+	mapping = file->f_dentry->d_inode->i_mapping;
+	if (!mapping || !mapping->a_ops || !mapping->a_ops->readpage)
+		goto out_fput;
+	if (offset < 0)
+		goto out_fput;
+
+	start = offset >> PAGE_CACHE_SHIFT;
+	if (len == 0)
+		end = ~0UL;
+	else
+		end = (offset + len + PAGE_CACHE_SIZE - 1) >> PAGE_CACHE_SHIFT;
+
+	ret = 0;
+	switch (advice) {
+	case POSIX_FADV_NORMAL:
+	case POSIX_FADV_RANDOM:
+	case POSIX_FADV_SEQUENTIAL:
+		file->f_raadvice = advice;
+		/* let the next read pick a window for the new policy */
+		file->f_raend = 0;
+		file->f_ralen = 0;
+		file->f_ramax = 0;
+		file->f_rawin = 0;
+		break;
+	case POSIX_FADV_WILLNEED:
+		ret = do_readahead(file, start, end - start);
+		run_task_queue(&tq_disk);
+		break;
+	case POSIX_FADV_DONTNEED:
+		invalidate_inode_pages_range(mapping, start, end);
+		break;
+	case POSIX_FADV_NOREUSE:
+		break;
+	default:
+		ret = -EINVAL;
+	}
+out_fput:
+	fput(file);
+out:
+	return ret;
+}
+
 /*
  * Read-ahead and flush behind for MADV_SEQUENTIAL areas.  Since we are
  * sure this is sequential access, we don't need a flexible read-ahead
@@ -2966,6 +3085,8 @@ generic_file_write(struct file *file,const char *buf,size_t count, loff_t *ppos)
 		long page_fault;
 		char *kaddr;
 
+		conditional_schedule();
+
 		/*
 		 * Try to find the page in the cache. If it isn't there,
 		 * allocate a free page.
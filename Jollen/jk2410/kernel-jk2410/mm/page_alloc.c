@@ -18,6 +18,8 @@
 #include <linux/bootmem.h>
 #include <linux/slab.h>
 #include <linux/compiler.h>
+#include <linux/smp.h>
+#include <linux/proc_fs.h>
 
 int nr_swap_pages;
 int nr_active_pages;
@@ -51,6 +53,19 @@ static int zone_balance_max[MAX_NR_ZONES] __initdata = { 255 , 255, 255, };
 #define memlist_next(x) ((x)->next)
 #define memlist_prev(x) ((x)->prev)
 
+/*
+ * Order-0 traffic through the per-CPU lists, see /proc/pagealloc_stats.
+ * Updated with interrupts disabled, so exact on UP.
+ */
+static struct pagealloc_stats {
+	unsigned long pcp_alloc[2];	/* served from the hot/cold list */
+	unsigned long pcp_free[2];	/* freed to the hot/cold list */
+	unsigned long buddy_alloc;	/* allocations from the buddy lists */
+	unsigned long buddy_free;	/* frees to the buddy lists */
+	unsigned long refill;		/* batches taken from the buddy lists */
+	unsigned long drain;		/* batches given back */
+} pagealloc_stats;
+
 /*
  * Temporary debugging check.
  */
@@ -62,20 +77,8 @@ static int zone_balance_max[MAX_NR_ZONES] __initdata = { 255 , 255, 255, };
  * Hint: -mask = 1+~mask
  */
 
-static void FASTCALL(__free_pages_ok (struct page *page, unsigned int order));
-static void __free_pages_ok (struct page *page, unsigned int order)
+static inline void free_pages_check(struct page *page)
 {
-	unsigned long index, page_idx, mask, flags;
-	free_area_t *area;
-	struct page *base;
-	zone_t *zone;
-
-	/* Yes, think what happens when other parts of the kernel take 
-	 * a reference to a page in order to pin it for io. -ben
-	 */
-	if (PageLRU(page))
-		lru_cache_del(page);
-
 	if (page->buffers)
 		BUG();
 	if (page->mapping)
@@ -91,12 +94,17 @@ static void __free_pages_ok (struct page *page, unsigned int order)
 	if (PageActive(page))
 		BUG();
 	page->flags &= ~((1<<PG_referenced) | (1<<PG_dirty));
+}
 
-	if (current->flags & PF_FREE_PAGES)
-		goto local_freelist;
- back_local_freelist:
-
-	zone = page->zone;
+/*
+ * Give a block back to the buddy lists, merging it with its free
+ * buddies.  Called with zone->lock held.
+ */
+static inline void __free_one_page(struct page *page, zone_t *zone, unsigned int order)
+{
+	unsigned long index, page_idx, mask;
+	free_area_t *area;
+	struct page *base;
 
 	mask = (~0UL) << order;
 	base = zone->zone_mem_map;
@@ -107,8 +115,6 @@ static void __free_pages_ok (struct page *page, unsigned int order)
 
 	area = zone->free_area + order;
 
-	spin_lock_irqsave(&zone->lock, flags);
-
 	zone->free_pages -= mask;
 
 	while (mask + (1 << (MAX_ORDER-1))) {
@@ -138,7 +144,31 @@ static void __free_pages_ok (struct page *page, unsigned int order)
 		page_idx &= mask;
 	}
 	memlist_add_head(&(base + page_idx)->list, &area->free_list);
+}
+
+static void FASTCALL(__free_pages_ok (struct page *page, unsigned int order));
+static void __free_pages_ok (struct page *page, unsigned int order)
+{
+	unsigned long flags;
+	zone_t *zone;
+
+	/* Yes, think what happens when other parts of the kernel take 
+	 * a reference to a page in order to pin it for io. -ben
+	 */
+	if (PageLRU(page))
+		lru_cache_del(page);
 
+	free_pages_check(page);
+
+	if (current->flags & PF_FREE_PAGES)
+		goto local_freelist;
+ back_local_freelist:
+
+	zone = page->zone;
+
+	spin_lock_irqsave(&zone->lock, flags);
+	__free_one_page(page, zone, order);
+	pagealloc_stats.buddy_free++;
 	spin_unlock_irqrestore(&zone->lock, flags);
 	return;
 
@@ -153,6 +183,88 @@ static void __free_pages_ok (struct page *page, unsigned int order)
 	current->nr_local_pages++;
 }
 
+/*
+ * Move up to count pages from the tail (the least recently freed end)
+ * of a per-CPU list back to the buddy lists.  Interrupts are disabled.
+ */
+static int free_pages_bulk(zone_t *zone, int count, struct list_head *list)
+{
+	struct page *page;
+	int freed = 0;
+
+	spin_lock(&zone->lock);
+	while (freed < count && !list_empty(list)) {
+		page = memlist_entry(memlist_prev(list), struct page, list);
+		memlist_del(&page->list);
+		__free_one_page(page, zone, 0);
+		freed++;
+	}
+	spin_unlock(&zone->lock);
+	return freed;
+}
+
+static void free_hot_cold_page(struct page *page, int cold)
+{
+	struct per_cpu_pages *pcp;
+	zone_t *zone = page->zone;
+	unsigned long flags;
+
+	/* try_to_free_pages() wants to see the page on local_pages */
+	if (current->flags & PF_FREE_PAGES) {
+		__free_pages_ok(page, 0);
+		return;
+	}
+
+	if (PageLRU(page))
+		lru_cache_del(page);
+
+	free_pages_check(page);
+
+	local_irq_save(flags);
+	pcp = &zone->pageset[smp_processor_id()].pcp[cold];
+	if (pcp->count >= pcp->high) {
+		pcp->count -= free_pages_bulk(zone, pcp->batch, &pcp->list);
+		pagealloc_stats.drain++;
+	}
+	memlist_add_head(&page->list, &pcp->list);
+	pcp->count++;
+	pagealloc_stats.pcp_free[cold]++;
+	local_irq_restore(flags);
+}
+
+/*
+ * Give this CPU's order-0 lists back to the buddy lists, so that the
+ * pages count as free_pages again and can merge into larger blocks.
+ * Returns the number of pages moved.
+ */
+static int drain_local_pages(void)
+{
+	pg_data_t *pgdat;
+	unsigned long flags;
+	int i, drained = 0;
+
+	local_irq_save(flags);
+	for (pgdat = pgdat_list; pgdat; pgdat = pgdat->node_next) {
+		zone_t *zone;
+
+		for (zone = pgdat->node_zones; zone < pgdat->node_zones + MAX_NR_ZONES; zone++) {
+			struct per_cpu_pages *pcp;
+
+			if (!zone->size)
+				continue;
+			pcp = zone->pageset[smp_processor_id()].pcp;
+			for (i = 0; i < 2; i++) {
+				int freed = free_pages_bulk(zone, pcp[i].count, &pcp[i].list);
+
+				pcp[i].count -= freed;
+				drained += freed;
+			}
+		}
+	}
+	local_irq_restore(flags);
+	return drained;
+}
+
 #define MARK_USED(index, order, area) \
 	__change_bit((index) >> (1+(order)), (area)->map)
 
@@ -177,16 +289,14 @@ static inline struct page * expand (zone_t *zone, struct page *page,
 	return page;
 }
 
-static FASTCALL(struct page * rmqueue(zone_t *zone, unsigned int order));
-static struct page * rmqueue(zone_t *zone, unsigned int order)
+/* Called with zone->lock held */
+static struct page * __rmqueue(zone_t *zone, unsigned int order)
 {
 	free_area_t * area = zone->free_area + order;
 	unsigned int curr_order = order;
 	struct list_head *head, *curr;
-	unsigned long flags;
 	struct page *page;
 
-	spin_lock_irqsave(&zone->lock, flags);
 	do {
 		head = &area->free_list;
 		curr = memlist_next(head);
@@ -203,26 +313,91 @@ static struct page * rmqueue(zone_t *zone, unsigned int order)
 				MARK_USED(index, curr_order, area);
 			zone->free_pages -= 1UL << order;
 
-			page = expand(zone, page, index, order, curr_order, area);
-			spin_unlock_irqrestore(&zone->lock, flags);
-
-			set_page_count(page, 1);
-			if (BAD_RANGE(zone,page))
-				BUG();
-			if (PageLRU(page))
-				BUG();
-			if (PageActive(page))
-				BUG();
-			return page;	
+			return expand(zone, page, index, order, curr_order, area);
 		}
 		curr_order++;
 		area++;
 	} while (curr_order < MAX_ORDER);
-	spin_unlock_irqrestore(&zone->lock, flags);
 
 	return NULL;
 }
 
+/*
+ * Move up to count order-0 pages from the buddy lists to the tail of
+ * a per-CPU list.  Interrupts are disabled.
+ */
+static int rmqueue_bulk(zone_t *zone, int count, struct list_head *list)
+{
+	struct page *page;
+	int allocated = 0;
+
+	spin_lock(&zone->lock);
+	while (allocated < count) {
+		page = __rmqueue(zone, 0);
+		if (!page)
+			break;
+		memlist_add_tail(&page->list, list);
+		allocated++;
+	}
+	spin_unlock(&zone->lock);
+	return allocated;
+}
+
+/*
+ * Order-0 requests are served from the per-CPU list, hot or cold as
+ * the caller asked, refilled a batch at a time.  Should the buddy lists
+ * have nothing left for a refill, the other list is tried.
+ */
+static FASTCALL(struct page * rmqueue(zone_t *zone, unsigned int order, unsigned int gfp_mask));
+static struct page * rmqueue(zone_t *zone, unsigned int order, unsigned int gfp_mask)
+{
+	struct page *page = NULL;
+	unsigned long flags;
+
+	if (order == 0) {
+		struct per_cpu_pages *pcp;
+		int cold = (gfp_mask & __GFP_COLD) != 0;
+
+		local_irq_save(flags);
+		pcp = zone->pageset[smp_processor_id()].pcp;
+		if (pcp[cold].count <= pcp[cold].low) {
+			int got = rmqueue_bulk(zone, pcp[cold].batch, &pcp[cold].list);
+
+			pcp[cold].count += got;
+			if (got)
+				pagealloc_stats.refill++;
+		}
+		if (!pcp[cold].count)
+			cold = !cold;
+		if (pcp[cold].count) {
+			page = memlist_entry(memlist_next(&pcp[cold].list), struct page, list);
+			memlist_del(&page->list);
+			pcp[cold].count--;
+			pagealloc_stats.pcp_alloc[cold]++;
+		}
+		local_irq_restore(flags);
+	}
+
+	if (!page) {
+		spin_lock_irqsave(&zone->lock, flags);
+		page = __rmqueue(zone, order);
+		if (page)
+			pagealloc_stats.buddy_alloc++;
+		spin_unlock_irqrestore(&zone->lock, flags);
+		if (!page)
+			return NULL;
+	}
+
+	set_page_count(page, 1);
+	if (BAD_RANGE(zone,page))
+		BUG();
+	if (PageLRU(page))
+		BUG();
+	if (PageActive(page))
+		BUG();
+	return page;
+}
+
 #ifndef CONFIG_DISCONTIGMEM
 struct page *_alloc_pages(unsigned int gfp_mask, unsigned int order)
 {
@@ -313,7 +488,7 @@ struct page * __alloc_pages(unsigned int gfp_mask, unsigned int order, zonelist_
 	unsigned long min;
 	zone_t **zone, * classzone;
 	struct page * page;
-	int freed;
+	int freed, drained = 0;
 
 	zone = zonelist->zones;
 	classzone = *zone;
@@ -325,7 +500,7 @@ struct page * __alloc_pages(unsigned int gfp_mask, unsigned int order, zonelist_
 
 		min += z->pages_low;
 		if (z->free_pages > min) {
-			page = rmqueue(z, order);
+			page = rmqueue(z, order, gfp_mask);
 			if (page)
 				return page;
 		}
@@ -336,6 +511,7 @@ struct page * __alloc_pages(unsigned int gfp_mask, unsigned int order, zonelist_
 	if (waitqueue_active(&kswapd_wait))
 		wake_up_interruptible(&kswapd_wait);
 
+again:
 	zone = zonelist->zones;
 	min = 1UL << order;
 	for (;;) {
@@ -349,7 +525,7 @@ struct page * __alloc_pages(unsigned int gfp_mask, unsigned int order, zonelist_
 			local_min >>= 2;
 		min += local_min;
 		if (z->free_pages > min) {
-			page = rmqueue(z, order);
+			page = rmqueue(z, order, gfp_mask);
 			if (page)
 				return page;
 		}
@@ -357,6 +533,13 @@ struct page * __alloc_pages(unsigned int gfp_mask, unsigned int order, zonelist_
 
 	/* here we're in the low on memory slow path */
 
+	/* pages on the per-CPU lists are free too: give them back first */
+	if (!drained) {
+		drained = 1;
+		if (drain_local_pages())
+			goto again;
+	}
+
 rebalance:
 	if (current->flags & (PF_MEMALLOC | PF_MEMDIE)) {
 		zone = zonelist->zones;
@@ -365,7 +548,7 @@ rebalance:
 			if (!z)
 				break;
 
-			page = rmqueue(z, order);
+			page = rmqueue(z, order, gfp_mask);
 			if (page)
 				return page;
 		}
@@ -389,7 +572,7 @@ rebalance:
 
 		min += z->pages_min;
 		if (z->free_pages > min) {
-			page = rmqueue(z, order);
+			page = rmqueue(z, order, gfp_mask);
 			if (page)
 				return page;
 		}
@@ -433,9 +616,20 @@ unsigned long get_zeroed_page(unsigned int gfp_mask)
 }
 
 void __free_pages(struct page *page, unsigned int order)
+{
+	if (!PageReserved(page) && put_page_testzero(page)) {
+		if (order == 0)
+			free_hot_cold_page(page, 0);
+		else
+			__free_pages_ok(page, order);
+	}
+}
+
+/* Like __free_page(), for a page that has not been touched recently */
+void free_cold_page(struct page *page)
 {
 	if (!PageReserved(page) && put_page_testzero(page))
-		__free_pages_ok(page, order);
+		free_hot_cold_page(page, 1);
 }
 
 void free_pages(unsigned long addr, unsigned int order)
@@ -444,6 +638,17 @@ void free_pages(unsigned long addr, unsigned int order)
 		__free_pages(virt_to_page(addr), order);
 }
 
+static unsigned long zone_pcp_pages(zone_t *zone)
+{
+	unsigned long sum = 0;
+	int cpu;
+
+	for (cpu = 0; cpu < smp_num_cpus; cpu++)
+		sum += zone->pageset[cpu].pcp[0].count +
+			zone->pageset[cpu].pcp[1].count;
+	return sum;
+}
+
 /*
  * Total amount of free (allocatable) RAM:
  */
@@ -456,7 +661,7 @@ unsigned int nr_free_pages (void)
 	sum = 0;
 	while (pgdat) {
 		for (zone = pgdat->node_zones; zone < pgdat->node_zones + MAX_NR_ZONES; zone++)
-			sum += zone->free_pages;
+			sum += zone->free_pages + zone_pcp_pages(zone);
 		pgdat = pgdat->node_next;
 	}
 	return sum;
@@ -623,6 +828,39 @@ static inline void build_zonelists(pg_data_t *pgdat)
 	} 
 }
 
+/*
+ * Batches of about a thousandth of the zone, 1 to 16 pages.  The hot
+ * list is kept between 2 and 6 batches; the cold list is only refilled
+ * when empty and holds at most 2 batches, so cold frees soon reach the
+ * buddy lists.
+ */
+static void __init zone_pcp_init(zone_t *zone, unsigned long size)
+{
+	int cpu, batch;
+
+	batch = size / 1024;
+	if (batch < 1)
+		batch = 1;
+	if (batch > 16)
+		batch = 16;
+
+	for (cpu = 0; cpu < NR_CPUS; cpu++) {
+		struct per_cpu_pages *pcp = zone->pageset[cpu].pcp;
+
+		pcp[0].count = 0;
+		pcp[0].low = 2 * batch;
+		pcp[0].high = 6 * batch;
+		pcp[0].batch = batch;
+		INIT_LIST_HEAD(&pcp[0].list);
+
+		pcp[1].count = 0;
+		pcp[1].low = 0;
+		pcp[1].high = 2 * batch;
+		pcp[1].batch = batch;
+		INIT_LIST_HEAD(&pcp[1].list);
+	}
+}
+
 #define LONG_ALIGN(x) (((x)+(sizeof(long))-1)&~((sizeof(long))-1))
 
 /*
@@ -707,6 +945,7 @@ void __init free_area_init_core(int nid, pg_data_t *pgdat, struct page **gmap,
 		zone->zone_pgdat = pgdat;
 		zone->free_pages = 0;
 		zone->need_balance = 0;
+		zone_pcp_init(zone, realsize);
 		if (!size)
 			continue;
 
@@ -795,3 +1034,77 @@ static int __init setup_mem_frac(char *str)
 }
 
 __setup("memfrac=", setup_mem_frac);
+
+#ifdef CONFIG_PROC_FS
+static int pagealloc_stats_read_proc(char *page, char **start, off_t off,
+				     int count, int *eof, void *data)
+{
+	struct pagealloc_stats s;
+	pg_data_t *pgdat;
+	unsigned long flags;
+	char *p = page;
+	int cpu, len;
+
+	local_irq_save(flags);
+	s = pagealloc_stats;
+	local_irq_restore(flags);
+
+	p += sprintf(p, "hot alloc:    %lu\n", s.pcp_alloc[0]);
+	p += sprintf(p, "cold alloc:   %lu\n", s.pcp_alloc[1]);
+	p += sprintf(p, "hot free:     %lu\n", s.pcp_free[0]);
+	p += sprintf(p, "cold free:    %lu\n", s.pcp_free[1]);
+	p += sprintf(p, "buddy alloc:  %lu\n", s.buddy_alloc);
+	p += sprintf(p, "buddy free:   %lu\n", s.buddy_free);
+	p += sprintf(p, "refills:      %lu\n", s.refill);
+	p += sprintf(p, "drains:       %lu\n", s.drain);
+
+	for (pgdat = pgdat_list; pgdat; pgdat = pgdat->node_next) {
+		zone_t *zone;
+
+		for (zone = pgdat->node_zones; zone < pgdat->node_zones + MAX_NR_ZONES; zone++) {
+			if (!zone->size)
+				continue;
+			for (cpu = 0; cpu < smp_num_cpus; cpu++) {
+				struct per_cpu_pages *pcp = zone->pageset[cpu].pcp;
+
+				p += sprintf(p, "%-8s cpu%d hot %3d (%d-%d) cold %3d (-%d) batch %d\n",
+					     zone->name, cpu,
+					     pcp[0].count, pcp[0].low, pcp[0].high,
+					     pcp[1].count, pcp[1].high, pcp[0].batch);
+			}
+		}
+	}
+
+	len = (p - page) - off;
+	if (len < 0)
+		len = 0;
+	*eof = (len <= count) ? 1 : 0;
+	*start = page + off;
+	return len;
+}
+
+static int pagealloc_stats_write_proc(struct file *file, const char *buffer,
+				      unsigned long count, void *data)
+{
+	unsigned long flags;
+
+	local_irq_save(flags);
+	memset(&pagealloc_stats, 0, sizeof(pagealloc_stats));
+	local_irq_restore(flags);
+	return count;
+}
+
+static int __init pagealloc_stats_init(void)
+{
+	struct proc_dir_entry *ent;
+
+	ent = create_proc_entry("pagealloc_stats", S_IWUSR | S_IRUGO, NULL);
+	if (ent) {
+		ent->read_proc = pagealloc_stats_read_proc;
+		ent->write_proc = pagealloc_stats_write_proc;
+	}
+	return 0;
+}
+
+__initcall(pagealloc_stats_init);
+#endif
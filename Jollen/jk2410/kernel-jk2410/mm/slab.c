@@ -84,6 +84,11 @@
  *		  0 for faster, smaller code (especially in the critical paths).
  *
  * FORCED_DEBUG	- 1 enables SLAB_RED_ZONE and SLAB_POISON (if possible)
+ *
+ * SLAB_CPUCACHE - 1 puts a per-cpu LIFO array of objects (a "magazine")
+ *		  in front of the slab lists, refilled and drained in batches.
+ *		  Always on SMP; CONFIG_SLAB_MAGAZINE turns it on for UP, where
+ *		  it saves the slab list walk on most allocs and frees.
  */
 
 #ifdef CONFIG_DEBUG_SLAB
@@ -92,10 +97,20 @@
 #define	FORCED_DEBUG	1
 #else
 #define	DEBUG		0
+#ifdef CONFIG_SLAB_STATS
+#define	STATS		1
+#else
 #define	STATS		0
+#endif
 #define	FORCED_DEBUG	0
 #endif
 
+#if defined(CONFIG_SMP) || defined(CONFIG_SLAB_MAGAZINE)
+#define	SLAB_CPUCACHE	1
+#else
+#define	SLAB_CPUCACHE	0
+#endif
+
 /*
  * Parameters for kmem_cache_reap
  */
@@ -196,7 +211,7 @@ struct kmem_cache_s {
 	unsigned int	 	flags;	/* constant flags */
 	unsigned int		num;	/* # of objs per slab */
 	spinlock_t		spinlock;
-#ifdef CONFIG_SMP
+#if SLAB_CPUCACHE
 	unsigned int		batchcount;
 #endif
 
@@ -225,7 +240,7 @@ struct kmem_cache_s {
 /* 3) cache creation/removal */
 	char			name[CACHE_NAMELEN];
 	struct list_head	next;
-#ifdef CONFIG_SMP
+#if SLAB_CPUCACHE
 /* 4) per-cpu data */
 	cpucache_t		*cpudata[NR_CPUS];
 #endif
@@ -236,7 +251,15 @@ struct kmem_cache_s {
 	unsigned long		grown;
 	unsigned long		reaped;
 	unsigned long 		errors;
-#ifdef CONFIG_SMP
+	atomic_t		allocs;
+	atomic_t		frees;
+	/* rate snapshot for /proc/slabinfo, under the spinlock */
+	unsigned long		rate_stamp;
+	unsigned long		rate_allocs;
+	unsigned long		rate_frees;
+	unsigned long		alloc_rate;
+	unsigned long		free_rate;
+#if SLAB_CPUCACHE
 	atomic_t		allochit;
 	atomic_t		allocmiss;
 	atomic_t		freehit;
@@ -266,6 +289,21 @@ struct kmem_cache_s {
 					(x)->high_mark = (x)->num_active; \
 				} while (0)
 #define	STATS_INC_ERR(x)	((x)->errors++)
+#define	STATS_INC_ALLOC(x)	atomic_inc(&(x)->allocs)
+#define	STATS_INC_FREE(x)	atomic_inc(&(x)->frees)
+/* averaged over at least a second, so every read pass sees one value */
+#define	STATS_SET_RATES(x)	do { \
+		unsigned long allocs = atomic_read(&(x)->allocs); \
+		unsigned long frees = atomic_read(&(x)->frees); \
+		unsigned long delta = jiffies - (x)->rate_stamp; \
+		if (delta >= HZ) { \
+			(x)->alloc_rate = (allocs-(x)->rate_allocs)*HZ/delta; \
+			(x)->free_rate = (frees-(x)->rate_frees)*HZ/delta; \
+			(x)->rate_allocs = allocs; \
+			(x)->rate_frees = frees; \
+			(x)->rate_stamp = jiffies; \
+		} \
+	} while (0)
 #else
 #define	STATS_INC_ACTIVE(x)	do { } while (0)
 #define	STATS_DEC_ACTIVE(x)	do { } while (0)
@@ -274,9 +312,12 @@ struct kmem_cache_s {
 #define	STATS_INC_REAPED(x)	do { } while (0)
 #define	STATS_SET_HIGH(x)	do { } while (0)
 #define	STATS_INC_ERR(x)	do { } while (0)
+#define	STATS_INC_ALLOC(x)	do { } while (0)
+#define	STATS_INC_FREE(x)	do { } while (0)
+#define	STATS_SET_RATES(x)	do { } while (0)
 #endif
 
-#if STATS && defined(CONFIG_SMP)
+#if STATS && SLAB_CPUCACHE
 #define STATS_INC_ALLOCHIT(x)	atomic_inc(&(x)->allochit)
 #define STATS_INC_ALLOCMISS(x)	atomic_inc(&(x)->allocmiss)
 #define STATS_INC_FREEHIT(x)	atomic_inc(&(x)->freehit)
@@ -372,7 +413,7 @@ static kmem_cache_t *clock_searchp = &cache_cache;
 
 #define cache_chain (cache_cache.next)
 
-#ifdef CONFIG_SMP
+#if SLAB_CPUCACHE
 /*
  * chicken and egg problem: delay the per-cpu array allocation
  * until the general caches are up.
@@ -471,7 +512,7 @@ void __init kmem_cache_sizes_init(void)
 
 int __init kmem_cpucache_init(void)
 {
-#ifdef CONFIG_SMP
+#if SLAB_CPUCACHE
 	g_cpucache_up = 1;
 	enable_all_cpucaches();
 #endif
@@ -798,7 +839,7 @@ next:
 	/* Copy name over so we don't have problems with unloaded modules */
 	strcpy(cachep->name, name);
 
-#ifdef CONFIG_SMP
+#if SLAB_CPUCACHE
 	if (g_cpucache_up)
 		enable_cpucache(cachep);
 #endif
@@ -852,7 +893,7 @@ static int is_chained_kmem_cache(kmem_cache_t * cachep)
 #define is_chained_kmem_cache(x) 1
 #endif
 
-#ifdef CONFIG_SMP
+#if SLAB_CPUCACHE
 /*
  * Waits for all CPUs to execute func().
  */
@@ -996,7 +1037,7 @@ int kmem_cache_destroy (kmem_cache_t * cachep)
 		up(&cache_chain_sem);
 		return 1;
 	}
-#ifdef CONFIG_SMP
+#if SLAB_CPUCACHE
 	{
 		int i;
 		for (i = 0; i < NR_CPUS; i++)
@@ -1281,7 +1322,7 @@ static inline void * kmem_cache_alloc_one_tail (kmem_cache_t *cachep,
 	kmem_cache_alloc_one_tail(cachep, slabp);		\
 })
 
-#ifdef CONFIG_SMP
+#if SLAB_CPUCACHE
 void* kmem_cache_alloc_batch(kmem_cache_t* cachep, cpucache_t* cc, int flags)
 {
 	int batchcount = cachep->batchcount;
@@ -1321,9 +1362,10 @@ static inline void * __kmem_cache_alloc (kmem_cache_t *cachep, int flags)
 	void* objp;
 
 	kmem_cache_alloc_head(cachep, flags);
+	STATS_INC_ALLOC(cachep);
 try_again:
 	local_irq_save(save_flags);
-#ifdef CONFIG_SMP
+#if SLAB_CPUCACHE
 	{
 		cpucache_t *cc = cc_data(cachep);
 
@@ -1349,7 +1391,7 @@ try_again:
 	local_irq_restore(save_flags);
 	return objp;
 alloc_new_slab:
-#ifdef CONFIG_SMP
+#if SLAB_CPUCACHE
 	spin_unlock(&cachep->spinlock);
 alloc_new_slab_nolock:
 #endif
@@ -1450,7 +1492,7 @@ static inline void kmem_cache_free_one(kmem_cache_t *cachep, void *objp)
 	}
 }
 
-#ifdef CONFIG_SMP
+#if SLAB_CPUCACHE
 static inline void __free_block (kmem_cache_t* cachep,
 							void** objpp, int len)
 {
@@ -1472,7 +1514,8 @@ static void free_block (kmem_cache_t* cachep, void** objpp, int len)
  */
 static inline void __kmem_cache_free (kmem_cache_t *cachep, void* objp)
 {
-#ifdef CONFIG_SMP
+	STATS_INC_FREE(cachep);
+#if SLAB_CPUCACHE
 	cpucache_t *cc = cc_data(cachep);
 
 	CHECK_PAGE(virt_to_page(objp));
@@ -1604,7 +1647,7 @@ kmem_cache_t * kmem_find_general_cachep (size_t size, int gfpflags)
 	return (gfpflags & GFP_DMA) ? csizep->cs_dmacachep : csizep->cs_cachep;
 }
 
-#ifdef CONFIG_SMP
+#if SLAB_CPUCACHE
 
 /* called with cache_chain_sem acquired.  */
 static int kmem_tune_cpucache (kmem_cache_t* cachep, int limit, int batchcount)
@@ -1669,12 +1712,25 @@ static void enable_cpucache (kmem_cache_t *cachep)
 	/* FIXME: optimize */
 	if (cachep->objsize > PAGE_SIZE)
 		return;
+#ifdef CONFIG_SMP
 	if (cachep->objsize > 1024)
 		limit = 60;
 	else if (cachep->objsize > 256)
 		limit = 124;
 	else
 		limit = 252;
+#else
+	/*
+	 * On UP the magazine only has to absorb alloc/free bursts, not
+	 * cross-cpu traffic; keep it small so little memory sits idle.
+	 */
+	if (cachep->objsize > 1024)
+		limit = 8;
+	else if (cachep->objsize > 256)
+		limit = 24;
+	else
+		limit = 48;
+#endif
 
 	err = kmem_tune_cpucache(cachep, limit, limit/2);
 	if (err)
@@ -1742,7 +1798,7 @@ int kmem_cache_reap (int gfp_mask)
 			searchp->dflags &= ~DFLGS_GROWN;
 			goto next_unlock;
 		}
-#ifdef CONFIG_SMP
+#if SLAB_CPUCACHE
 		{
 			cpucache_t *cc = cc_data(searchp);
 			if (cc && cc->avail) {
@@ -1835,6 +1891,8 @@ out:
  *	cache-name num-active-objs total-objs
  *	obj-size num-active-slabs total-slabs
  *	num-pages-per-slab
+ *	[ : statistics ] [ : limit batchcount ] [ : cpucache hit/miss ]
+ *	[ : allocs/s frees/s allochit% freehit% frag% ]
  */
 #define FIXUP(t)				\
 	do {					\
@@ -1861,6 +1919,8 @@ static int proc_getdata (char*page, char**start, off_t off, int count)
 #endif
 #ifdef CONFIG_SMP
 				" (SMP)"
+#elif SLAB_CPUCACHE
+				" (magazine)"
 #endif
 				"\n");
 	FIXUP(got_data);
@@ -1919,7 +1979,7 @@ static int proc_getdata (char*page, char**start, off_t off, int count)
 					high, allocs, grown, reaped, errors);
 		}
 #endif
-#ifdef CONFIG_SMP
+#if SLAB_CPUCACHE
 		{
 			cpucache_t *cc = cc_data(cachep);
 			unsigned int batchcount = cachep->batchcount;
@@ -1933,7 +1993,7 @@ static int proc_getdata (char*page, char**start, off_t off, int count)
 					limit, batchcount);
 		}
 #endif
-#if STATS && defined(CONFIG_SMP)
+#if STATS && SLAB_CPUCACHE
 		{
 			unsigned long allochit = atomic_read(&cachep->allochit);
 			unsigned long allocmiss = atomic_read(&cachep->allocmiss);
@@ -1942,6 +2002,35 @@ static int proc_getdata (char*page, char**start, off_t off, int count)
 			len += sprintf(page+len, " : %6lu %6lu %6lu %6lu",
 					allochit, allocmiss, freehit, freemiss);
 		}
+#endif
+#if STATS
+		{
+			unsigned int ahit = 0, fhit = 0, frag = 0;
+
+			STATS_SET_RATES(cachep);
+#if SLAB_CPUCACHE
+			{
+				unsigned long hit, miss;
+
+				hit = atomic_read(&cachep->allochit);
+				miss = atomic_read(&cachep->allocmiss);
+				if (hit + miss)
+					ahit = hit * 100 / (hit + miss);
+				hit = atomic_read(&cachep->freehit);
+				miss = atomic_read(&cachep->freemiss);
+				if (hit + miss)
+					fhit = hit * 100 / (hit + miss);
+			}
+#endif
+			/* free objects pinned in pages that can't be reaped */
+			if (active_slabs)
+				frag = (active_slabs*cachep->num -
+					active_objs) * 100 /
+					(active_slabs*cachep->num);
+			len += sprintf(page+len, " : %6lu %6lu %3u %3u %3u",
+					cachep->alloc_rate, cachep->free_rate,
+					ahit, fhit, frag);
+		}
 #endif
 		len += sprintf(page+len,"\n");
 		spin_unlock_irq(&cachep->spinlock);
@@ -1973,7 +2062,7 @@ got_data:
  * num-active-slabs
  * total-slabs
  * num-pages-per-slab
- * + further values on SMP and with statistics enabled
+ * + further values with statistics or cpu caches enabled
  */
 int slabinfo_read_proc (char *page, char **start, off_t off,
 				 int count, int *eof, void *data)
@@ -1989,7 +2078,7 @@ int slabinfo_read_proc (char *page, char **start, off_t off,
 
 #define MAX_SLABINFO_WRITE 128
 /**
- * slabinfo_write_proc - SMP tuning for the slab allocator
+ * slabinfo_write_proc - cpu cache tuning for the slab allocator
  * @file: unused
  * @buffer: user buffer
  * @count: data len
@@ -1998,7 +2087,7 @@ int slabinfo_read_proc (char *page, char **start, off_t off,
 int slabinfo_write_proc (struct file *file, const char *buffer,
 				unsigned long count, void *data)
 {
-#ifdef CONFIG_SMP
+#if SLAB_CPUCACHE
 	char kbuf[MAX_SLABINFO_WRITE+1], *tmp;
 	int limit, batchcount, res;
 	struct list_head *p;
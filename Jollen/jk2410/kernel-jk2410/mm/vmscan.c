@@ -513,8 +513,8 @@ page_mapped:
 		__lru_cache_del(page);
 		UnlockPage(page);
 
-		/* effectively free the page here */
-		page_cache_release(page);
+		/* effectively free the page here, it came off the LRU tail */
+		free_cold_page(page);
 
 		if (--nr_pages)
 			continue;
@@ -541,6 +541,14 @@ static void refill_inactive(int nr_pages)
 	while (nr_pages && entry != &active_list) {
 		struct page * page;
 
+		if (conditional_schedule_needed()) {
+			spin_unlock(&pagemap_lru_lock);
+			unconditional_schedule();
+			spin_lock(&pagemap_lru_lock);
+			entry = active_list.prev;
+			continue;
+		}
+
 		page = list_entry(entry, struct page, lru);
 		entry = entry->prev;
 		if (PageTestandClearReferenced(page)) {
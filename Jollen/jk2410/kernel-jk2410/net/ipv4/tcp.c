@@ -929,19 +929,17 @@ out_err:
 	return tcp_error(sk, flags, err);
 }
 
+#define TCP_ZC_CSUM_FLAGS (NETIF_F_IP_CSUM|NETIF_F_NO_CSUM|NETIF_F_HW_CSUM)
+
 ssize_t tcp_sendpage(struct socket *sock, struct page *page, int offset, size_t size, int flags)
 {
 	ssize_t res;
 	struct sock *sk = sock->sk;
 
-#define TCP_ZC_CSUM_FLAGS (NETIF_F_IP_CSUM|NETIF_F_NO_CSUM|NETIF_F_HW_CSUM)
-
 	if (!(sk->route_caps & NETIF_F_SG) || 
 	    !(sk->route_caps & TCP_ZC_CSUM_FLAGS))
 		return sock_no_sendpage(sock, page, offset, size, flags);
 
-#undef TCP_ZC_CSUM_FLAGS
-
 	lock_sock(sk);
 	TCP_CHECK_TIMER(sk);
 	res = do_tcp_sendpages(sk, &page, offset, size, flags);
@@ -960,11 +958,17 @@ tcp_copy_to_page(struct sock *sk, char *from, struct sk_buff *skb,
 	int err = 0;
 	unsigned int csum;
 
-	csum = csum_and_copy_from_user(from, page_address(page)+off,
-				       copy, 0, &err);
-	if (!err) {
-		if (skb->ip_summed == CHECKSUM_NONE)
+	/* The device checksums the segment: a plain copy is enough. */
+	if (skb->ip_summed != CHECKSUM_NONE) {
+		if (copy_from_user(page_address(page)+off, from, copy))
+			err = -EFAULT;
+	} else {
+		csum = csum_and_copy_from_user(from, page_address(page)+off,
+					       copy, 0, &err);
+		if (!err)
 			skb->csum = csum_block_add(skb->csum, csum, skb->len);
+	}
+	if (!err) {
 		skb->len += copy;
 		skb->data_len += copy;
 		skb->truesize += copy;
@@ -981,6 +985,13 @@ skb_add_data(struct sk_buff *skb, char *from, int copy)
 	unsigned int csum;
 	int off = skb->len;
 
+	if (skb->ip_summed != CHECKSUM_NONE) {
+		if (!copy_from_user(skb_put(skb, copy), from, copy))
+			return 0;
+		__skb_trim(skb, off);
+		return -EFAULT;
+	}
+
 	csum = csum_and_copy_from_user(from, skb_put(skb, copy),
 				       copy, 0, &err);
 	if (!err) {
@@ -1067,6 +1078,10 @@ new_segment:
 				if (skb == NULL)
 					goto wait_for_memory;
 
+				/* Let the device checksum, the copy then needn't. */
+				if (sk->route_caps&TCP_ZC_CSUM_FLAGS)
+					skb->ip_summed = CHECKSUM_HW;
+
 				skb_entail(sk, tp, skb);
 				copy = mss_now;
 			}
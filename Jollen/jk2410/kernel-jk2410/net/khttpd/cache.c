@@ -0,0 +1,250 @@
+/*
+
+kHTTPd -- the next generation
+
+Open-file and response-header cache
+
+*/
+/****************************************************************
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2, or (at your option)
+ *	any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program; if not, write to the Free Software
+ *	Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ ****************************************************************/
+
+/*
+
+Purpose:
+
+Every request used to do a full filp_open() with its permission checks, a
+mime-type lookup and three sprintf()s for the header. For the small files
+kHTTPd is good at, that is most of the work. The cache keeps the open file
+and the URL-dependent part of the header around, keyed by the requested
+filename, for at most sysctl_khttpd_cachetime seconds.
+
+An entry is dropped early when the inode's size or mtime no longer match,
+so rewriting a file in place is noticed on the next request. Replacing a
+file by rename() is only noticed when the entry times out.
+
+*/
+
+#include <linux/kernel.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/file.h>
+#include <linux/fs.h>
+
+#include <asm/atomic.h>
+
+#include "structure.h"
+#include "prototypes.h"
+#include "sysctl.h"
+
+
+#define KHTTPD_CACHE_HASH	64	/* Must be a power of two */
+#define KHTTPD_CACHE_MAX	256	/* Maximum number of hashed entries */
+
+static struct khttpd_cacheentry	*CacheHash[KHTTPD_CACHE_HASH];
+static spinlock_t		CacheLock = SPIN_LOCK_UNLOCKED;
+static int			CacheCount;
+
+
+static unsigned int HashName(const char *Name)
+{
+	unsigned int hash = 0;
+
+	while (*Name)
+		hash = hash * 33 + (unsigned char)*Name++;
+
+	return hash & (KHTTPD_CACHE_HASH-1);
+}
+
+/* Is the entry still valid? Called with CacheLock held. */
+static int EntryIsFresh(struct khttpd_cacheentry *Entry)
+{
+	struct inode *inode = Entry->filp->f_dentry->d_inode;
+
+	if (time_after(jiffies, Entry->Stamp + sysctl_khttpd_cachetime*HZ))
+		return 0;
+	if (inode->i_mtime != Entry->Time || inode->i_size != Entry->FileLength)
+		return 0;
+	return 1;
+}
+
+
+void PutCacheEntry(struct khttpd_cacheentry *Entry)
+{
+	if (Entry==NULL)
+		return;
+	if (!atomic_dec_and_test(&Entry->Count))
+		return;
+
+	fput(Entry->filp);
+	kfree(Entry);
+}
+
+
+/*
+
+LookupCache returns a referenced entry for "Name", or NULL. The caller
+releases it with PutCacheEntry().
+
+*/
+struct khttpd_cacheentry *LookupCache(const char *Name)
+{
+	struct khttpd_cacheentry *Entry,**Prev,*Stale = NULL;
+
+	EnterFunction("LookupCache");
+
+	spin_lock(&CacheLock);
+	Prev = &CacheHash[HashName(Name)];
+	Entry = *Prev;
+	while (Entry!=NULL)
+	{
+		if (strcmp(Entry->FileName,Name)==0)
+			break;
+		Prev = &Entry->Next;
+		Entry = Entry->Next;
+	}
+
+	if (Entry!=NULL)
+	{
+		if (EntryIsFresh(Entry))
+			atomic_inc(&Entry->Count);
+		else
+		{
+			*Prev = Entry->Next;
+			CacheCount--;
+			Stale = Entry;
+			Entry = NULL;
+		}
+	}
+	spin_unlock(&CacheLock);
+
+	/* Drop the hash table's reference outside the lock, it may fput() */
+	PutCacheEntry(Stale);
+
+	LeaveFunction("LookupCache");
+	return Entry;
+}
+
+
+/*
+
+NewCacheEntry wraps a file that OpenFileForSecurity just accepted for "Name"
+in an entry, builds its header part and hashes it if the cache has room.
+The entry takes its own reference on "filp"; the caller keeps theirs.
+
+The returned entry is referenced as with LookupCache(). NULL means no memory.
+
+*/
+struct khttpd_cacheentry *NewCacheEntry(const char *Name, struct file *filp,
+					char *MimeType, __kernel_size_t MimeLength)
+{
+	struct khttpd_cacheentry *Entry,*Other;
+	struct inode *inode = filp->f_dentry->d_inode;
+	char TimeS[64];
+	unsigned int hash;
+
+	EnterFunction("NewCacheEntry");
+
+	Entry = kmalloc(sizeof(struct khttpd_cacheentry),(int)GFP_KERNEL);
+	if (Entry==NULL)
+		return NULL;
+
+	atomic_set(&Entry->Count,1);
+	Entry->Next       = NULL;
+	Entry->Stamp      = jiffies;
+	Entry->filp       = filp;
+	get_file(filp);
+	Entry->FileLength = (int)inode->i_size;
+	Entry->Time       = inode->i_mtime;
+	Entry->MimeType   = MimeType;
+	Entry->MimeLength = MimeLength;
+	strncpy(Entry->FileName,Name,sizeof(Entry->FileName));
+	Entry->FileName[sizeof(Entry->FileName)-1] = 0;
+
+	/* rfc1945, section 10.10: no filetimes in the future */
+	time_Unix2RFC(min_t(unsigned int, Entry->Time, CurrentTime_i),TimeS);
+	Entry->HeaderLength = sprintf(Entry->Header,
+		"\r\nContent-type: %s\r\nLast-modified: %s\r\nContent-length: %i",
+		MimeType,TimeS,Entry->FileLength);
+
+	if (sysctl_khttpd_cachetime<=0)
+		return Entry;
+
+	hash = HashName(Entry->FileName);
+
+	spin_lock(&CacheLock);
+	if (CacheCount<KHTTPD_CACHE_MAX)
+	{
+		/* Another thread may have raced us to it; keep theirs */
+		Other = CacheHash[hash];
+		while (Other!=NULL && strcmp(Other->FileName,Entry->FileName)!=0)
+			Other = Other->Next;
+
+		if (Other==NULL)
+		{
+			Entry->Next = CacheHash[hash];
+			CacheHash[hash] = Entry;
+			atomic_inc(&Entry->Count);
+			CacheCount++;
+		}
+	}
+	spin_unlock(&CacheLock);
+
+	LeaveFunction("NewCacheEntry");
+	return Entry;
+}
+
+
+/*
+
+FlushCache drops every hashed entry. Entries still in use by a request
+are freed when that request lets go of them.
+
+*/
+void FlushCache(void)
+{
+	struct khttpd_cacheentry *List = NULL,*Entry,*Next;
+	int I;
+
+	EnterFunction("FlushCache");
+
+	spin_lock(&CacheLock);
+	for (I=0;I<KHTTPD_CACHE_HASH;I++)
+	{
+		Entry = CacheHash[I];
+		while (Entry!=NULL)
+		{
+			Next = Entry->Next;
+			Entry->Next = List;
+			List = Entry;
+			Entry = Next;
+		}
+		CacheHash[I] = NULL;
+	}
+	CacheCount = 0;
+	spin_unlock(&CacheLock);
+
+	while (List!=NULL)
+	{
+		Next = List->Next;
+		PutCacheEntry(List);
+		List = Next;
+	}
+
+	LeaveFunction("FlushCache");
+}
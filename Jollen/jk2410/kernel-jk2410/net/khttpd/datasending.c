@@ -28,6 +28,9 @@ Purpose:
 
 DataSending does the actual sending of file-data to the socket.
 
+Finished requests go to the "logging" queue, except on kept-alive
+connections, which are reset and go back to the "wait for headers" queue.
+
 Note: Since asynchronous reads do not -yet- exists, this might block!
 
 Return value:
@@ -36,6 +39,7 @@ Return value:
 
 #include <linux/config.h>
 #include <linux/kernel.h>
+#include <linux/errno.h>
 #include <linux/locks.h>
 #include <linux/skbuff.h>
 
@@ -46,6 +50,7 @@ Return value:
 
 #include "structure.h"
 #include "prototypes.h"
+#include "sysctl.h"
 
 static	char	*Block[CONFIG_KHTTPD_NUMCPU];
 
@@ -54,6 +59,10 @@ static	char	*Block[CONFIG_KHTTPD_NUMCPU];
 This send_actor is for use with do_generic_file_read (ie sendfile())
 It sends the data to the socket indicated by desc->buf.
 
+The page itself is handed to the protocol's sendpage, so on a device that
+can do scatter/gather and checksumming the data is never copied. TCP falls
+back to copying by itself otherwise.
+
 */
 static int sock_send_actor(read_descriptor_t * desc, struct page *page, unsigned long offset, unsigned long size)
 {
@@ -62,16 +71,27 @@ static int sock_send_actor(read_descriptor_t * desc, struct page *page, unsigned
 	unsigned long count = desc->count;
 	struct socket *sock = (struct socket *) desc->buf;
 	mm_segment_t old_fs;
+	int flags = MSG_DONTWAIT|MSG_NOSIGNAL;
 
 	if (size > count)
 		size = count;
-	old_fs = get_fs();
-	set_fs(KERNEL_DS);
+	if (size < count)
+		flags |= MSG_MORE;
+
+	if (sock->sk==NULL)
+		written = -ECONNRESET;
+	else if (sock->ops->sendpage)
+		written = sock->ops->sendpage(sock, page, offset, size, flags);
+	else
+	{
+		old_fs = get_fs();
+		set_fs(KERNEL_DS);
 
-	kaddr = kmap(page);
-	written = SendBuffer_async(sock, kaddr + offset, size);
-	kunmap(page);
-	set_fs(old_fs);
+		kaddr = kmap(page);
+		written = SendBuffer_async(sock, kaddr + offset, size);
+		kunmap(page);
+		set_fs(old_fs);
+	}
 	if (written < 0) {
 		desc->error = written;
 		written = 0;
@@ -97,13 +117,16 @@ int DataSending(const int CPUNR)
 	{
 		int ReadSize,Space;
 		int retval;
+		struct sock *sk;
 
 
 		/* First, test if the socket has any buffer-space left.
-		   If not, no need to actually try to send something.  */
+		   If not, no need to actually try to send something.
+		   The socket may have been torn down under us, leaving
+		   no sk at all; such a request is finished below. */
 		  
-		
-		Space = sock_wspace(CurrentRequest->sock->sk);
+		sk = CurrentRequest->sock->sk;
+		Space = sk ? sock_wspace(sk) : 0;
 		
 		ReadSize = min_t(int, 4 * 4096, CurrentRequest->FileLength - CurrentRequest->BytesSent);
 		ReadSize = min_t(int, ReadSize, Space);
@@ -111,23 +134,20 @@ int DataSending(const int CPUNR)
 		if (ReadSize>0)
 		{			
 			struct inode *inode;
+			loff_t pos;	/* The filp is shared through the cache, so not f_pos */
 			
 			inode = CurrentRequest->filp->f_dentry->d_inode;
+			pos = CurrentRequest->BytesSent;
 			
 			if (inode->i_mapping->a_ops->readpage) {
 				/* This does the actual transfer using sendfile */		
 				read_descriptor_t desc;
-				loff_t *ppos;
-		
-				CurrentRequest->filp->f_pos = CurrentRequest->BytesSent;
-
-				ppos = &CurrentRequest->filp->f_pos;
 
 				desc.written = 0;
 				desc.count = ReadSize;
 				desc.buf = (char *) CurrentRequest->sock;
 				desc.error = 0;
-				do_generic_file_read(CurrentRequest->filp, ppos, &desc, sock_send_actor);
+				do_generic_file_read(CurrentRequest->filp, &pos, &desc, sock_send_actor);
 				if (desc.written>0)
 				{	
 					CurrentRequest->BytesSent += desc.written;
@@ -137,10 +157,9 @@ int DataSending(const int CPUNR)
 			else  /* FS doesn't support sendfile() */
 			{
 				mm_segment_t oldfs;
-				CurrentRequest->filp->f_pos = CurrentRequest->BytesSent;
 				
 				oldfs = get_fs(); set_fs(KERNEL_DS);
-				retval = CurrentRequest->filp->f_op->read(CurrentRequest->filp, Block[CPUNR], ReadSize, &CurrentRequest->filp->f_pos);
+				retval = CurrentRequest->filp->f_op->read(CurrentRequest->filp, Block[CPUNR], ReadSize, &pos);
 				set_fs(oldfs);
 		
 				if (retval>0)
@@ -161,25 +180,39 @@ int DataSending(const int CPUNR)
 		   by moving it to the "logging" queue. 
 		*/
 		if ((CurrentRequest->BytesSent>=CurrentRequest->FileLength)||
-		    (CurrentRequest->sock->sk->state!=TCP_ESTABLISHED
-		     && CurrentRequest->sock->sk->state!=TCP_CLOSE_WAIT))
+		    sk==NULL ||
+		    (sk->state!=TCP_ESTABLISHED
+		     && sk->state!=TCP_CLOSE_WAIT))
 		{
 			struct http_request *Next;
 			Next = CurrentRequest->Next;
 
-			lock_sock(CurrentRequest->sock->sk);
-			if  (CurrentRequest->sock->sk->state == TCP_ESTABLISHED ||
-			     CurrentRequest->sock->sk->state == TCP_CLOSE_WAIT)
+			if (sk!=NULL)
 			{
-				CurrentRequest->sock->sk->tp_pinfo.af_tcp.nonagle = 0;
-				tcp_push_pending_frames(CurrentRequest->sock->sk,&(CurrentRequest->sock->sk->tp_pinfo.af_tcp));
+				lock_sock(sk);
+				if  (sk->state == TCP_ESTABLISHED ||
+				     sk->state == TCP_CLOSE_WAIT)
+				{
+					sk->tp_pinfo.af_tcp.nonagle = 0;
+					tcp_push_pending_frames(sk,&(sk->tp_pinfo.af_tcp));
+				}
+				release_sock(sk);
 			}
-			release_sock(CurrentRequest->sock->sk);
 
 			(*Prev) = CurrentRequest->Next;
 			
-			CurrentRequest->Next = threadinfo[CPUNR].LoggingQueue;
-			threadinfo[CPUNR].LoggingQueue = CurrentRequest;	
+			if (CurrentRequest->KeepAlive && sysctl_khttpd_keepalive>0 &&
+			    CurrentRequest->BytesSent>=CurrentRequest->FileLength &&
+			    sk!=NULL && sk->state == TCP_ESTABLISHED)
+			{
+				ResetRequest(CurrentRequest);
+				CurrentRequest->Next = threadinfo[CPUNR].WaitForHeaderQueue;
+				threadinfo[CPUNR].WaitForHeaderQueue = CurrentRequest;
+			} else
+			{
+				CurrentRequest->Next = threadinfo[CPUNR].LoggingQueue;
+				threadinfo[CPUNR].LoggingQueue = CurrentRequest;	
+			}
 				
 			CurrentRequest = Next;
 			continue;
@@ -310,6 +310,7 @@ static int ManagementDaemon(void *unused)
 			while (atomic_read(&DaemonCount)>0)
 		 		interruptible_sleep_on_timeout(&WQ,HZ);
 			StopListening();
+			FlushCache();	/* Don't pin files while stopped */
 		}
 
 		
@@ -329,6 +330,7 @@ static int ManagementDaemon(void *unused)
 		waitpid_result = waitpid(-1,NULL,__WCLONE|WNOHANG);
 		
 	StopListening();
+	FlushCache();
 	
 	
 	(void)printk(KERN_NOTICE "kHTTPd: Management daemon stopped. \n        You can unload the module now.\n");
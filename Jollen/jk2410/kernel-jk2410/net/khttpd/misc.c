@@ -124,6 +124,8 @@ void CleanUpRequest(struct http_request *Req)
 	    	Req->filp = NULL;
 	}
 	
+	PutCacheEntry(Req->Cache);
+	Req->Cache = NULL;
 	
 	/* ... and release the memory for the structure. */
 	kfree(Req);
@@ -133,6 +135,49 @@ void CleanUpRequest(struct http_request *Req)
 }
 
 
+/*
+
+ResetRequest prepares a kept-alive connection for its next request: the file
+and cache entry of the previous one are released and everything ParseHeader
+fills in is cleared, since it relies on zeroed strings. The socket and its
+waitqueue entry stay as they are.
+
+*/
+void ResetRequest(struct http_request *Req)
+{
+	EnterFunction("ResetRequest");
+	
+	if (Req->filp!=NULL)
+	{
+	    	fput(Req->filp);
+	    	Req->filp = NULL;
+	}
+	PutCacheEntry(Req->Cache);
+	Req->Cache = NULL;
+	
+	Req->FileLength     = 0;
+	Req->Time           = 0;
+	Req->BytesSent      = 0;
+	Req->IsForUserspace = 0;
+	Req->KeepAlive      = 0;
+	Req->HTTPVER        = 0;
+	Req->Connection     = 0;
+	Req->HeaderLength   = 0;
+	Req->IMS_Time       = 0;
+	Req->MimeType       = NULL;
+	Req->MimeLength     = 0;
+	
+	Req->FileNameLength = 0;
+	memset(Req->FileName,0,sizeof(Req->FileName));
+	memset(Req->Agent,0,sizeof(Req->Agent));
+	memset(Req->IMS,0,sizeof(Req->IMS));
+	memset(Req->Host,0,sizeof(Req->Host));
+	
+	Req->IdleSince = jiffies;
+	LeaveFunction("ResetRequest");
+}
+
+
 /*
 
 SendBuffer and Sendbuffer_async send "Length" bytes from "Buffer" to the "sock"et.
@@ -217,6 +262,8 @@ situation, and they don't change anyhow.
 static char NoPerm[] = "HTTP/1.0 403 Forbidden\r\nServer: kHTTPd 0.1.6\r\n\r\n";
 static char TryLater[] = "HTTP/1.0 503 Service Unavailable\r\nServer: kHTTPd 0.1.6\r\nContent-Length: 15\r\n\r\nTry again later";
 static char NotModified[] = "HTTP/1.0 304 Not Modified\r\nServer: kHTTPd 0.1.6\r\n\r\n";
+static char NotModifiedKA[] = "HTTP/1.0 304 Not Modified\r\nServer: kHTTPd 0.1.6\r\nConnection: Keep-Alive\r\n\r\n";
+static char NotModifiedKAv11[] = "HTTP/1.1 304 Not Modified\r\nServer: kHTTPd 0.1.6\r\nConnection: Keep-Alive\r\n\r\n";
 
 
 void Send403(struct socket *sock)
@@ -226,10 +273,15 @@ void Send403(struct socket *sock)
 	LeaveFunction("Send403");
 }
 
-void Send304(struct socket *sock)
+void Send304(struct socket *sock,const int KeepAlive,const int HTTPVER)
 {
 	EnterFunction("Send304");
-	(void)SendBuffer(sock,NotModified,strlen(NotModified));
+	if (KeepAlive && HTTPVER>=11)
+		(void)SendBuffer(sock,NotModifiedKAv11,strlen(NotModifiedKAv11));
+	else if (KeepAlive)
+		(void)SendBuffer(sock,NotModifiedKA,strlen(NotModifiedKA));
+	else
+		(void)SendBuffer(sock,NotModified,strlen(NotModified));
 	LeaveFunction("Send304");
 }
 
@@ -54,10 +54,11 @@ extern struct wait_queue main_wait[CONFIG_KHTTPD_NUMCPU];
 /* misc.c */
 
 void CleanUpRequest(struct http_request *Req);
+void ResetRequest(struct http_request *Req);
 int SendBuffer(struct socket *sock, const char *Buffer,const size_t Length);
 int SendBuffer_async(struct socket *sock, const char *Buffer,const size_t Length);
 void Send403(struct socket *sock);
-void Send304(struct socket *sock);
+void Send304(struct socket *sock,const int KeepAlive,const int HTTPVER);
 void Send50x(struct socket *sock);
 
 /* accept.c */
@@ -100,6 +101,15 @@ void SendHTTPHeader(struct http_request *Request);
 
 
 
+/* cache.c */
+
+struct khttpd_cacheentry *LookupCache(const char *Name);
+struct khttpd_cacheentry *NewCacheEntry(const char *Name, struct file *filp,
+					char *MimeType, __kernel_size_t MimeLength);
+void PutCacheEntry(struct khttpd_cacheentry *Entry);
+void FlushCache(void);
+
+
 /* security.c */
 
 struct file *OpenFileForSecurity(char *Filename);
@@ -155,13 +155,16 @@ char *ResolveMimeType(const char *File,__kernel_size_t *Len)
 }
 
 
-static char HeaderPart1[] = "HTTP/1.0 200 OK\r\nServer: kHTTPd/0.1.6\r\nDate: ";
 #ifdef BENCHMARK
 static char HeaderPart1b[] ="HTTP/1.0 200 OK";
-#endif
 static char HeaderPart3[] = "\r\nContent-type: ";
-static char HeaderPart5[] = "\r\nLast-modified: ";
 static char HeaderPart7[] = "\r\nContent-length: ";
+#else
+static char HeaderPart1[] = "HTTP/1.0 200 OK\r\nServer: kHTTPd/0.1.6\r\nDate: ";
+static char HeaderPart1v11[] = "HTTP/1.1 200 OK\r\nServer: kHTTPd/0.1.6\r\nDate: ";
+static char HeaderPartKeepAlive[] = "\r\nConnection: Keep-Alive";
+static char HeaderPartClose[] = "\r\nConnection: close";
+#endif
 static char HeaderPart9[] = "\r\n\r\n";
 
 #ifdef BENCHMARK
@@ -215,47 +218,54 @@ void SendHTTPHeader(struct http_request *Request)
 	return;	
 }
 #else
+/*
+
+The Content-type, Last-modified and Content-length lines depend only on the
+file and come prebuilt from the cache entry; the status line, the date and
+the Connection line are filled in per request.
+
+*/
 void SendHTTPHeader(struct http_request *Request)
 {
 	struct msghdr	msg;
 	mm_segment_t	oldfs;
-	struct iovec	iov[9];
-	int 		len,len2;
-	__kernel_size_t	slen;
+	struct iovec	iov[5];
+	int 		len,len2,I;
 	
 	EnterFunction("SendHTTPHeader");
 	
 	msg.msg_name     = 0;
 	msg.msg_namelen  = 0;
 	msg.msg_iov	 = &(iov[0]);
-	msg.msg_iovlen   = 9;
+	msg.msg_iovlen   = 5;
 	msg.msg_control  = NULL;
 	msg.msg_controllen = 0;
 	msg.msg_flags    = 0;  /* Synchronous for now */
 	
-	iov[0].iov_base = HeaderPart1;
-	iov[0].iov_len  = 45;
+	if (Request->HTTPVER>=11)
+		iov[0].iov_base = HeaderPart1v11;
+	else
+		iov[0].iov_base = HeaderPart1;
+	iov[0].iov_len  = sizeof(HeaderPart1)-1;
 	iov[1].iov_base = CurrentTime;
 	iov[1].iov_len  = 29;
-	iov[2].iov_base = HeaderPart3;
-	iov[2].iov_len  = 16;
-	
-	iov[3].iov_base = Request->MimeType;
-	iov[3].iov_len  = Request->MimeLength;
-	
-	iov[4].iov_base = HeaderPart5;
-	iov[4].iov_len  = 17;
-	iov[5].iov_base = &(Request->TimeS[0]);
-	iov[5].iov_len  = 29;
-	iov[6].iov_base = HeaderPart7;
-	iov[6].iov_len  = 18;
-	iov[7].iov_base = &(Request->LengthS[0]);
-	slen = strlen(Request->LengthS); 
-	iov[7].iov_len  = slen;
-	iov[8].iov_base = HeaderPart9;
-	iov[8].iov_len  = 4;
+	if (Request->KeepAlive)
+	{
+		iov[2].iov_base = HeaderPartKeepAlive;
+		iov[2].iov_len  = sizeof(HeaderPartKeepAlive)-1;
+	} else
+	{
+		iov[2].iov_base = HeaderPartClose;
+		iov[2].iov_len  = sizeof(HeaderPartClose)-1;
+	}
+	iov[3].iov_base = Request->Cache->Header;
+	iov[3].iov_len  = Request->Cache->HeaderLength;
+	iov[4].iov_base = HeaderPart9;
+	iov[4].iov_len  = 4;
 	
-	len2=45+2*29+16+17+18+slen+4+iov[3].iov_len;
+	len2 = 0;
+	for (I=0;I<5;I++)
+		len2 += iov[I].iov_len;
 	
 	len = 0;
 
@@ -284,10 +294,15 @@ void ParseHeader(char *Buffer,const int length, struct http_request *Head)
 	EnterFunction("ParseHeader");
 	Endval = Buffer + length;
 	
-	/* We want to parse only the first header if multiple headers are present */
+	/* We want to parse only the first header if multiple headers are present.
+	   Remember where it ends, the next one is a pipelined request. */
+	Head->HeaderLength = 0;
 	tmp = strstr(Buffer,"\r\n\r\n"); 
 	if (tmp!=NULL)
+	{
 	    Endval = tmp;
+	    Head->HeaderLength = tmp + 4 - Buffer;
+	}
 	
 	
 	while (Buffer<Endval)
@@ -319,7 +334,9 @@ void ParseHeader(char *Buffer,const int length, struct http_request *Head)
 			{
 				tmp=EOL-1;
 				Head->HTTPVER = 9;
-			} else
+			} else if (strncmp(tmp+1,"HTTP/1.1",8)==0)
+				Head->HTTPVER = 11;
+			else
 				Head->HTTPVER = 10;
 			
 			if (tmp>Endval) continue;
@@ -367,6 +384,19 @@ void ParseHeader(char *Buffer,const int length, struct http_request *Head)
 			Buffer=EOL+1;	
 			continue;
 		}
+
+		if (strnicmp("Connection: ",Buffer,12)==0)
+		{
+			Buffer+=12;
+			
+			if (strnicmp(Buffer,"keep-alive",10)==0)
+				Head->Connection = 1;
+			else if (strnicmp(Buffer,"close",5)==0)
+				Head->Connection = -1;
+					
+			Buffer=EOL+1;	
+			continue;
+		}
 #endif		
 		Buffer = EOL+1;  /* Skip line */
 	}
@@ -3,9 +3,11 @@
 
 #include <linux/time.h>
 #include <linux/wait.h>
+#include <asm/atomic.h>
 
 
 struct http_request;
+struct khttpd_cacheentry;
 
 struct http_request
 {
@@ -15,6 +17,7 @@ struct http_request
 	/* Network and File data */
 	struct socket	*sock;		
 	struct file	*filp;		
+	struct khttpd_cacheentry *Cache; /* Open-file/header cache entry, own reference */
 
 	/* Raw data about the file */
 	
@@ -22,6 +25,8 @@ struct http_request
 	int		Time;		/* mtime of the file, unix format */
 	int		BytesSent;	/* The number of bytes already sent */
 	int		IsForUserspace;	/* 1 means let Userspace handle this one */
+	int		KeepAlive;	/* 1 means wait for the next request when done */
+	unsigned long	IdleSince;	/* jiffies at which the previous request finished */
 	
 	/* Wait queue */
 	
@@ -33,7 +38,9 @@ struct http_request
 	char		Agent[128];	/* The agent-string of the remote browser */
 	char		IMS[128];	/* If-modified-since time, rfc string format */
 	char		Host[128];	/* Value given by the Host: header */
-	int		HTTPVER;        /* HTTP-version; 9 for 0.9,   10 for 1.0 and above */
+	int		HTTPVER;        /* HTTP-version; 9 for 0.9, 10 for 1.0, 11 for 1.1 and above */
+	int		Connection;	/* Connection: header; 1 keep-alive, -1 close, 0 absent */
+	int		HeaderLength;	/* Bytes up to and including the empty line, 0 if incomplete */
 
 
 	/* Derived date from the above fields */	
@@ -47,6 +54,33 @@ struct http_request
 };
 
 
+/*
+
+struct khttpd_cacheentry is a cached open file plus the URL-dependent part of
+its response header. Entries are hashed by the (undecoded) filename as it comes
+out of ParseHeader, and are only ever created after OpenFileForSecurity has
+accepted that filename.
+
+*/
+struct khttpd_cacheentry
+{
+	struct khttpd_cacheentry *Next;	/* Hash chain */
+	atomic_t	Count;		/* References: the hash table and each request */
+	unsigned long	Stamp;		/* jiffies when the file was opened */
+
+	struct file	*filp;
+	int		FileLength;
+	int		Time;
+	char		*MimeType;
+	__kernel_size_t	MimeLength;
+
+	char		Header[192];	/* Content-type, Last-modified, Content-length */
+	int		HeaderLength;
+
+	char		FileName[256];
+};
+
+
 
 /*
 
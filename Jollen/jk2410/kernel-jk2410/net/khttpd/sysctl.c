@@ -63,6 +63,8 @@ char	sysctl_khttpd_dynamicstring[200];
 int 	sysctl_khttpd_sloppymime= 0;
 int	sysctl_khttpd_threads	= 2;
 int	sysctl_khttpd_maxconnect = 1000;
+int	sysctl_khttpd_keepalive	= 15;	/* idle seconds, 0 closes after each response */
+int	sysctl_khttpd_cachetime	= 10;	/* seconds, 0 disables the open-file cache */
 
 
 static struct ctl_table_header *khttpd_table_header;
@@ -147,6 +149,30 @@ static ctl_table khttpd_table[] = {
 		NULL,
 		NULL
 	},
+	{	NET_KHTTPD_KEEPALIVE,
+		"keepalive",
+		&sysctl_khttpd_keepalive,
+		sizeof(int),
+		0644,
+		NULL,
+		proc_dointvec,
+		&sysctl_intvec,
+		NULL,
+		NULL,
+		NULL
+	},
+	{	NET_KHTTPD_CACHETIME,
+		"cachetime",
+		&sysctl_khttpd_cachetime,
+		sizeof(int),
+		0644,
+		NULL,
+		proc_dointvec,
+		&sysctl_intvec,
+		NULL,
+		NULL,
+		NULL
+	},
 	{	NET_KHTTPD_SLOPPYMIME,
 		"sloppymime",
 		&sysctl_khttpd_sloppymime,
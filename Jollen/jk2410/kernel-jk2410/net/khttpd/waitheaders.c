@@ -30,6 +30,10 @@ WaitForHeaders polls all connections in "WaitForHeaderQueue" to see if
 headers have arived. If so, the headers are decoded and the request is
 moved to either the "SendingDataQueue" or the "UserspaceQueue".
 
+Kept-alive connections come back here after their response has been sent,
+and are closed when no new request arrives within sysctl_khttpd_keepalive
+seconds.
+
 Return value:
 	The number of requests that changed status
 */
@@ -44,6 +48,7 @@ Return value:
 
 #include "structure.h"
 #include "prototypes.h"
+#include "sysctl.h"
 
 static	char			*Buffer[CONFIG_KHTTPD_NUMCPU];
 
@@ -90,21 +95,12 @@ int WaitForHeaders(const int CPUNR)
 		
 		sk = CurrentRequest->sock->sk;
 		
-		if (!skb_queue_empty(&(sk->receive_queue))) /* Do we have data ? */
+		if (!skb_queue_empty(&(sk->receive_queue)) &&
+		    DecodeHeader(CPUNR,CurrentRequest)>=0)
 		{
 			struct http_request *Next;
 			
 			
-			
-			/* Decode header */
-			
-			if (DecodeHeader(CPUNR,CurrentRequest)<0)
-			{
-				CurrentRequest = CurrentRequest->Next;
-				continue;
-			} 
-			
-			
 			/* Remove from WaitForHeaderQueue */		
 			
 			Next= CurrentRequest->Next;
@@ -129,6 +125,23 @@ int WaitForHeaders(const int CPUNR)
 		
 		}	
 
+		/* Kept-alive connection that timed out or was closed by the client? */
+		
+		if (CurrentRequest->IdleSince!=0 &&
+		    (sk->state == TCP_CLOSE_WAIT ||
+		     time_after(jiffies, CurrentRequest->IdleSince + sysctl_khttpd_keepalive*HZ)))
+		{
+			struct http_request *Next;
+			
+			Next = CurrentRequest->Next;
+			
+			*Prev = CurrentRequest->Next;
+			CurrentRequest->Next = NULL;
+			
+			CleanUpRequest(CurrentRequest);
+			CurrentRequest = Next;
+			continue;
+		}
 		
 		Prev = &(CurrentRequest->Next);
 		CurrentRequest = CurrentRequest->Next;
@@ -166,6 +179,10 @@ void StopWaitingForHeaders(const int CPUNR)
 DecodeHeader peeks at the TCP/IP data, determines what the request is, 
 fills the request-structure and sends the HTTP-header when apropriate.
 
+Requests for userspace are left on the socket untouched. For a request that
+is served here on a kept-alive connection, exactly the header bytes are
+consumed, so a pipelined request behind it stays queued for the next round.
+
 */
 
 static int DecodeHeader(const int CPUNR, struct http_request *Request)
@@ -173,6 +190,7 @@ static int DecodeHeader(const int CPUNR, struct http_request *Request)
 	struct msghdr		msg;
 	struct iovec		iov;
 	int			len;
+	struct khttpd_cacheentry *Entry;
 
 	mm_segment_t		oldfs;
 	
@@ -210,57 +228,106 @@ static int DecodeHeader(const int CPUNR, struct http_request *Request)
 		return 0;
 	}
 	
+	Buffer[CPUNR][len] = 0;
+	
 	/* Then, decode the header */
 	
 	
 	ParseHeader(Buffer[CPUNR],len,Request);
 	
-	Request->filp = OpenFileForSecurity(Request->FileName);
+	/* On a kept-alive connection, wait for the rest of a partial header
+	   rather than guessing; the keep-alive timeout still applies. */
+	
+	if (Request->IdleSince!=0 && Request->HeaderLength==0 && Request->HTTPVER!=9)
+		return -1;
 	
+	/* Keep the connection if the client asked for it (the default as of
+	   HTTP/1.1) and we know where its request ends. */
 	
-	Request->MimeType = ResolveMimeType(Request->FileName,&Request->MimeLength);
+	Request->KeepAlive = 0;
+	if (sysctl_khttpd_keepalive>0 && Request->HeaderLength>0)
+	{
+		if (Request->HTTPVER==11 && Request->Connection>=0)
+			Request->KeepAlive = 1;
+		if (Request->HTTPVER==10 && Request->Connection>0)
+			Request->KeepAlive = 1;
+	}
 	
+	Entry = LookupCache(Request->FileName);
 	
-	if (Request->MimeType==NULL) /* Unknown mime-type */
+	if (Entry==NULL)
 	{
-		if (Request->filp!=NULL)
+		struct file	*filp;
+		char		*MimeType;
+		__kernel_size_t	MimeLength;
+		char		Key[256];
+		
+		/* OpenFileForSecurity decodes the name in place */
+		strcpy(Key,Request->FileName);
+		
+		filp = OpenFileForSecurity(Request->FileName);
+	
+		MimeType = ResolveMimeType(Request->FileName,&MimeLength);
+	
+		if (MimeType==NULL) /* Unknown mime-type */
 		{
-			fput(Request->filp);
-			Request->filp = NULL;
-		}
-		Request->IsForUserspace = 1;
+			if (filp!=NULL)
+				fput(filp);
+			Request->IsForUserspace = 1;
 		
-		return 0;
-	}
-
-	if (Request->filp==NULL)
-	{
-		Request->IsForUserspace = 1;
-		return 0;
-	}
-	else
-	{
-		Request->FileLength = (int)Request->filp->f_dentry->d_inode->i_size;
-		Request->Time       = Request->filp->f_dentry->d_inode->i_mtime;
-		Request->IMS_Time   = mimeTime_to_UnixTime(Request->IMS);
-		sprintf(Request->LengthS,"%i",Request->FileLength);
-		time_Unix2RFC(min_t(unsigned int, Request->Time,CurrentTime_i),Request->TimeS);
-   	        /* The min() is required by rfc1945, section 10.10:
-   	           It is not allowed to send a filetime in the future */
-
-		if (Request->IMS_Time>Request->Time)
-		{	/* Not modified since last time */
-			Send304(Request->sock);
-			Request->FileLength=0;
+			return 0;
 		}
-		else   /* Normal Case */
+
+		if (filp==NULL)
 		{
-			Request->sock->sk->tp_pinfo.af_tcp.nonagle = 2; /* this is TCP_CORK */
-			if (Request->HTTPVER!=9)  /* HTTP/0.9 doesn't allow a header */
-				SendHTTPHeader(Request);
+			Request->IsForUserspace = 1;
+			return 0;
 		}
 		
+		Entry = NewCacheEntry(Key,filp,MimeType,MimeLength);
+		fput(filp);
+		
+		if (Entry==NULL)
+		{
+			Request->IsForUserspace = 1;
+			return 0;
+		}
+	}
 	
+	Request->Cache      = Entry;
+	Request->filp       = Entry->filp;
+	get_file(Request->filp);
+	Request->MimeType   = Entry->MimeType;
+	Request->MimeLength = Entry->MimeLength;
+	Request->FileLength = Entry->FileLength;
+	Request->Time       = Entry->Time;
+	Request->IMS_Time   = mimeTime_to_UnixTime(Request->IMS);
+	
+	/* Now that we are going to answer it, take the request off the socket */
+	
+	if (Request->KeepAlive)
+	{
+		msg.msg_iov->iov_base = &Buffer[CPUNR][0];
+		msg.msg_iov->iov_len  = (size_t)Request->HeaderLength;
+		
+		oldfs = get_fs(); set_fs(KERNEL_DS);
+		len = sock_recvmsg(Request->sock,&msg,Request->HeaderLength,MSG_DONTWAIT);
+		set_fs(oldfs);
+		
+		if (len!=Request->HeaderLength)
+			Request->KeepAlive = 0;
+	}
+
+	if (Request->IMS_Time>Request->Time)
+	{	/* Not modified since last time */
+		Send304(Request->sock,Request->KeepAlive,Request->HTTPVER);
+		Request->FileLength=0;
+	}
+	else   /* Normal Case */
+	{
+		Request->sock->sk->tp_pinfo.af_tcp.nonagle = 2; /* this is TCP_CORK */
+		if (Request->HTTPVER!=9)  /* HTTP/0.9 doesn't allow a header */
+			SendHTTPHeader(Request);
 	}
 	
 	LeaveFunction("DecodeHeader");
@@ -169,7 +169,21 @@ struct packet_mclist
 };
 #endif
 #ifdef CONFIG_PACKET_MMAP
-static int packet_set_ring(struct sock *sk, struct tpacket_req *req, int closing);
+struct packet_ring
+{
+	unsigned long		*pg_vec;
+	unsigned int		pg_vec_order;
+	unsigned int		pg_vec_pages;
+	unsigned int		pg_vec_len;
+
+	struct tpacket_hdr	**iovec;
+	unsigned int		frame_size;
+	unsigned int		frames_per_block;
+	unsigned int		iovmax;
+	unsigned int		head;
+};
+
+static int packet_set_ring(struct sock *sk, struct tpacket_req *req, int closing, int tx_ring);
 #endif
 
 static void packet_flush_mclist(struct sock *sk);
@@ -186,16 +200,12 @@ struct packet_opt
 #endif
 #ifdef CONFIG_PACKET_MMAP
 	atomic_t		mapped;
-	unsigned long		*pg_vec;
-	unsigned int		pg_vec_order;
-	unsigned int		pg_vec_pages;
-	unsigned int		pg_vec_len;
-
-	struct tpacket_hdr	**iovec;
-	unsigned int		frame_size;
-	unsigned int		iovmax;
-	unsigned int		head;
+	struct packet_ring	rx_ring;
+	struct packet_ring	tx_ring;
 	int			copy_thresh;
+	unsigned long		rx_tmo;		/* wake-up coalescing, 0 = per frame */
+	unsigned int		rx_unannounced;	/* frames filled since last wake-up */
+	struct timer_list	rx_timer;
 #endif
 };
 
@@ -511,6 +521,38 @@ drop:
 }
 
 #ifdef CONFIG_PACKET_MMAP
+/*
+ * Should claiming a frame wake the reader? Without coalescing always;
+ * with it, once per filled block of the ring, or rx_tmo after the first
+ * frame nobody was told about. Called with receive_queue.lock held.
+ */
+static inline int tpacket_rx_announce(struct packet_opt *po)
+{
+	if (po->rx_tmo == 0 ||
+	    po->rx_ring.head % po->rx_ring.frames_per_block == 0) {
+		po->rx_unannounced = 0;
+		return 1;
+	}
+	if (po->rx_unannounced++ == 0)
+		mod_timer(&po->rx_timer, jiffies + po->rx_tmo);
+	return 0;
+}
+
+static void tpacket_rx_timeout(unsigned long data)
+{
+	struct sock *sk = (struct sock *) data;
+	struct packet_opt *po = sk->protinfo.af_packet;
+	int wake;
+
+	spin_lock(&sk->receive_queue.lock);
+	wake = po->rx_unannounced != 0;
+	po->rx_unannounced = 0;
+	spin_unlock(&sk->receive_queue.lock);
+
+	if (wake)
+		sk->data_ready(sk, 0);
+}
+
 static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,  struct packet_type *pt)
 {
 	struct sock *sk;
@@ -523,6 +565,7 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,  struct pack
 	unsigned long status = TP_STATUS_LOSING|TP_STATUS_USER;
 	unsigned short macoff, netoff;
 	struct sk_buff *copy_skb = NULL;
+	int wake;
 
 	if (skb->pkt_type == PACKET_LOOPBACK)
 		goto drop;
@@ -568,7 +611,7 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,  struct pack
 		macoff = netoff - maclen;
 	}
 
-	if (macoff + snaplen > po->frame_size) {
+	if (macoff + snaplen > po->rx_ring.frame_size) {
 		if (po->copy_thresh &&
 		    atomic_read(&sk->rmem_alloc) + skb->truesize < (unsigned)sk->rcvbuf) {
 			if (skb_shared(skb)) {
@@ -580,7 +623,7 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,  struct pack
 			if (copy_skb)
 				skb_set_owner_r(copy_skb, sk);
 		}
-		snaplen = po->frame_size - macoff;
+		snaplen = po->rx_ring.frame_size - macoff;
 		if ((int)snaplen < 0)
 			snaplen = 0;
 	}
@@ -588,11 +631,11 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,  struct pack
 		snaplen = skb->len-skb->data_len;
 
 	spin_lock(&sk->receive_queue.lock);
-	h = po->iovec[po->head];
+	h = po->rx_ring.iovec[po->rx_ring.head];
 
 	if (h->tp_status)
 		goto ring_is_full;
-	po->head = po->head != po->iovmax ? po->head+1 : 0;
+	po->rx_ring.head = po->rx_ring.head != po->rx_ring.iovmax ? po->rx_ring.head+1 : 0;
 	po->stats.tp_packets++;
 	if (copy_skb) {
 		status |= TP_STATUS_COPY;
@@ -600,6 +643,7 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,  struct pack
 	}
 	if (!po->stats.tp_drops)
 		status &= ~TP_STATUS_LOSING;
+	wake = tpacket_rx_announce(po);
 	spin_unlock(&sk->receive_queue.lock);
 
 	memcpy((u8*)h + macoff, skb->data, snaplen);
@@ -636,7 +680,8 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,  struct pack
 		}
 	}
 
-	sk->data_ready(sk, 0);
+	if (wake)
+		sk->data_ready(sk, 0);
 
 drop_n_restore:
 	if (skb_head != skb->data && skb_shared(skb)) {
@@ -649,6 +694,7 @@ drop:
 
 ring_is_full:
 	po->stats.tp_drops++;
+	po->rx_unannounced = 0;
 	spin_unlock(&sk->receive_queue.lock);
 
 	sk->data_ready(sk, 0);
@@ -657,6 +703,118 @@ ring_is_full:
 	goto drop_n_restore;
 }
 
+/*
+ * Transmit every frame marked TP_STATUS_SEND_REQUEST, from the TX ring
+ * head on, in one call. The data is copied into an skb, so a frame is
+ * handed back to the user as soon as it has been queued.
+ */
+static int tpacket_snd(struct socket *sock, struct msghdr *msg)
+{
+	struct sock *sk = sock->sk;
+	struct packet_opt *po = sk->protinfo.af_packet;
+	struct packet_ring *ring = &po->tx_ring;
+	struct sockaddr_ll *saddr=(struct sockaddr_ll *)msg->msg_name;
+	struct tpacket_hdr *h;
+	struct sk_buff *skb;
+	struct net_device *dev;
+	unsigned short proto;
+	unsigned char *addr;
+	unsigned int maxlen;
+	int ifindex, err, len, total = 0, reserve = 0;
+
+	if (saddr == NULL) {
+		ifindex	= po->ifindex;
+		proto	= sk->num;
+		addr	= NULL;
+	} else {
+		err = -EINVAL;
+		if (msg->msg_namelen < sizeof(struct sockaddr_ll))
+			goto out;
+		ifindex	= saddr->sll_ifindex;
+		proto	= saddr->sll_protocol;
+		addr	= saddr->sll_addr;
+	}
+
+	dev = dev_get_by_index(ifindex);
+	err = -ENXIO;
+	if (dev == NULL)
+		goto out;
+	err = -ENETDOWN;
+	if (!(dev->flags & IFF_UP))
+		goto out_put;
+	if (sock->type == SOCK_RAW)
+		reserve = dev->hard_header_len;
+
+	lock_sock(sk);
+	err = -EINVAL;
+	if (ring->iovec == NULL)
+		goto out_release;
+
+	/* The frames were written through the user's mapping of the ring */
+	flush_cache_mm(current->mm);
+
+	maxlen = ring->frame_size - (TPACKET_HDRLEN - sizeof(struct sockaddr_ll));
+	err = 0;
+	for (;;) {
+		h = ring->iovec[ring->head];
+		if (h->tp_status != TP_STATUS_SEND_REQUEST)
+			break;
+
+		len = h->tp_len;
+		if (len > dev->mtu+reserve || len > maxlen)
+			goto wrong_format;
+
+		skb = sock_alloc_send_skb(sk, len+dev->hard_header_len+15,
+					  msg->msg_flags & MSG_DONTWAIT, &err);
+		if (skb == NULL)
+			break;
+
+		skb_reserve(skb, (dev->hard_header_len+15)&~15);
+		skb->nh.raw = skb->data;
+
+		if (dev->hard_header) {
+			int res;
+			res = dev->hard_header(skb, dev, ntohs(proto), addr, NULL, len);
+			if (sock->type != SOCK_DGRAM) {
+				skb->tail = skb->data;
+				skb->len = 0;
+			} else if (res < 0) {
+				kfree_skb(skb);
+				goto wrong_format;
+			}
+		}
+
+		memcpy(skb_put(skb,len), (u8*)h + TPACKET_HDRLEN - sizeof(struct sockaddr_ll), len);
+
+		skb->protocol = proto;
+		skb->dev = dev;
+		skb->priority = sk->priority;
+
+		h->tp_status = TP_STATUS_AVAILABLE;
+		flush_dcache_page(virt_to_page(h));
+		ring->head = ring->head != ring->iovmax ? ring->head+1 : 0;
+
+		err = dev_queue_xmit(skb);
+		if (err > 0 && (err = net_xmit_errno(err)) != 0)
+			break;
+		total += len;
+		continue;
+
+wrong_format:
+		h->tp_status = TP_STATUS_WRONG_FORMAT;
+		flush_dcache_page(virt_to_page(h));
+		ring->head = ring->head != ring->iovmax ? ring->head+1 : 0;
+		err = -EINVAL;
+	}
+
+out_release:
+	release_sock(sk);
+out_put:
+	dev_put(dev);
+out:
+	return total ? total : err;
+}
+
 #endif
 
 
@@ -671,6 +829,11 @@ static int packet_sendmsg(struct socket *sock, struct msghdr *msg, int len,
 	unsigned char *addr;
 	int ifindex, err, reserve = 0;
 
+#ifdef CONFIG_PACKET_MMAP
+	if (sk->protinfo.af_packet->tx_ring.iovec)
+		return tpacket_snd(sock, msg);
+#endif
+
 	/*
 	 *	Get and verify the address. 
 	 */
@@ -794,10 +957,15 @@ static int packet_release(struct socket *sock)
 #endif
 
 #ifdef CONFIG_PACKET_MMAP
-	if (sk->protinfo.af_packet->pg_vec) {
+	{
 		struct tpacket_req req;
 		memset(&req, 0, sizeof(req));
-		packet_set_ring(sk, &req, 1);
+
+		if (sk->protinfo.af_packet->rx_ring.pg_vec)
+			packet_set_ring(sk, &req, 1, 0);
+		if (sk->protinfo.af_packet->tx_ring.pg_vec)
+			packet_set_ring(sk, &req, 1, 1);
+		del_timer_sync(&sk->protinfo.af_packet->rx_timer);
 	}
 #endif
 
@@ -977,6 +1145,11 @@ static int packet_create(struct socket *sock, int protocol)
 	 */
 
 	spin_lock_init(&sk->protinfo.af_packet->bind_lock);
+#ifdef CONFIG_PACKET_MMAP
+	init_timer(&sk->protinfo.af_packet->rx_timer);
+	sk->protinfo.af_packet->rx_timer.function = tpacket_rx_timeout;
+	sk->protinfo.af_packet->rx_timer.data = (unsigned long)sk;
+#endif
 	sk->protinfo.af_packet->prot_hook.func = packet_rcv;
 #ifdef CONFIG_SOCK_PACKET
 	if (sock->type == SOCK_PACKET)
@@ -1296,6 +1469,7 @@ packet_setsockopt(struct socket *sock, int level, int optname, char *optval, int
 #endif
 #ifdef CONFIG_PACKET_MMAP
 	case PACKET_RX_RING:
+	case PACKET_TX_RING:
 	{
 		struct tpacket_req req;
 
@@ -1303,7 +1477,24 @@ packet_setsockopt(struct socket *sock, int level, int optname, char *optval, int
 			return -EINVAL;
 		if (copy_from_user(&req,optval,sizeof(req)))
 			return -EFAULT;
-		return packet_set_ring(sk, &req, 0);
+		return packet_set_ring(sk, &req, 0, optname == PACKET_TX_RING);
+	}
+	case PACKET_RX_COALESCE:
+	{
+		int val;
+
+		if (optlen!=sizeof(val))
+			return -EINVAL;
+		if (copy_from_user(&val,optval,sizeof(val)))
+			return -EFAULT;
+		if (val < 0)
+			return -EINVAL;
+
+		/* milliseconds to jiffies, rounding up */
+		spin_lock_bh(&sk->receive_queue.lock);
+		sk->protinfo.af_packet->rx_tmo = (val/1000)*HZ + ((val%1000)*HZ + 999)/1000;
+		spin_unlock_bh(&sk->receive_queue.lock);
+		return 0;
 	}
 	case PACKET_COPY_THRESH:
 	{
@@ -1556,10 +1747,12 @@ unsigned int packet_poll(struct file * file, struct socket *sock, poll_table *wa
 	unsigned int mask = datagram_poll(file, sock, wait);
 
 	spin_lock_bh(&sk->receive_queue.lock);
-	if (po->iovec) {
-		unsigned last = po->head ? po->head-1 : po->iovmax;
+	/* Frames already handed to the user count even while their
+	 * coalesced wake-up is still pending. */
+	if (po->rx_ring.iovec) {
+		unsigned last = po->rx_ring.head ? po->rx_ring.head-1 : po->rx_ring.iovmax;
 
-		if (po->iovec[last]->tp_status)
+		if (po->rx_ring.iovec[last]->tp_status & TP_STATUS_USER)
 			mask |= POLLIN | POLLRDNORM;
 	}
 	spin_unlock_bh(&sk->receive_queue.lock);
@@ -1616,17 +1809,18 @@ static void free_pg_vec(unsigned long *pg_vec, unsigned order, unsigned len)
 }
 
 
-static int packet_set_ring(struct sock *sk, struct tpacket_req *req, int closing)
+static int packet_set_ring(struct sock *sk, struct tpacket_req *req, int closing, int tx_ring)
 {
 	unsigned long *pg_vec = NULL;
 	struct tpacket_hdr **io_vec = NULL;
 	struct packet_opt *po = sk->protinfo.af_packet;
+	struct packet_ring *ring = tx_ring ? &po->tx_ring : &po->rx_ring;
+	int frames_per_block = 0;
 	int order = 0;
 	int err = 0;
 
 	if (req->tp_block_nr) {
 		int i, l;
-		int frames_per_block;
 
 		/* Sanity tests and some calculations */
 		if ((int)req->tp_block_size <= 0)
@@ -1704,19 +1898,23 @@ static int packet_set_ring(struct sock *sk, struct tpacket_req *req, int closing
 #define XC(a, b) ({ __typeof__ ((a)) __t; __t = (a); (a) = (b); __t; })
 
 		spin_lock_bh(&sk->receive_queue.lock);
-		pg_vec = XC(po->pg_vec, pg_vec);
-		io_vec = XC(po->iovec, io_vec);
-		po->iovmax = req->tp_frame_nr-1;
-		po->head = 0;
-		po->frame_size = req->tp_frame_size;
+		pg_vec = XC(ring->pg_vec, pg_vec);
+		io_vec = XC(ring->iovec, io_vec);
+		ring->iovmax = req->tp_frame_nr-1;
+		ring->head = 0;
+		ring->frame_size = req->tp_frame_size;
+		ring->frames_per_block = frames_per_block;
+		if (!tx_ring)
+			po->rx_unannounced = 0;
 		spin_unlock_bh(&sk->receive_queue.lock);
 
-		order = XC(po->pg_vec_order, order);
-		req->tp_block_nr = XC(po->pg_vec_len, req->tp_block_nr);
+		order = XC(ring->pg_vec_order, order);
+		req->tp_block_nr = XC(ring->pg_vec_len, req->tp_block_nr);
 
-		po->pg_vec_pages = req->tp_block_size/PAGE_SIZE;
-		po->prot_hook.func = po->iovec ? tpacket_rcv : packet_rcv;
-		skb_queue_purge(&sk->receive_queue);
+		ring->pg_vec_pages = req->tp_block_size/PAGE_SIZE;
+		po->prot_hook.func = po->rx_ring.iovec ? tpacket_rcv : packet_rcv;
+		if (!tx_ring)
+			skb_queue_purge(&sk->receive_queue);
 #undef XC
 		if (atomic_read(&po->mapped))
 			printk(KERN_DEBUG "packet_mmap: vma is busy: %d\n", atomic_read(&po->mapped));
@@ -1739,35 +1937,50 @@ out:
 	return err;
 }
 
+/*
+ * The RX ring, if any, is mapped first and the TX ring right behind it.
+ */
 static int packet_mmap(struct file *file, struct socket *sock, struct vm_area_struct *vma)
 {
 	struct sock *sk = sock->sk;
 	struct packet_opt *po = sk->protinfo.af_packet;
-	unsigned long size;
+	struct packet_ring *rings[2], *ring;
+	unsigned long size, expected;
 	unsigned long start;
 	int err = -EINVAL;
-	int i;
+	int i, r;
 
 	if (vma->vm_pgoff)
 		return -EINVAL;
 
 	size = vma->vm_end - vma->vm_start;
+	rings[0] = &po->rx_ring;
+	rings[1] = &po->tx_ring;
 
 	lock_sock(sk);
-	if (po->pg_vec == NULL)
+	expected = 0;
+	for (r=0; r<2; r++)
+		if (rings[r]->pg_vec)
+			expected += rings[r]->pg_vec_len*rings[r]->pg_vec_pages*PAGE_SIZE;
+	if (expected == 0)
 		goto out;
-	if (size != po->pg_vec_len*po->pg_vec_pages*PAGE_SIZE)
+	if (size != expected)
 		goto out;
 
 	atomic_inc(&po->mapped);
 	start = vma->vm_start;
 	err = -EAGAIN;
-	for (i=0; i<po->pg_vec_len; i++) {
-		if (remap_page_range(start, __pa(po->pg_vec[i]),
-				     po->pg_vec_pages*PAGE_SIZE,
-				     vma->vm_page_prot))
-			goto out;
-		start += po->pg_vec_pages*PAGE_SIZE;
+	for (r=0; r<2; r++) {
+		ring = rings[r];
+		if (ring->pg_vec == NULL)
+			continue;
+		for (i=0; i<ring->pg_vec_len; i++) {
+			if (remap_page_range(start, __pa(ring->pg_vec[i]),
+					     ring->pg_vec_pages*PAGE_SIZE,
+					     vma->vm_page_prot))
+				goto out;
+			start += ring->pg_vec_pages*PAGE_SIZE;
+		}
 	}
 	vma->vm_ops = &packet_mmap_ops;
 	err = 0;
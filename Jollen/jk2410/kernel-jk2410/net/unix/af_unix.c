@@ -484,7 +484,8 @@ static struct sock * unix_create1(struct socket *sock)
 	sk->protinfo.af_unix.dentry=NULL;
 	sk->protinfo.af_unix.mnt=NULL;
 	sk->protinfo.af_unix.lock = RW_LOCK_UNLOCKED;
-	atomic_set(&sk->protinfo.af_unix.inflight, sock ? 0 : -1);
+	atomic_set(&sk->protinfo.af_unix.inflight, 0);
+	INIT_LIST_HEAD(&sk->protinfo.af_unix.gc_link);
 	init_MUTEX(&sk->protinfo.af_unix.readsem);/* single task reading lock */
 	init_waitqueue_head(&sk->protinfo.af_unix.peer_wait);
 	sk->protinfo.af_unix.list=NULL;
@@ -993,9 +994,6 @@ restart:
 	/* take ten and and send info to listening sock */
 	spin_lock(&other->receive_queue.lock);
 	__skb_queue_tail(&other->receive_queue,skb);
-	/* Undo artificially decreased inflight after embrion
-	 * is installed to listening socket. */
-	atomic_inc(&newsk->protinfo.af_unix.inflight);
 	spin_unlock(&other->receive_queue.lock);
 	unix_state_runlock(other);
 	other->data_ready(other, 0);
@@ -1286,15 +1284,48 @@ out:
 }
 
 		
+/*
+ *	Writes up to UNIX_STREAM_SMALL bytes without descriptors are copied
+ *	in before an skb is allocated, and are added to the end of the last
+ *	skb on the reader's queue when it came from us with the same
+ *	credentials and has room.  When the reader has fallen behind, the
+ *	skb for such a write is allocated a page large to leave that room.
+ */
+#define UNIX_STREAM_SMALL	256
+#define UNIX_STREAM_COALESCE	SKB_MAX_HEAD(0)
+
+/* Called with the peer's state lock held */
+static int unix_stream_append(unix_socket *other, unix_socket *sk,
+			      struct scm_cookie *scm, char *data, int size)
+{
+	struct sk_buff_head *queue = &other->receive_queue;
+	struct sk_buff *skb;
+	unsigned long flags;
+	int done = 0;
+
+	spin_lock_irqsave(&queue->lock, flags);
+	skb = skb_peek_tail(queue);
+	if (skb && skb->sk == sk && !UNIXCB(skb).fp &&
+	    skb_tailroom(skb) >= size &&
+	    memcmp(UNIXCREDS(skb), &scm->creds, sizeof(struct ucred)) == 0) {
+		memcpy(skb_put(skb, size), data, size);
+		done = 1;
+	}
+	spin_unlock_irqrestore(&queue->lock, flags);
+	return done;
+}
+
 static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg, int len,
 			       struct scm_cookie *scm)
 {
 	struct sock *sk = sock->sk;
 	unix_socket *other = NULL;
 	struct sockaddr_un *sunaddr=msg->msg_name;
-	int err,size;
+	int err,size,alloc;
 	struct sk_buff *skb;
 	int sent=0;
+	char small[UNIX_STREAM_SMALL];
+	int copied;
 
 	err = -EOPNOTSUPP;
 	if (msg->msg_flags&MSG_OOB)
@@ -1329,12 +1360,35 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg, int len,
 
 		if (size > SKB_MAX_ALLOC)
 			size = SKB_MAX_ALLOC;
+
+		alloc = size;
+		copied = 0;
+		if (size <= UNIX_STREAM_SMALL && !scm->fp) {
+			if ((err = memcpy_fromiovec(small, msg->msg_iov, size)) != 0)
+				goto out_err;
+			copied = 1;
+
+			unix_state_rlock(other);
+			if (other->dead || (other->shutdown & RCV_SHUTDOWN)) {
+				unix_state_runlock(other);
+				goto pipe_err;
+			}
+			if (unix_stream_append(other, sk, scm, small, size)) {
+				unix_state_runlock(other);
+				other->data_ready(other, size);
+				sent+=size;
+				continue;
+			}
+			if (skb_queue_len(&other->receive_queue))
+				alloc = UNIX_STREAM_COALESCE;
+			unix_state_runlock(other);
+		}
 			
 		/*
 		 *	Grab a buffer
 		 */
 		 
-		skb=sock_alloc_send_skb(sk,size,msg->msg_flags&MSG_DONTWAIT, &err);
+		skb=sock_alloc_send_skb(sk,alloc,msg->msg_flags&MSG_DONTWAIT, &err);
 
 		if (skb==NULL)
 			goto out_err;
@@ -1352,7 +1406,9 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg, int len,
 		if (scm->fp)
 			unix_attach_fds(scm, skb);
 
-		if ((err = memcpy_fromiovec(skb_put(skb,size), msg->msg_iov, size)) != 0) {
+		if (copied)
+			memcpy(skb_put(skb,size), small, size);
+		else if ((err = memcpy_fromiovec(skb_put(skb,size), msg->msg_iov, size)) != 0) {
 			kfree_skb(skb);
 			goto out_err;
 		}
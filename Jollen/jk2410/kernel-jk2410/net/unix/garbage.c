@@ -61,6 +61,13 @@
  *		parents (->gc_tree).
  *	AV		1 Mar 1999
  *		Damn. Added missing check for ->dead in listen queues scanning.
+ *	Collect incrementally: sockets are kept on a list while they are in
+ *		flight and only those are looked at, instead of marking from
+ *		every AF_UNIX socket in the system on each close.  A socket in
+ *		flight whose file has no references besides the in-flight ones
+ *		is a candidate; references from the queues of candidates are
+ *		subtracted, those left with any are reachable and give theirs
+ *		back, and what remains is cycles of garbage.
  *
  */
  
@@ -84,13 +91,15 @@
 
 /* Internal data structures and random procedures: */
 
-#define GC_HEAD		((unix_socket *)(-1))
-#define GC_ORPHAN	((unix_socket *)(-3))
-
-static unix_socket *gc_current=GC_HEAD;	/* stack of objects to mark */
+static LIST_HEAD(gc_inflight_list);	/* sockets with inflight > 0 */
+static LIST_HEAD(gc_candidates);
+static spinlock_t unix_gc_lock = SPIN_LOCK_UNLOCKED;
+static int gc_in_progress;
 
 atomic_t unix_tot_inflight = ATOMIC_INIT(0);
 
+#define unix_gc_entry(ptr) \
+	list_entry((ptr), struct sock, protinfo.af_unix.gc_link)
 
 extern inline unix_socket *unix_get_socket(struct file *filp)
 {
@@ -122,8 +131,12 @@ void unix_inflight(struct file *fp)
 {
 	unix_socket *s=unix_get_socket(fp);
 	if(s) {
+		spin_lock(&unix_gc_lock);
 		atomic_inc(&s->protinfo.af_unix.inflight);
+		if (atomic_read(&s->protinfo.af_unix.inflight) == 1)
+			list_add_tail(&s->protinfo.af_unix.gc_link, &gc_inflight_list);
 		atomic_inc(&unix_tot_inflight);
+		spin_unlock(&unix_gc_lock);
 	}
 }
 
@@ -131,8 +144,11 @@ void unix_notinflight(struct file *fp)
 {
 	unix_socket *s=unix_get_socket(fp);
 	if(s) {
-		atomic_dec(&s->protinfo.af_unix.inflight);
+		spin_lock(&unix_gc_lock);
+		if (atomic_dec_and_test(&s->protinfo.af_unix.inflight))
+			list_del_init(&s->protinfo.af_unix.gc_link);
 		atomic_dec(&unix_tot_inflight);
+		spin_unlock(&unix_gc_lock);
 	}
 }
 
@@ -141,25 +157,101 @@ void unix_notinflight(struct file *fp)
  *	Garbage Collector Support Functions
  */
 
-extern inline unix_socket *pop_stack(void)
+/*
+ *	Apply func to every candidate whose descriptor is queued on x.  With
+ *	a hitlist, the skbs carrying such descriptors are moved onto it.
+ */
+static void scan_inflight(unix_socket *x, void (*func)(unix_socket *),
+			  struct sk_buff_head *hitlist)
 {
-	unix_socket *p=gc_current;
-	gc_current = p->protinfo.af_unix.gc_tree;
-	return p;
+	struct sk_buff *skb, *next;
+
+	spin_lock(&x->receive_queue.lock);
+	skb = x->receive_queue.next;
+	while (skb != (struct sk_buff *)&x->receive_queue) {
+		next = skb->next;
+		/*
+		 *	Do we have file descriptors ?
+		 */
+		if (UNIXCB(skb).fp) {
+			int hit = 0;
+			int nfd = UNIXCB(skb).fp->count;
+			struct file **fp = UNIXCB(skb).fp->fp;
+
+			while (nfd--) {
+				unix_socket *sk = unix_get_socket(*fp++);
+
+				/*
+				 *	Leave non-candidates alone, they may
+				 *	have been queued after the collection
+				 *	started.
+				 */
+				if (sk && sk->protinfo.af_unix.gc_candidate) {
+					hit = 1;
+					func(sk);
+				}
+			}
+			if (hit && hitlist) {
+				__skb_unlink(skb, skb->list);
+				__skb_queue_tail(hitlist, skb);
+			}
+		}
+		skb = next;
+	}
+	spin_unlock(&x->receive_queue.lock);
 }
 
-extern inline int empty_stack(void)
+static void scan_children(unix_socket *x, void (*func)(unix_socket *),
+			  struct sk_buff_head *hitlist)
 {
-	return gc_current == GC_HEAD;
+	struct sk_buff *skb;
+	struct list_head embryos, *p;
+
+	if (x->state != TCP_LISTEN) {
+		scan_inflight(x, func, hitlist);
+		return;
+	}
+
+	/*
+	 *	We have to scan not-yet-accepted ones too.  An embryo can't be
+	 *	in flight, so its gc_link is free to collect them on.
+	 */
+	INIT_LIST_HEAD(&embryos);
+	spin_lock(&x->receive_queue.lock);
+	for (skb = x->receive_queue.next;
+	     skb != (struct sk_buff *)&x->receive_queue; skb = skb->next)
+		list_add_tail(&skb->sk->protinfo.af_unix.gc_link, &embryos);
+	spin_unlock(&x->receive_queue.lock);
+
+	while (!list_empty(&embryos)) {
+		p = embryos.next;
+		list_del_init(p);
+		scan_inflight(unix_gc_entry(p), func, hitlist);
+	}
 }
 
-extern inline void maybe_unmark_and_push(unix_socket *x)
+static void dec_inflight(unix_socket *s)
 {
-	if (x->protinfo.af_unix.gc_tree != GC_ORPHAN)
-		return;
-	sock_hold(x);
-	x->protinfo.af_unix.gc_tree = gc_current;
-	gc_current = x;
+	atomic_dec(&s->protinfo.af_unix.inflight);
+}
+
+static void inc_inflight(unix_socket *s)
+{
+	atomic_inc(&s->protinfo.af_unix.inflight);
+}
+
+static void inc_inflight_move_tail(unix_socket *s)
+{
+	atomic_inc(&s->protinfo.af_unix.inflight);
+	/*
+	 *	If it may still be part of a cycle, move it to the end of the
+	 *	candidates so that it is looked at again even if the scan has
+	 *	already passed it.
+	 */
+	if (s->protinfo.af_unix.gc_maybe_cycle) {
+		list_del(&s->protinfo.af_unix.gc_link);
+		list_add_tail(&s->protinfo.af_unix.gc_link, &gc_candidates);
+	}
 }
 
 
@@ -167,144 +259,102 @@ extern inline void maybe_unmark_and_push(unix_socket *x)
 
 void unix_gc(void)
 {
-	static DECLARE_MUTEX(unix_gc_sem);
-	int i;
 	unix_socket *s;
 	struct sk_buff_head hitlist;
-	struct sk_buff *skb;
+	struct list_head cursor, not_cycle, *p, *n;
+
+	spin_lock(&unix_gc_lock);
 
 	/*
 	 *	Avoid a recursive GC.
 	 */
 
-	if (down_trylock(&unix_gc_sem))
-		return;
+	if (gc_in_progress)
+		goto out;
+	gc_in_progress = 1;
 
-	read_lock(&unix_table_lock);
-
-	forall_unix_sockets(i, s)
-	{
-		s->protinfo.af_unix.gc_tree=GC_ORPHAN;
-	}
 	/*
-	 *	Everything is now marked 
+	 *	Pick the candidates: sockets in flight whose file has no
+	 *	references but the in-flight ones.  Nobody can receive from
+	 *	them, and holding unix_gc_lock keeps them from being sent
+	 *	anywhere, so their queues stay as they are while we look.
 	 */
+	list_for_each_safe(p, n, &gc_inflight_list) {
+		s = unix_gc_entry(p);
+		if (file_count(s->socket->file) ==
+		    atomic_read(&s->protinfo.af_unix.inflight)) {
+			list_del(p);
+			list_add_tail(p, &gc_candidates);
+			s->protinfo.af_unix.gc_candidate = 1;
+			s->protinfo.af_unix.gc_maybe_cycle = 1;
+		}
+	}
 
-	/* Invariant to be maintained:
-		- everything unmarked is either:
-		-- (a) on the stack, or
-		-- (b) has all of its children unmarked
-		- everything on the stack is always unmarked
-		- nothing is ever pushed onto the stack twice, because:
-		-- nothing previously unmarked is ever pushed on the stack
+	/*
+	 *	Take away the references the candidates hold on each other.
 	 */
+	list_for_each(p, &gc_candidates)
+		scan_children(unix_gc_entry(p), dec_inflight, NULL);
 
 	/*
-	 *	Push root set
+	 *	A candidate with references left is reachable from outside:
+	 *	give back the ones it holds, which may make others reachable
+	 *	in turn.  The cursor keeps our place while entries move.
 	 */
+	INIT_LIST_HEAD(&not_cycle);
+	list_add(&cursor, &gc_candidates);
+	while (cursor.next != &gc_candidates) {
+		p = cursor.next;
+		s = unix_gc_entry(p);
+
+		list_del(&cursor);
+		list_add(&cursor, p);
+
+		if (atomic_read(&s->protinfo.af_unix.inflight) > 0) {
+			list_del(p);
+			list_add_tail(p, &not_cycle);
+			s->protinfo.af_unix.gc_maybe_cycle = 0;
+			scan_children(s, inc_inflight_move_tail, NULL);
+		}
+	}
+	list_del(&cursor);
 
-	forall_unix_sockets(i, s)
-	{
-		int open_count = 0;
-
-		/*
-		 *	If all instances of the descriptor are not
-		 *	in flight we are in use.
-		 *
-		 *	Special case: when socket s is embrion, it may be
-		 *	hashed but still not in queue of listening socket.
-		 *	In this case (see unix_create1()) we set artificial
-		 *	negative inflight counter to close race window.
-		 *	It is trick of course and dirty one.
-		 */
-		if(s->socket && s->socket->file)
-			open_count = file_count(s->socket->file);
-		if (open_count > atomic_read(&s->protinfo.af_unix.inflight))
-			maybe_unmark_and_push(s);
+	while (!list_empty(&not_cycle)) {
+		p = not_cycle.next;
+		unix_gc_entry(p)->protinfo.af_unix.gc_candidate = 0;
+		list_del(p);
+		list_add_tail(p, &gc_inflight_list);
 	}
 
 	/*
-	 *	Mark phase 
+	 *	What is left is garbage.  Restore its counts and pull out the
+	 *	skbs that hold the cycles together.
 	 */
-
-	while (!empty_stack())
-	{
-		unix_socket *x = pop_stack();
-		unix_socket *sk;
-
-		spin_lock(&x->receive_queue.lock);
-		skb=skb_peek(&x->receive_queue);
-		
-		/*
-		 *	Loop through all but first born 
-		 */
-		
-		while(skb && skb != (struct sk_buff *)&x->receive_queue)
-		{
-			/*
-			 *	Do we have file descriptors ?
-			 */
-			if(UNIXCB(skb).fp)
-			{
-				/*
-				 *	Process the descriptors of this socket
-				 */
-				int nfd=UNIXCB(skb).fp->count;
-				struct file **fp = UNIXCB(skb).fp->fp;
-				while(nfd--)
-				{
-					/*
-					 *	Get the socket the fd matches if
-					 *	it indeed does so
-					 */
-					if((sk=unix_get_socket(*fp++))!=NULL)
-					{
-						maybe_unmark_and_push(sk);
-					}
-				}
-			}
-			/* We have to scan not-yet-accepted ones too */
-			if (x->state == TCP_LISTEN) {
-				maybe_unmark_and_push(skb->sk);
-			}
-			skb=skb->next;
-		}
-		spin_unlock(&x->receive_queue.lock);
-		sock_put(x);
-	}
-
 	skb_queue_head_init(&hitlist);
+	list_for_each(p, &gc_candidates)
+		scan_children(unix_gc_entry(p), inc_inflight, &hitlist);
 
-	forall_unix_sockets(i, s)
-	{
-		if (s->protinfo.af_unix.gc_tree == GC_ORPHAN)
-		{
-			struct sk_buff *nextsk;
-			spin_lock(&s->receive_queue.lock);
-			skb=skb_peek(&s->receive_queue);
-			while(skb && skb != (struct sk_buff *)&s->receive_queue)
-			{
-				nextsk=skb->next;
-				/*
-				 *	Do we have file descriptors ?
-				 */
-				if(UNIXCB(skb).fp)
-				{
-					__skb_unlink(skb, skb->list);
-					__skb_queue_tail(&hitlist,skb);
-				}
-				skb=nextsk;
-			}
-			spin_unlock(&s->receive_queue.lock);
-		}
-		s->protinfo.af_unix.gc_tree = GC_ORPHAN;
-	}
-	read_unlock(&unix_table_lock);
+	spin_unlock(&unix_gc_lock);
 
 	/*
 	 *	Here we are. Hitlist is filled. Die.
 	 */
 
 	__skb_queue_purge(&hitlist);
-	up(&unix_gc_sem);
+
+	spin_lock(&unix_gc_lock);
+
+	/* Everything should have gone with the hitlist; don't lose track
+	 * of anything that didn't. */
+	while (!list_empty(&gc_candidates)) {
+		p = gc_candidates.next;
+		s = unix_gc_entry(p);
+		s->protinfo.af_unix.gc_candidate = 0;
+		s->protinfo.af_unix.gc_maybe_cycle = 0;
+		list_del(p);
+		list_add_tail(p, &gc_inflight_list);
+	}
+	gc_in_progress = 0;
+out:
+	spin_unlock(&unix_gc_lock);
 }